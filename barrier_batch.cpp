@@ -0,0 +1,237 @@
+#include "barrier_batch.hpp"
+#include <stdexcept>
+
+namespace vulkanDetails
+{
+    namespace
+    {
+        struct LayoutSync
+        {
+            VkPipelineStageFlags stages;
+            VkAccessFlags        access;
+        };
+
+        // What has to be waited on before an image can leave layout.
+        // Only writes need to be made available, so reads contribute no access bits.
+        LayoutSync sourceSync(VkImageLayout layout)
+        {
+            switch (layout)
+            {
+                case VK_IMAGE_LAYOUT_UNDEFINED:
+                    return {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0};
+                case VK_IMAGE_LAYOUT_PREINITIALIZED:
+                    return {VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_WRITE_BIT};
+                case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+                    return {VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
+                case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+                    return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT};
+                case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+                    return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0};
+                case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+                    return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT};
+                case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+                    return {VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT};
+                case VK_IMAGE_LAYOUT_GENERAL:
+                    return {VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_WRITE_BIT};
+                case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+                    return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0};
+                default:
+                    throw std::invalid_argument("unsupported layout transition!");
+            }
+        }
+
+        // What has to wait for the image once it is in layout.
+        LayoutSync destinationSync(VkImageLayout layout)
+        {
+            switch (layout)
+            {
+                case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+                    return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT};
+                case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+                    return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT};
+                case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+                    return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                            VK_ACCESS_SHADER_READ_BIT};
+                case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+                    return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                            VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT};
+                case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+                    return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT};
+                case VK_IMAGE_LAYOUT_GENERAL:
+                    return {VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT};
+                case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+                    // the present engine synchronizes through the semaphore
+                    return {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0};
+                default:
+                    throw std::invalid_argument("unsupported layout transition!");
+            }
+        }
+    } // namespace
+
+    VkImageSubresourceRange wholeImageRange(VkFormat format, uint32_t mip_levels, uint32_t array_layers)
+    {
+        VkImageSubresourceRange range {};
+        switch (format)
+        {
+            case VK_FORMAT_D32_SFLOAT:
+            case VK_FORMAT_D16_UNORM:
+                range.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+                break;
+            case VK_FORMAT_D24_UNORM_S8_UINT:
+            case VK_FORMAT_D32_SFLOAT_S8_UINT:
+                range.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+                break;
+            default:
+                range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                break;
+        }
+        range.baseMipLevel   = 0;
+        range.levelCount     = mip_levels;
+        range.baseArrayLayer = 0;
+        range.layerCount     = array_layers;
+        return range;
+    }
+
+    void BarrierBatch::useSynchronization2(PFN_vkCmdPipelineBarrier2 cmd_pipeline_barrier2)
+    {
+        pipeline_barrier2 = cmd_pipeline_barrier2;
+    }
+
+    void BarrierBatch::transitionImage(VkImage                        image,
+                                       VkImageLayout                  old_layout,
+                                       VkImageLayout                  new_layout,
+                                       const VkImageSubresourceRange& range)
+    {
+        LayoutSync source      = sourceSync(old_layout);
+        LayoutSync destination = destinationSync(new_layout);
+        imageBarrier(
+            image, old_layout, new_layout, range, source.stages, source.access, destination.stages, destination.access);
+    }
+
+    void BarrierBatch::imageBarrier(VkImage                        image,
+                                    VkImageLayout                  old_layout,
+                                    VkImageLayout                  new_layout,
+                                    const VkImageSubresourceRange& range,
+                                    VkPipelineStageFlags           src_stage_mask,
+                                    VkAccessFlags                  src_access,
+                                    VkPipelineStageFlags           dst_stage_mask,
+                                    VkAccessFlags                  dst_access)
+    {
+        VkImageMemoryBarrier barrier {};
+        barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask       = src_access;
+        barrier.dstAccessMask       = dst_access;
+        barrier.oldLayout           = old_layout;
+        barrier.newLayout           = new_layout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image               = image;
+        barrier.subresourceRange    = range;
+        image_barriers.push_back(barrier);
+        src_stages |= src_stage_mask;
+        dst_stages |= dst_stage_mask;
+
+        // the 1.0 stage and access bits keep their values in the 64-bit masks
+        VkImageMemoryBarrier2 barrier2 {};
+        barrier2.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        barrier2.srcStageMask        = src_stage_mask;
+        barrier2.srcAccessMask       = src_access;
+        barrier2.dstStageMask        = dst_stage_mask;
+        barrier2.dstAccessMask       = dst_access;
+        barrier2.oldLayout           = old_layout;
+        barrier2.newLayout           = new_layout;
+        barrier2.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier2.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier2.image               = image;
+        barrier2.subresourceRange    = range;
+        image_barriers2.push_back(barrier2);
+    }
+
+    void BarrierBatch::bufferBarrier(VkBuffer             buffer,
+                                     VkDeviceSize         offset,
+                                     VkDeviceSize         size,
+                                     VkPipelineStageFlags src_stage_mask,
+                                     VkAccessFlags        src_access,
+                                     VkPipelineStageFlags dst_stage_mask,
+                                     VkAccessFlags        dst_access)
+    {
+        VkBufferMemoryBarrier barrier {};
+        barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask       = src_access;
+        barrier.dstAccessMask       = dst_access;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer              = buffer;
+        barrier.offset              = offset;
+        barrier.size                = size;
+        buffer_barriers.push_back(barrier);
+        src_stages |= src_stage_mask;
+        dst_stages |= dst_stage_mask;
+
+        VkBufferMemoryBarrier2 barrier2 {};
+        barrier2.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+        barrier2.srcStageMask        = src_stage_mask;
+        barrier2.srcAccessMask       = src_access;
+        barrier2.dstStageMask        = dst_stage_mask;
+        barrier2.dstAccessMask       = dst_access;
+        barrier2.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier2.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier2.buffer              = buffer;
+        barrier2.offset              = offset;
+        barrier2.size                = size;
+        buffer_barriers2.push_back(barrier2);
+    }
+
+    void BarrierBatch::record(VkCommandBuffer command_buffer) const
+    {
+        if (empty())
+        {
+            return;
+        }
+        if (pipeline_barrier2 != nullptr)
+        {
+            recordSynchronization2(command_buffer);
+            return;
+        }
+        // an empty stage mask is invalid, these are the "wait on nothing"/"block nothing" equivalents
+        vkCmdPipelineBarrier(command_buffer,
+                             src_stages != 0 ? src_stages : +VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             dst_stages != 0 ? dst_stages : +VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             static_cast<uint32_t>(buffer_barriers.size()),
+                             buffer_barriers.data(),
+                             static_cast<uint32_t>(image_barriers.size()),
+                             image_barriers.data());
+    }
+
+    void BarrierBatch::recordSynchronization2(VkCommandBuffer command_buffer) const
+    {
+        // empty stage masks are valid here and mean "nothing", no substitution needed
+        VkDependencyInfo dependency_info {};
+        dependency_info.sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependency_info.bufferMemoryBarrierCount = static_cast<uint32_t>(buffer_barriers2.size());
+        dependency_info.pBufferMemoryBarriers    = buffer_barriers2.data();
+        dependency_info.imageMemoryBarrierCount  = static_cast<uint32_t>(image_barriers2.size());
+        dependency_info.pImageMemoryBarriers     = image_barriers2.data();
+        pipeline_barrier2(command_buffer, &dependency_info);
+    }
+
+    void BarrierBatch::flush(VkCommandBuffer command_buffer)
+    {
+        record(command_buffer);
+        clear();
+    }
+
+    void BarrierBatch::clear()
+    {
+        src_stages = 0;
+        dst_stages = 0;
+        image_barriers.clear();
+        buffer_barriers.clear();
+        image_barriers2.clear();
+        buffer_barriers2.clear();
+    }
+} // namespace vulkanDetails
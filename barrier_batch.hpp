@@ -0,0 +1,67 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <vector>
+
+namespace vulkanDetails
+{
+    // Single mip, single layer range with the aspect implied by format.
+    VkImageSubresourceRange wholeImageRange(VkFormat format, uint32_t mip_levels = 1, uint32_t array_layers = 1);
+
+    // Collects image and buffer barriers for any number of resources and records them with one vkCmdPipelineBarrier,
+    // instead of one barrier call (or one submission) per resource.
+    //
+    // With synchronization2 the batch goes out as one vkCmdPipelineBarrier2 instead, where every barrier keeps its
+    // own stage masks. The 1.0 call can only take the union of all of them, so e.g. a transfer barrier batched with
+    // a fragment shader one also ends up waiting for fragment work.
+    class BarrierBatch
+    {
+    public:
+        // Switches every batch over to vkCmdPipelineBarrier2, nullptr goes back to vkCmdPipelineBarrier. Set once
+        // by the device that enabled the feature, before anything is recorded.
+        static void useSynchronization2(PFN_vkCmdPipelineBarrier2 cmd_pipeline_barrier2);
+
+        // Stages and access masks are derived from the two layouts; throws std::invalid_argument for layouts it does
+        // not know how to synchronize.
+        void transitionImage(VkImage                        image,
+                             VkImageLayout                  old_layout,
+                             VkImageLayout                  new_layout,
+                             const VkImageSubresourceRange& range);
+        void imageBarrier(VkImage                        image,
+                          VkImageLayout                  old_layout,
+                          VkImageLayout                  new_layout,
+                          const VkImageSubresourceRange& range,
+                          VkPipelineStageFlags           src_stages,
+                          VkAccessFlags                  src_access,
+                          VkPipelineStageFlags           dst_stages,
+                          VkAccessFlags                  dst_access);
+        void bufferBarrier(VkBuffer             buffer,
+                           VkDeviceSize         offset,
+                           VkDeviceSize         size,
+                           VkPipelineStageFlags src_stages,
+                           VkAccessFlags        src_access,
+                           VkPipelineStageFlags dst_stages,
+                           VkAccessFlags        dst_access);
+
+        // Records everything collected so far; nothing is recorded for an empty batch.
+        void record(VkCommandBuffer command_buffer) const;
+        // record() and clear().
+        void flush(VkCommandBuffer command_buffer);
+        void clear();
+
+        [[nodiscard]] bool   empty() const { return image_barriers.empty() && buffer_barriers.empty(); }
+        [[nodiscard]] size_t size() const { return image_barriers.size() + buffer_barriers.size(); }
+
+    private:
+        void recordSynchronization2(VkCommandBuffer command_buffer) const;
+
+        static inline PFN_vkCmdPipelineBarrier2 pipeline_barrier2 = nullptr;
+
+        VkPipelineStageFlags                src_stages = 0;
+        VkPipelineStageFlags                dst_stages = 0;
+        std::vector<VkImageMemoryBarrier>   image_barriers;
+        std::vector<VkBufferMemoryBarrier>  buffer_barriers;
+        // the same barriers with their own stage masks, for vkCmdPipelineBarrier2
+        std::vector<VkImageMemoryBarrier2>  image_barriers2;
+        std::vector<VkBufferMemoryBarrier2> buffer_barriers2;
+    };
+} // namespace vulkanDetails
@@ -0,0 +1,68 @@
+#include "deletion_queue.hpp"
+#include <algorithm>
+
+namespace vulkanDetails
+{
+    void DeletionQueue::enqueue(uint64_t frame, DestroyFn destroy)
+    {
+        // an explicit frame older than the newest request must not overtake it
+        if (!requests.empty())
+        {
+            frame = std::max(frame, requests.back().frame);
+        }
+        requests.push_back({frame, std::move(destroy)});
+    }
+
+    void DeletionQueue::destroyBuffer(VkBuffer buffer)
+    {
+        enqueue([buffer](VkDevice device) { vkDestroyBuffer(device, buffer, nullptr); });
+    }
+
+    void DeletionQueue::destroyImage(VkImage image)
+    {
+        enqueue([image](VkDevice device) { vkDestroyImage(device, image, nullptr); });
+    }
+
+    void DeletionQueue::destroyImageView(VkImageView view)
+    {
+        enqueue([view](VkDevice device) { vkDestroyImageView(device, view, nullptr); });
+    }
+
+    void DeletionQueue::destroyFramebuffer(VkFramebuffer framebuffer)
+    {
+        enqueue([framebuffer](VkDevice device) { vkDestroyFramebuffer(device, framebuffer, nullptr); });
+    }
+
+    void DeletionQueue::destroyPipeline(VkPipeline pipeline)
+    {
+        enqueue([pipeline](VkDevice device) { vkDestroyPipeline(device, pipeline, nullptr); });
+    }
+
+    void DeletionQueue::destroyDescriptorPool(VkDescriptorPool pool)
+    {
+        enqueue([pool](VkDevice device) { vkDestroyDescriptorPool(device, pool, nullptr); });
+    }
+
+    void DeletionQueue::freeMemory(VkDeviceMemory memory)
+    {
+        enqueue([memory](VkDevice device) { vkFreeMemory(device, memory, nullptr); });
+    }
+
+    void DeletionQueue::collect(uint64_t completed_frame)
+    {
+        while (!requests.empty() && requests.front().frame <= completed_frame)
+        {
+            requests.front().destroy(device);
+            requests.pop_front();
+        }
+    }
+
+    void DeletionQueue::flush()
+    {
+        for (auto& request : requests)
+        {
+            request.destroy(device);
+        }
+        requests.clear();
+    }
+} // namespace vulkanDetails
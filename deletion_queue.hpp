@@ -0,0 +1,54 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+
+namespace vulkanDetails
+{
+    // Destroys Vulkan objects once the GPU can no longer be using them, instead of after vkDeviceWaitIdle.
+    //
+    // Every request is tagged with a monotonically increasing frame value (a frame counter or a timeline semaphore
+    // value): the last frame that may still reference the object. collect() runs the requests whose frame is known
+    // to have finished, e.g. after the in-flight fence of that frame was waited on.
+    class DeletionQueue
+    {
+    public:
+        using DestroyFn = std::function<void(VkDevice)>;
+
+        void init(VkDevice logical_device) { device = logical_device; }
+
+        // Frame value that requests without an explicit one are tagged with; call before recording a frame.
+        void setCurrentFrame(uint64_t frame) { current_frame = frame; }
+
+        void enqueue(DestroyFn destroy) { enqueue(current_frame, std::move(destroy)); }
+        void enqueue(uint64_t frame, DestroyFn destroy);
+
+        void destroyBuffer(VkBuffer buffer);
+        void destroyImage(VkImage image);
+        void destroyImageView(VkImageView view);
+        void destroyFramebuffer(VkFramebuffer framebuffer);
+        void destroyPipeline(VkPipeline pipeline);
+        void destroyDescriptorPool(VkDescriptorPool pool);
+        void freeMemory(VkDeviceMemory memory);
+
+        // Runs every request tagged with a frame <= completed_frame.
+        void collect(uint64_t completed_frame);
+        // Runs everything that is left; only valid once the device is idle.
+        void flush();
+
+        [[nodiscard]] size_t pending() const { return requests.size(); }
+
+    private:
+        struct Request
+        {
+            uint64_t  frame;
+            DestroyFn destroy;
+        };
+
+        VkDevice            device {};
+        uint64_t            current_frame = 0;
+        std::deque<Request> requests; // sorted by frame, since frames only move forward
+    };
+} // namespace vulkanDetails
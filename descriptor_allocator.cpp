@@ -0,0 +1,178 @@
+#include "descriptor_allocator.hpp"
+#include "handle_key.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace vulkanDetails
+{
+    void DescriptorAllocator::init(VkDevice                                logical_device,
+                                   uint32_t                                initial_sets_per_pool,
+                                   const std::vector<DescriptorPoolRatio>& ratios)
+    {
+        device        = logical_device;
+        sets_per_pool = std::max(initial_sets_per_pool, 1u);
+        pool_ratios   = ratios;
+    }
+
+    void DescriptorAllocator::cleanup()
+    {
+        for (VkDescriptorPool pool : used_pools)
+        {
+            vkDestroyDescriptorPool(device, pool, nullptr);
+        }
+        for (VkDescriptorPool pool : free_pools)
+        {
+            vkDestroyDescriptorPool(device, pool, nullptr);
+        }
+        used_pools.clear();
+        free_pools.clear();
+        current_pool = VK_NULL_HANDLE;
+    }
+
+    VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+    {
+        if (current_pool == VK_NULL_HANDLE)
+        {
+            current_pool = nextPool();
+        }
+
+        VkDescriptorSetAllocateInfo alloc_info {};
+        alloc_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.descriptorPool     = current_pool;
+        alloc_info.descriptorSetCount = 1;
+        alloc_info.pSetLayouts        = &layout;
+
+        VkDescriptorSet set;
+        VkResult        result = vkAllocateDescriptorSets(device, &alloc_info, &set);
+        if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+        {
+            // the full pool stays in used_pools until the next reset
+            current_pool              = nextPool();
+            alloc_info.descriptorPool = current_pool;
+            result                    = vkAllocateDescriptorSets(device, &alloc_info, &set);
+        }
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate descriptor set!");
+        }
+        return set;
+    }
+
+    void DescriptorAllocator::reset()
+    {
+        for (VkDescriptorPool pool : used_pools)
+        {
+            vkResetDescriptorPool(device, pool, 0);
+            free_pools.push_back(pool);
+        }
+        used_pools.clear();
+        current_pool = VK_NULL_HANDLE;
+    }
+
+    VkDescriptorPool DescriptorAllocator::nextPool()
+    {
+        VkDescriptorPool pool;
+        if (!free_pools.empty())
+        {
+            pool = free_pools.back();
+            free_pools.pop_back();
+        }
+        else
+        {
+            std::vector<VkDescriptorPoolSize> pool_sizes;
+            for (const auto& ratio : pool_ratios)
+            {
+                pool_sizes.push_back(
+                    {ratio.type, static_cast<uint32_t>(std::ceil(ratio.per_set * static_cast<float>(sets_per_pool)))});
+            }
+            VkDescriptorPoolCreateInfo pool_info {};
+            pool_info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+            pool_info.pPoolSizes    = pool_sizes.data();
+            pool_info.maxSets       = sets_per_pool;
+            if (vkCreateDescriptorPool(device, &pool_info, nullptr, &pool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create descriptor pool!");
+            }
+            sets_per_pool = std::min(sets_per_pool * 2, MAX_SETS_PER_POOL);
+        }
+        used_pools.push_back(pool);
+        return pool;
+    }
+
+    void writeDescriptorSet(VkDevice device, VkDescriptorSet set, const std::vector<DescriptorBinding>& bindings)
+    {
+        std::vector<VkWriteDescriptorSet> writes(bindings.size());
+        for (size_t i = 0; i < bindings.size(); i++)
+        {
+            writes[i].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet          = set;
+            writes[i].dstBinding      = bindings[i].binding;
+            writes[i].dstArrayElement = 0;
+            writes[i].descriptorType  = bindings[i].type;
+            writes[i].descriptorCount = 1;
+            switch (bindings[i].type)
+            {
+                case VK_DESCRIPTOR_TYPE_SAMPLER:
+                case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+                case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+                case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+                case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+                    writes[i].pImageInfo = &bindings[i].image;
+                    break;
+                case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+                case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+                case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+                case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+                    writes[i].pBufferInfo = &bindings[i].buffer;
+                    break;
+                case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+                case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+                    writes[i].pTexelBufferView = &bindings[i].texel_buffer;
+                    break;
+                default:
+                    // inline uniform blocks and acceleration structures are written through pNext
+                    throw std::runtime_error("unsupported descriptor type in writeDescriptorSet!");
+            }
+        }
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+
+    void DescriptorSetCache::init(VkDevice logical_device, DescriptorAllocator& set_allocator)
+    {
+        device    = logical_device;
+        allocator = &set_allocator;
+    }
+
+    VkDescriptorSet DescriptorSetCache::get(VkDescriptorSetLayout                 layout,
+                                            const std::vector<DescriptorBinding>& bindings)
+    {
+        std::vector<uint64_t> key = {handleKey(layout)};
+        for (const auto& binding : bindings)
+        {
+            key.insert(key.end(),
+                       {binding.binding,
+                        static_cast<uint64_t>(binding.type),
+                        handleKey(binding.buffer.buffer),
+                        binding.buffer.offset,
+                        binding.buffer.range,
+                        handleKey(binding.image.sampler),
+                        handleKey(binding.image.imageView),
+                        static_cast<uint64_t>(binding.image.imageLayout),
+                        handleKey(binding.texel_buffer)});
+        }
+        auto found = sets.find(key);
+        if (found != sets.end())
+        {
+            hit_count++;
+            return found->second;
+        }
+        miss_count++;
+
+        VkDescriptorSet set = allocator->allocate(layout);
+        writeDescriptorSet(device, set, bindings);
+        sets.emplace(std::move(key), set);
+        return set;
+    }
+} // namespace vulkanDetails
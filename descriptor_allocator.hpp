@@ -0,0 +1,81 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace vulkanDetails
+{
+    // Descriptors of each type reserved per set when a pool is created.
+    struct DescriptorPoolRatio
+    {
+        VkDescriptorType type;
+        float            per_set;
+    };
+
+    // Hands out descriptor sets from a chain of pools. When the current pool runs out, the next one (twice the
+    // size, up to MAX_SETS_PER_POOL) takes over. Sets are never freed one by one; reset() recycles every pool at
+    // once, which makes per-frame sets a bump allocation.
+    class DescriptorAllocator
+    {
+    public:
+        static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+        void init(VkDevice                                logical_device,
+                  uint32_t                                initial_sets_per_pool,
+                  const std::vector<DescriptorPoolRatio>& ratios);
+        void cleanup();
+
+        VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+        // Every set handed out so far becomes invalid; the pools are kept for reuse.
+        void            reset();
+
+        [[nodiscard]] size_t poolCount() const { return used_pools.size() + free_pools.size(); }
+
+    private:
+        VkDescriptorPool nextPool();
+
+        VkDevice                         device {};
+        std::vector<DescriptorPoolRatio> pool_ratios;
+        uint32_t                         sets_per_pool = 0;
+        VkDescriptorPool                 current_pool {};
+        std::vector<VkDescriptorPool>    used_pools; // includes current_pool
+        std::vector<VkDescriptorPool>    free_pools;
+    };
+
+    // One binding of a set as it is written with vkUpdateDescriptorSets; fill buffer, image or texel_buffer to match
+    // type.
+    struct DescriptorBinding
+    {
+        uint32_t               binding;
+        VkDescriptorType       type;
+        VkDescriptorBufferInfo buffer {};
+        VkDescriptorImageInfo  image {};
+        VkBufferView           texel_buffer {}; // uniform and storage texel buffers
+    };
+
+    // Throws for descriptor types that are not written through buffer, image or texel_buffer.
+    void writeDescriptorSet(VkDevice device, VkDescriptorSet set, const std::vector<DescriptorBinding>& bindings);
+
+    // Returns the same descriptor set for the same layout and bindings, allocating and writing it on first use.
+    // Sets are not tracked per resource: destroying something a cached set points to requires clear().
+    class DescriptorSetCache
+    {
+    public:
+        void init(VkDevice logical_device, DescriptorAllocator& set_allocator);
+
+        VkDescriptorSet get(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings);
+        // Forgets every cached set; they stay allocated until the allocator is reset.
+        void            clear() { sets.clear(); }
+
+        [[nodiscard]] uint64_t hits() const { return hit_count; }
+        [[nodiscard]] uint64_t misses() const { return miss_count; }
+
+    private:
+        VkDevice                                         device {};
+        DescriptorAllocator*                             allocator = nullptr;
+        std::map<std::vector<uint64_t>, VkDescriptorSet> sets;
+        uint64_t                                         hit_count  = 0;
+        uint64_t                                         miss_count = 0;
+    };
+} // namespace vulkanDetails
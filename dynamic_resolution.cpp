@@ -0,0 +1,48 @@
+#include "dynamic_resolution.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace vulkanDetails
+{
+    void ResolutionController::init(double budget_ms, float min_render_scale, float max_render_scale)
+    {
+        if (budget_ms <= 0.0 || min_render_scale <= 0.0f || min_render_scale > max_render_scale)
+        {
+            throw std::invalid_argument("invalid dynamic resolution budget or scale range!");
+        }
+        target_ms     = budget_ms * HEADROOM;
+        min_scale     = min_render_scale;
+        max_scale     = max_render_scale;
+        current_scale = max_render_scale;
+        filtered_ms   = 0.0;
+    }
+
+    float ResolutionController::update(double gpu_ms)
+    {
+        if (gpu_ms <= 0.0)
+        {
+            return current_scale;
+        }
+        filtered_ms = filtered_ms == 0.0 ? gpu_ms : filtered_ms + (gpu_ms - filtered_ms) * SMOOTHING;
+        double ratio = target_ms / filtered_ms;
+        if (std::abs(ratio - 1.0) < DEADBAND)
+        {
+            return current_scale;
+        }
+        // time scales with the pixel count, so the linear scale moves with the square root
+        auto step     = static_cast<float>(std::sqrt(ratio));
+        step          = std::clamp(step, 1.0f - MAX_STEP, 1.0f + MAX_STEP);
+        current_scale = std::clamp(current_scale * step, min_scale, max_scale);
+        return current_scale;
+    }
+
+    VkExtent2D ResolutionController::scaledExtent(VkExtent2D full, float scale)
+    {
+        auto scaled = [scale](uint32_t size) {
+            auto even = static_cast<uint32_t>(static_cast<float>(size) * scale * 0.5f) * 2;
+            return std::clamp(even, 1u, size);
+        };
+        return {scaled(full.width), scaled(full.height)};
+    }
+} // namespace vulkanDetails
@@ -0,0 +1,34 @@
+#pragma once
+#include "vulkan/vulkan.h"
+
+namespace vulkanDetails
+{
+    // Picks the scale the scene is rendered at so the measured GPU frame time settles just under a budget.
+    //
+    // GPU time is smoothed over several frames and assumed to grow with the pixel count, i.e. with scale squared.
+    // Small deviations are ignored and each frame moves the scale by at most MAX_STEP, so one slow frame does not
+    // make the resolution jump and a frame time near the budget does not make it oscillate.
+    class ResolutionController
+    {
+    public:
+        static constexpr float  MAX_STEP  = 0.05f; // relative scale change per update
+        static constexpr double DEADBAND  = 0.05;  // relative frame time error that is left alone
+        static constexpr double SMOOTHING = 0.1;   // weight of the newest sample
+        static constexpr double HEADROOM  = 0.9;   // aim below the budget, spikes have to fit somewhere
+
+        void init(double budget_ms, float min_render_scale = 0.5f, float max_render_scale = 1.0f);
+        // Feeds the GPU time of one completed frame; returns the scale for the next one.
+        float update(double gpu_ms);
+
+        [[nodiscard]] float scale() const { return current_scale; }
+        // The full extent scaled down, at least 1x1 and rounded down to even sizes.
+        [[nodiscard]] static VkExtent2D scaledExtent(VkExtent2D full, float scale);
+
+    private:
+        double target_ms     = 0.0;
+        float  min_scale     = 0.5f;
+        float  max_scale     = 1.0f;
+        float  current_scale = 1.0f;
+        double filtered_ms   = 0.0;
+    };
+} // namespace vulkanDetails
@@ -0,0 +1,47 @@
+#include "fixed_timestep.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace vulkanDetails
+{
+    FixedTimestep::FixedTimestep(double steps_per_second, uint32_t max_steps_per_advance)
+        : step_seconds(0.0), max_steps(std::max(max_steps_per_advance, 1u))
+    {
+        setRate(steps_per_second);
+    }
+
+    void FixedTimestep::setRate(double steps_per_second)
+    {
+        if (steps_per_second <= 0.0)
+        {
+            throw std::invalid_argument("simulation rate must be positive!");
+        }
+        step_seconds = 1.0 / steps_per_second;
+        accumulator  = std::min(accumulator, step_seconds);
+    }
+
+    uint32_t FixedTimestep::advance(double elapsed_seconds)
+    {
+        accumulator += std::max(elapsed_seconds, 0.0);
+        uint32_t steps = 0;
+        while (accumulator >= step_seconds && steps < max_steps)
+        {
+            accumulator -= step_seconds;
+            steps++;
+        }
+        if (accumulator >= step_seconds)
+        {
+            // fell too far behind, keep the fraction so interpolation stays continuous
+            accumulator = std::fmod(accumulator, step_seconds);
+        }
+        step_count += steps;
+        return steps;
+    }
+
+    void FixedTimestep::reset()
+    {
+        accumulator = 0.0;
+        step_count  = 0;
+    }
+} // namespace vulkanDetails
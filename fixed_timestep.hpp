@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+
+namespace vulkanDetails
+{
+    // Accumulates real time and turns it into whole simulation steps of a fixed length, so simulation runs at the
+    // same rate no matter how fast frames are rendered. What is left over is exposed as alpha(), the fraction of a
+    // step the present lies past the last simulated state, for interpolating between the last two states.
+    class FixedTimestep
+    {
+    public:
+        // After a long stall (a breakpoint, a dragged window) at most max_steps are run and the rest is dropped,
+        // instead of spending ever longer catching up.
+        explicit FixedTimestep(double steps_per_second = 60.0, uint32_t max_steps_per_advance = 8);
+
+        void setRate(double steps_per_second);
+        // Adds elapsed real seconds; returns how many steps the caller has to simulate now.
+        uint32_t advance(double elapsed_seconds);
+        void     reset();
+
+        [[nodiscard]] double step() const { return step_seconds; }
+        [[nodiscard]] float  alpha() const { return static_cast<float>(accumulator / step_seconds); }
+        // Simulated seconds so far, including the fraction of the step in progress.
+        [[nodiscard]] double time() const { return static_cast<double>(step_count) * step_seconds + accumulator; }
+        [[nodiscard]] uint64_t steps() const { return step_count; }
+        // Real seconds that still have to be added before advance() returns a step.
+        [[nodiscard]] double untilNextStep() const { return step_seconds - accumulator; }
+
+    private:
+        double   step_seconds;
+        uint32_t max_steps;
+        double   accumulator = 0.0;
+        uint64_t step_count  = 0;
+    };
+} // namespace vulkanDetails
@@ -0,0 +1,42 @@
+#include "frame_limiter.hpp"
+#include <thread>
+
+namespace vulkanDetails
+{
+    void FrameLimiter::setTargetFps(double frames_per_second)
+    {
+        frame_interval = frames_per_second > 0.0
+                             ? std::chrono::duration_cast<Clock::duration>(
+                                   std::chrono::duration<double>(1.0 / frames_per_second))
+                             : Clock::duration::zero();
+        next_frame = {};
+    }
+
+    void FrameLimiter::wait()
+    {
+        if (!enabled())
+        {
+            return;
+        }
+        Clock::time_point now = Clock::now();
+        // after a stall (or on the first frame) start over from now instead of rushing to catch up
+        if (next_frame == Clock::time_point {} || now - next_frame > frame_interval)
+        {
+            next_frame = now;
+        }
+        next_frame += frame_interval;
+        while (now < next_frame)
+        {
+            Clock::duration remaining = next_frame - now;
+            if (remaining > SPIN_THRESHOLD)
+            {
+                std::this_thread::sleep_for(remaining - SPIN_THRESHOLD);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+            now = Clock::now();
+        }
+    }
+} // namespace vulkanDetails
@@ -0,0 +1,27 @@
+#pragma once
+#include <chrono>
+
+namespace vulkanDetails
+{
+    // Caps the frame rate by sleeping until the next frame is due. The OS sleep only covers all but the last
+    // SPIN_THRESHOLD of the wait, since it can overshoot by a scheduler tick; the rest is yielded away, which keeps
+    // frame pacing within a fraction of a millisecond without burning a whole core.
+    class FrameLimiter
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr std::chrono::microseconds SPIN_THRESHOLD {1500};
+
+        // 0 disables the limiter.
+        void setTargetFps(double frames_per_second);
+        // Call once per frame; returns when the next frame may start.
+        void wait();
+
+        [[nodiscard]] bool enabled() const { return frame_interval.count() > 0; }
+
+    private:
+        Clock::duration   frame_interval {};
+        Clock::time_point next_frame {};
+    };
+} // namespace vulkanDetails
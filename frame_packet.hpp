@@ -0,0 +1,64 @@
+#pragma once
+#include "frustum_culling.hpp"
+#include "vulkan/vulkan.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace vulkanDetails
+{
+    // Everything the render thread needs from one simulation step, so it never touches the SceneGraph while the
+    // event thread is updating it. Arrays are in scene slot order.
+    struct FramePacket
+    {
+        uint64_t               sequence        = 0;
+        float                  time            = 0.0f; // animation time in seconds
+        VkExtent2D             drawable_extent = {};   // window size in pixels, 0 while minimized
+        uint64_t               resize_sequence = 0;    // sequence of the packet built after the last resize event
+        uint32_t               quad_slot       = 0;
+        std::vector<glm::mat4> world_transforms;
+        std::vector<glm::vec4> local_bounds;
+        BoundingSpheres        world_bounds;
+    };
+
+    // Lock-free single-producer single-consumer triple buffer. The writer fills writeBuffer() and publishes it, the
+    // reader switches to the newest published buffer with acquire(); neither ever waits for the other, and stale
+    // buffers the reader skipped are simply reused.
+    template <typename T>
+    class TripleBuffer
+    {
+    public:
+        T&                     writeBuffer() { return buffers[write_index]; }
+        [[nodiscard]] const T& readBuffer() const { return buffers[read_index]; }
+
+        void publish()
+        {
+            // hand the written buffer over and continue with whichever one the reader is not holding
+            uint8_t previous = shared.exchange(static_cast<uint8_t>(write_index | FRESH), std::memory_order_acq_rel);
+            write_index      = previous & INDEX_MASK;
+        }
+
+        // Returns false, keeping the current read buffer, if nothing was published since the last call.
+        bool acquire()
+        {
+            if ((shared.load(std::memory_order_relaxed) & FRESH) == 0)
+            {
+                return false;
+            }
+            uint8_t previous = shared.exchange(read_index, std::memory_order_acq_rel);
+            read_index       = previous & INDEX_MASK;
+            return true;
+        }
+
+    private:
+        static constexpr uint8_t INDEX_MASK = 0x3;
+        static constexpr uint8_t FRESH      = 0x4;
+
+        std::array<T, 3>     buffers;
+        uint8_t              write_index = 0;
+        uint8_t              read_index  = 1;
+        std::atomic<uint8_t> shared {2}; // index of the buffer in between, FRESH once published and not yet read
+    };
+} // namespace vulkanDetails
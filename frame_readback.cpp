@@ -0,0 +1,264 @@
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "frame_readback.hpp"
+#include "barrier_batch.hpp"
+#include "vulkan_util.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <stb/stb_image_write.h>
+#include <stdexcept>
+
+namespace vulkanDetails
+{
+    void FrameReadback::init(const CaptureOptions& capture_options, uint32_t frames_in_flight)
+    {
+        options = capture_options;
+        if (options.format == CaptureFormat::None)
+        {
+            return;
+        }
+        uint32_t writer_count = 1;
+        if (options.format == CaptureFormat::Png)
+        {
+            // encoding is the slow part and frames go to separate files, so they can be written out of order
+            writer_count = std::max(ThreadPool::defaultThreadCount() / 2, 1u);
+            std::filesystem::create_directories(options.path);
+        }
+        else if (options.path == "-")
+        {
+            stream = stdout;
+        }
+        else
+        {
+            stream = std::fopen(options.path.c_str(), "wb");
+            if (stream == nullptr)
+            {
+                throw std::runtime_error("failed to open capture stream!");
+            }
+        }
+        // the GPU fills up to frames_in_flight slots while every writer holds one more
+        slot_count = frames_in_flight + writer_count;
+        writers    = std::make_unique<ThreadPool>(writer_count);
+    }
+
+    void FrameReadback::resize(GpuDevice& gpu, VkDevice device, VkExtent2D image_extent, VkFormat image_format)
+    {
+        if (options.format == CaptureFormat::None)
+        {
+            return;
+        }
+        switch (image_format)
+        {
+            case VK_FORMAT_B8G8R8A8_UNORM:
+            case VK_FORMAT_B8G8R8A8_SRGB:
+                swap_red_blue = true;
+                break;
+            case VK_FORMAT_R8G8B8A8_UNORM:
+            case VK_FORMAT_R8G8B8A8_SRGB:
+                swap_red_blue = false;
+                break;
+            default:
+                throw std::runtime_error("unsupported image format for frame readback!");
+        }
+        waitIdle();
+        destroySlots(device);
+
+        extent            = image_extent;
+        VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+        slots.resize(slot_count);
+        for (auto& slot : slots)
+        {
+            try
+            {
+                // the CPU reads every byte, which is painfully slow from uncached memory
+                gpu.createBuffer(size,
+                                  VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+                                      VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+                                  slot.buffer,
+                                  slot.memory);
+            }
+            catch (const std::runtime_error&)
+            {
+                vkDestroyBuffer(device, slot.buffer, nullptr);
+                gpu.createBuffer(size,
+                                  VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                  slot.buffer,
+                                  slot.memory);
+            }
+            void* mapped;
+            vkMapMemory(device, slot.memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+            slot.mapped = static_cast<const uint8_t*>(mapped);
+        }
+        next_slot = 0;
+    }
+
+    void FrameReadback::cleanup(VkDevice device)
+    {
+        if (options.format == CaptureFormat::None)
+        {
+            return;
+        }
+        waitIdle();
+        writers.reset();
+        destroySlots(device);
+        if (stream != nullptr && stream != stdout)
+        {
+            std::fclose(stream);
+        }
+        stream = nullptr;
+    }
+
+    ReadbackStats FrameReadback::getStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    void FrameReadback::recordCopy(VkCommandBuffer command_buffer, VkImage image, uint64_t frame)
+    {
+        Slot* slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            slot = &slots[next_slot];
+            if (slot->state == SlotState::Recorded)
+            {
+                // waiting here would never end, only collect() on this thread can move it on
+                throw std::runtime_error("frame readback slot reused before its frame was collected!");
+            }
+            if (slot->state == SlotState::Writing)
+            {
+                stats.stalls++;
+                slot_freed.wait(lock, [slot] { return slot->state == SlotState::Free; });
+            }
+            slot->state = SlotState::Recorded;
+            slot->frame = frame;
+            slot->index = capture_count++;
+            stats.captured++;
+        }
+        next_slot = (next_slot + 1) % slot_count;
+
+        VkBufferImageCopy region {};
+        region.bufferOffset      = 0;
+        region.bufferRowLength   = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource  = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageOffset       = {0, 0, 0};
+        region.imageExtent       = {extent.width, extent.height, 1};
+        vkCmdCopyImageToBuffer(
+            command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->buffer, 1, &region);
+
+        // makes the copy visible to the host once the fence of this frame has signaled
+        BarrierBatch barriers;
+        barriers.bufferBarrier(slot->buffer,
+                               0,
+                               VK_WHOLE_SIZE,
+                               VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               VK_ACCESS_TRANSFER_WRITE_BIT,
+                               VK_PIPELINE_STAGE_HOST_BIT,
+                               VK_ACCESS_HOST_READ_BIT);
+        barriers.record(command_buffer);
+    }
+
+    void FrameReadback::collect(uint64_t completed_frame)
+    {
+        if (options.format == CaptureFormat::None)
+        {
+            return;
+        }
+        std::vector<Slot*> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& slot : slots)
+            {
+                if (slot.state == SlotState::Recorded && slot.frame <= completed_frame)
+                {
+                    slot.state = SlotState::Writing;
+                    ready.push_back(&slot);
+                }
+            }
+        }
+        // a single raw writer runs its tasks in submission order, which keeps the stream in frame order
+        std::sort(ready.begin(), ready.end(), [](const Slot* a, const Slot* b) { return a->index < b->index; });
+        for (Slot* slot : ready)
+        {
+            writers->submit([this, slot] {
+                write(*slot);
+                std::lock_guard<std::mutex> lock(mutex);
+                slot->state = SlotState::Free;
+                stats.written++;
+                slot_freed.notify_all();
+            });
+        }
+    }
+
+    void FrameReadback::waitIdle()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        slot_freed.wait(lock, [this] {
+            return std::none_of(
+                slots.begin(), slots.end(), [](const Slot& slot) { return slot.state == SlotState::Writing; });
+        });
+    }
+
+    void FrameReadback::destroySlots(VkDevice device)
+    {
+        for (auto& slot : slots)
+        {
+            vkDestroyBuffer(device, slot.buffer, nullptr);
+            vkFreeMemory(device, slot.memory, nullptr);
+        }
+        slots.clear();
+    }
+
+    void FrameReadback::write(const Slot& slot)
+    {
+        // swapchain alpha is whatever the blend left behind, force it opaque so captures compare byte for byte
+        size_t                            pixel_count = static_cast<size_t>(extent.width) * extent.height;
+        thread_local std::vector<uint8_t> pixels;
+        pixels.resize(pixel_count * 4);
+        const uint8_t* source = slot.mapped;
+        uint8_t*       target = pixels.data();
+        for (size_t i = 0; i < pixel_count; i++, source += 4, target += 4)
+        {
+            target[0] = swap_red_blue ? source[2] : source[0];
+            target[1] = source[1];
+            target[2] = swap_red_blue ? source[0] : source[2];
+            target[3] = 255;
+        }
+
+        if (options.format == CaptureFormat::Raw)
+        {
+            if (std::fwrite(pixels.data(), 1, pixels.size(), stream) != pixels.size())
+            {
+                std::fprintf(
+                    stderr, "failed to write captured frame %llu\n", static_cast<unsigned long long>(slot.index));
+            }
+            // whoever reads the other end of a pipe should see whole frames as soon as they are done
+            std::fflush(stream);
+        }
+        else if (options.format == CaptureFormat::Sink)
+        {
+            if (sink)
+            {
+                sink(slot.index, pixels.data(), extent);
+            }
+        }
+        else
+        {
+            char file_name[32];
+            std::snprintf(
+                file_name, sizeof(file_name), "frame_%06llu.png", static_cast<unsigned long long>(slot.index));
+            std::string file_path = (std::filesystem::path(options.path) / file_name).string();
+            if (stbi_write_png(file_path.c_str(),
+                               static_cast<int>(extent.width),
+                               static_cast<int>(extent.height),
+                               4,
+                               pixels.data(),
+                               static_cast<int>(extent.width * 4)) == 0)
+            {
+                std::fprintf(stderr, "failed to write %s\n", file_path.c_str());
+            }
+        }
+    }
+} // namespace vulkanDetails
@@ -0,0 +1,109 @@
+#pragma once
+#include "thread_pool.hpp"
+#include "vulkan/vulkan.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vulkanDetails
+{
+    class GpuDevice;
+
+    enum class CaptureFormat
+    {
+        None,
+        Png,  // one file per frame: <path>/frame_000000.png
+        Raw,  // tightly packed RGBA8 frames appended to <path>; "-" is stdout, a FIFO works as well
+        Sink, // handed to the function set with FrameReadback::setSink, in frame order
+    };
+
+    struct CaptureOptions
+    {
+        CaptureFormat format     = CaptureFormat::None;
+        std::string   path;
+        uint32_t      max_frames = 0; // 0 captures every frame
+    };
+
+    struct ReadbackStats
+    {
+        uint64_t captured = 0; // frames whose copy was recorded
+        uint64_t written  = 0; // frames the writer has finished with
+        uint64_t stalls   = 0; // times recording waited for the writer to free a slot
+    };
+
+    // Copies rendered frames into a ring of persistently mapped host buffers and hands them to writer threads once
+    // the frame that filled them has completed, so reading pixels back never waits on the GPU.
+    //
+    // The copy is tagged with the same frame value as DeletionQueue requests; collect() with the last completed frame
+    // passes finished slots on. Raw streams keep frame order with a single writer, PNG files are encoded in parallel.
+    class FrameReadback
+    {
+    public:
+        // Called on the writer thread with tightly packed RGBA8 pixels that are only valid during the call.
+        using SinkFn = std::function<void(uint64_t index, const uint8_t* pixels, VkExtent2D extent)>;
+
+        // frames_in_flight decides how many slots the GPU can fill before collect() frees the first one.
+        void init(const CaptureOptions& capture_options, uint32_t frames_in_flight);
+        // (Re)creates the ring for a new swapchain; waits for the writer to finish with the old one.
+        void resize(GpuDevice& gpu, VkDevice device, VkExtent2D image_extent, VkFormat image_format);
+        void cleanup(VkDevice device);
+
+        void setSink(SinkFn sink_fn) { sink = std::move(sink_fn); }
+        // While paused no copies are recorded, e.g. to keep readback out of a timing measurement.
+        void setPaused(bool pause) { paused = pause; }
+
+        [[nodiscard]] bool active() const { return options.format != CaptureFormat::None && !paused && !finished(); }
+        [[nodiscard]] ReadbackStats getStats();
+
+        // Records the copy of image (in TRANSFER_SRC_OPTIMAL) into a free slot, waiting for one if the writer is
+        // behind.
+        void recordCopy(VkCommandBuffer command_buffer, VkImage image, uint64_t frame);
+        // Queues every slot filled by a frame <= completed_frame for writing.
+        void collect(uint64_t completed_frame);
+        // Waits until the writer is done with every collected slot.
+        void waitIdle();
+
+    private:
+        enum class SlotState
+        {
+            Free,
+            Recorded, // waiting for its frame to complete
+            Writing,
+        };
+
+        struct Slot
+        {
+            VkBuffer       buffer {};
+            VkDeviceMemory memory {};
+            const uint8_t* mapped = nullptr;
+            SlotState      state  = SlotState::Free;
+            uint64_t       frame  = 0;
+            uint64_t       index  = 0; // capture number, names the PNG file
+        };
+
+        [[nodiscard]] bool finished() const { return options.max_frames != 0 && capture_count >= options.max_frames; }
+        void               destroySlots(VkDevice device);
+        void               write(const Slot& slot);
+
+        CaptureOptions              options;
+        uint32_t                    slot_count = 0;
+        std::vector<Slot>           slots;
+        uint32_t                    next_slot = 0;
+        VkExtent2D                  extent {};
+        bool                        swap_red_blue = false;
+        uint64_t                    capture_count = 0;
+        std::FILE*                  stream        = nullptr;
+        SinkFn                      sink;
+        bool                        paused        = false;
+        std::unique_ptr<ThreadPool> writers;
+        std::mutex                  mutex;
+        std::condition_variable     slot_freed;
+        ReadbackStats               stats;
+    };
+} // namespace vulkanDetails
@@ -0,0 +1,216 @@
+#include "frustum_culling.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace vulkanDetails
+{
+    namespace
+    {
+        void appendMaskBits(uint32_t mask, uint32_t base, uint32_t* out_indices, uint32_t& count)
+        {
+            while (mask != 0)
+            {
+                out_indices[count++] = base + static_cast<uint32_t>(std::countr_zero(mask));
+                mask &= mask - 1;
+            }
+        }
+
+        uint32_t cullScalar(const Frustum&         frustum,
+                            const BoundingSpheres& bounds,
+                            uint32_t               begin,
+                            uint32_t               end,
+                            uint32_t*              out_indices)
+        {
+            uint32_t count = 0;
+            for (uint32_t i = begin; i < end; i++)
+            {
+                glm::vec3 center {bounds.center_x[i], bounds.center_y[i], bounds.center_z[i]};
+                if (frustum.intersectsSphere(center, bounds.radius[i]))
+                {
+                    out_indices[count++] = i;
+                }
+            }
+            return count;
+        }
+
+#if defined(__AVX2__)
+        uint32_t cullAvx2(const Frustum&         frustum,
+                          const BoundingSpheres& bounds,
+                          uint32_t               begin,
+                          uint32_t               end,
+                          uint32_t*              out_indices)
+        {
+            __m256 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+            for (int p = 0; p < 6; p++)
+            {
+                plane_x[p] = _mm256_set1_ps(frustum.planes[p].x);
+                plane_y[p] = _mm256_set1_ps(frustum.planes[p].y);
+                plane_z[p] = _mm256_set1_ps(frustum.planes[p].z);
+                plane_w[p] = _mm256_set1_ps(frustum.planes[p].w);
+            }
+            const __m256 zero  = _mm256_setzero_ps();
+            uint32_t     count = 0;
+            uint32_t     i     = begin;
+            for (; i + 8 <= end; i += 8)
+            {
+                __m256 cx     = _mm256_loadu_ps(&bounds.center_x[i]);
+                __m256 cy     = _mm256_loadu_ps(&bounds.center_y[i]);
+                __m256 cz     = _mm256_loadu_ps(&bounds.center_z[i]);
+                __m256 r      = _mm256_loadu_ps(&bounds.radius[i]);
+                __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (int p = 0; p < 6; p++)
+                {
+                    __m256 dist = _mm256_add_ps(_mm256_mul_ps(plane_x[p], cx), plane_w[p]);
+                    dist        = _mm256_add_ps(dist, _mm256_mul_ps(plane_y[p], cy));
+                    dist        = _mm256_add_ps(dist, _mm256_mul_ps(plane_z[p], cz));
+                    inside      = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(dist, r), zero, _CMP_GE_OQ));
+                }
+                appendMaskBits(static_cast<uint32_t>(_mm256_movemask_ps(inside)), i, out_indices, count);
+            }
+            return count + cullScalar(frustum, bounds, i, end, out_indices + count);
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        uint32_t cullSse(const Frustum&         frustum,
+                         const BoundingSpheres& bounds,
+                         uint32_t               begin,
+                         uint32_t               end,
+                         uint32_t*              out_indices)
+        {
+            __m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+            for (int p = 0; p < 6; p++)
+            {
+                plane_x[p] = _mm_set1_ps(frustum.planes[p].x);
+                plane_y[p] = _mm_set1_ps(frustum.planes[p].y);
+                plane_z[p] = _mm_set1_ps(frustum.planes[p].z);
+                plane_w[p] = _mm_set1_ps(frustum.planes[p].w);
+            }
+            const __m128 zero  = _mm_setzero_ps();
+            uint32_t     count = 0;
+            uint32_t     i     = begin;
+            for (; i + 4 <= end; i += 4)
+            {
+                __m128 cx     = _mm_loadu_ps(&bounds.center_x[i]);
+                __m128 cy     = _mm_loadu_ps(&bounds.center_y[i]);
+                __m128 cz     = _mm_loadu_ps(&bounds.center_z[i]);
+                __m128 r      = _mm_loadu_ps(&bounds.radius[i]);
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (int p = 0; p < 6; p++)
+                {
+                    __m128 dist = _mm_add_ps(_mm_mul_ps(plane_x[p], cx), plane_w[p]);
+                    dist        = _mm_add_ps(dist, _mm_mul_ps(plane_y[p], cy));
+                    dist        = _mm_add_ps(dist, _mm_mul_ps(plane_z[p], cz));
+                    inside      = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, r), zero));
+                }
+                appendMaskBits(static_cast<uint32_t>(_mm_movemask_ps(inside)), i, out_indices, count);
+            }
+            return count + cullScalar(frustum, bounds, i, end, out_indices + count);
+        }
+#endif
+    } // namespace
+
+    Frustum Frustum::fromMatrix(const glm::mat4& view_proj)
+    {
+        // Gribb/Hartmann: glm is column major, so row r of the matrix is (m[0][r], m[1][r], m[2][r], m[3][r])
+        auto row = [&view_proj](int r) {
+            return glm::vec4(view_proj[0][r], view_proj[1][r], view_proj[2][r], view_proj[3][r]);
+        };
+        Frustum frustum {};
+        frustum.planes[0] = row(3) + row(0); // left
+        frustum.planes[1] = row(3) - row(0); // right
+        frustum.planes[2] = row(3) + row(1); // bottom
+        frustum.planes[3] = row(3) - row(1); // top
+        frustum.planes[4] = row(3) + row(2); // near
+        frustum.planes[5] = row(3) - row(2); // far
+        for (auto& plane : frustum.planes)
+        {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        return frustum;
+    }
+
+    bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const
+    {
+        for (const auto& plane : planes)
+        {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    FrustumCuller::Kernel FrustumCuller::activeKernel()
+    {
+#if defined(__AVX2__)
+        return Kernel::AVX2;
+#elif defined(__SSE2__) || defined(_M_X64)
+        return Kernel::SSE;
+#else
+        return Kernel::Scalar;
+#endif
+    }
+
+    uint32_t FrustumCuller::cullRange(const Frustum&         frustum,
+                                      const BoundingSpheres& bounds,
+                                      uint32_t               begin,
+                                      uint32_t               end,
+                                      uint32_t*              out_indices)
+    {
+#if defined(__AVX2__)
+        return cullAvx2(frustum, bounds, begin, end, out_indices);
+#elif defined(__SSE2__) || defined(_M_X64)
+        return cullSse(frustum, bounds, begin, end, out_indices);
+#else
+        return cullScalar(frustum, bounds, begin, end, out_indices);
+#endif
+    }
+
+    void FrustumCuller::cull(const Frustum&         frustum,
+                             const BoundingSpheres& bounds,
+                             std::vector<uint32_t>& visible,
+                             ThreadPool*            pool)
+    {
+        auto object_count = static_cast<uint32_t>(bounds.size());
+        if (pool == nullptr || object_count <= CHUNK_SIZE)
+        {
+            visible.resize(object_count);
+            visible.resize(cullRange(frustum, bounds, 0, object_count, visible.data()));
+            return;
+        }
+
+        // pass 1: every chunk culls into its own slice of scratch, pass 2: chunks are packed using a prefix sum
+        uint32_t chunk_count = (object_count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        scratch.resize(object_count);
+        chunk_counts.resize(chunk_count);
+        chunk_offsets.resize(chunk_count);
+        pool->parallelFor(chunk_count, [&](uint32_t chunk) {
+            uint32_t begin      = chunk * CHUNK_SIZE;
+            uint32_t end        = std::min(begin + CHUNK_SIZE, object_count);
+            chunk_counts[chunk] = cullRange(frustum, bounds, begin, end, scratch.data() + begin);
+        });
+
+        uint32_t total = 0;
+        for (uint32_t chunk = 0; chunk < chunk_count; chunk++)
+        {
+            chunk_offsets[chunk] = total;
+            total += chunk_counts[chunk];
+        }
+        visible.resize(total);
+        pool->parallelFor(chunk_count, [&](uint32_t chunk) {
+            if (chunk_counts[chunk] > 0)
+            {
+                std::memcpy(visible.data() + chunk_offsets[chunk],
+                            scratch.data() + chunk * CHUNK_SIZE,
+                            chunk_counts[chunk] * sizeof(uint32_t));
+            }
+        });
+    }
+} // namespace vulkanDetails
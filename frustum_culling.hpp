@@ -0,0 +1,74 @@
+#pragma once
+#include "thread_pool.hpp"
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace vulkanDetails
+{
+    // World-space bounding spheres in structure-of-arrays form so the culling kernels can load 4/8 objects per register.
+    struct BoundingSpheres
+    {
+        std::vector<float> center_x;
+        std::vector<float> center_y;
+        std::vector<float> center_z;
+        std::vector<float> radius;
+
+        void push(const glm::vec3& center, float r)
+        {
+            center_x.push_back(center.x);
+            center_y.push_back(center.y);
+            center_z.push_back(center.z);
+            radius.push_back(r);
+        }
+        void resize(size_t count)
+        {
+            center_x.resize(count);
+            center_y.resize(count);
+            center_z.resize(count);
+            radius.resize(count);
+        }
+        void clear() { resize(0); }
+        [[nodiscard]] size_t size() const { return radius.size(); }
+    };
+
+    // Six normalized planes (xyz = inward normal, w = distance) extracted from a view-projection matrix.
+    // The left/right/top/bottom planes are the viewport edges, near/far follow glm's default -1..1 clip depth.
+    struct Frustum
+    {
+        std::array<glm::vec4, 6> planes;
+
+        static Frustum fromMatrix(const glm::mat4& view_proj);
+        [[nodiscard]] bool intersectsSphere(const glm::vec3& center, float radius) const;
+    };
+
+    class FrustumCuller
+    {
+    public:
+        enum class Kernel
+        {
+            Scalar,
+            SSE,
+            AVX2,
+        };
+
+        // Objects per work item handed to the pool; large enough to amortize scheduling, small enough to balance.
+        static constexpr uint32_t CHUNK_SIZE = 16384;
+
+        // Writes the indices of all spheres that touch the frustum to visible, in ascending order.
+        void cull(const Frustum& frustum, const BoundingSpheres& bounds, std::vector<uint32_t>& visible, ThreadPool* pool);
+
+        static Kernel   activeKernel();
+        static uint32_t cullRange(const Frustum& frustum,
+                                  const BoundingSpheres& bounds,
+                                  uint32_t               begin,
+                                  uint32_t               end,
+                                  uint32_t*              out_indices);
+
+    private:
+        std::vector<uint32_t> scratch;
+        std::vector<uint32_t> chunk_counts;
+        std::vector<uint32_t> chunk_offsets;
+    };
+} // namespace vulkanDetails
@@ -0,0 +1,260 @@
+#include "gpu_culling.hpp"
+#include "barrier_batch.hpp"
+#include "vulkan_util.hpp"
+#include <array>
+#include <stdexcept>
+
+namespace vulkanDetails
+{
+    constexpr uint32_t CULL_GROUP_SIZE = 64;
+
+    void GpuCuller::init(GpuDevice&  gpu,
+                         VkDevice    device,
+                         uint32_t    max_object_count,
+                         uint32_t    frame_count,
+                         bool        draw_indirect_count,
+                         bool        multi_draw_indirect)
+    {
+        max_objects    = max_object_count;
+        use_draw_count = draw_indirect_count;
+        use_multi_draw = multi_draw_indirect;
+        if (use_draw_count)
+        {
+            draw_indexed_indirect_count = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+                vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+            use_draw_count = draw_indexed_indirect_count != nullptr;
+        }
+
+        object_buffers.resize(frame_count);
+        object_buffers_memory.resize(frame_count);
+        object_buffers_mapped.resize(frame_count);
+        object_counts.assign(frame_count, 0);
+        draw_buffers.resize(frame_count);
+        draw_buffers_memory.resize(frame_count);
+        count_buffers.resize(frame_count);
+        count_buffers_memory.resize(frame_count);
+        for (uint32_t i = 0; i < frame_count; i++)
+        {
+            // objects are rewritten by the CPU every frame, so they stay host visible and persistently mapped
+            gpu.createBuffer(sizeof(GpuObject) * max_objects,
+                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                              object_buffers[i],
+                              object_buffers_memory[i]);
+            vkMapMemory(device, object_buffers_memory[i], 0, VK_WHOLE_SIZE, 0, &object_buffers_mapped[i]);
+            gpu.createBuffer(sizeof(VkDrawIndexedIndirectCommand) * max_objects,
+                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                              draw_buffers[i],
+                              draw_buffers_memory[i]);
+            gpu.createBuffer(sizeof(uint32_t),
+                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                  VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                              count_buffers[i],
+                              count_buffers_memory[i]);
+        }
+        createDescriptors(device);
+        createComputePipeline(gpu, device);
+    }
+
+    void GpuCuller::createDescriptors(VkDevice device)
+    {
+        // binding 0 is also read by shader_indirect.vert (as set 1) to fetch the per-instance model matrix
+        std::array<VkDescriptorSetLayoutBinding, 3> bindings {};
+        for (uint32_t i = 0; i < bindings.size(); i++)
+        {
+            bindings[i].binding         = i;
+            bindings[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        bindings[0].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+
+        VkDescriptorSetLayoutCreateInfo layout_info {};
+        layout_info.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+        layout_info.pBindings    = bindings.data();
+        if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &set_layout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create culling descriptor set layout!");
+        }
+
+        auto                 frame_count = static_cast<uint32_t>(object_buffers.size());
+        VkDescriptorPoolSize pool_size {};
+        pool_size.type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        pool_size.descriptorCount = frame_count * static_cast<uint32_t>(bindings.size());
+
+        VkDescriptorPoolCreateInfo pool_info {};
+        pool_info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.poolSizeCount = 1;
+        pool_info.pPoolSizes    = &pool_size;
+        pool_info.maxSets       = frame_count;
+        if (vkCreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create culling descriptor pool!");
+        }
+
+        std::vector<VkDescriptorSetLayout> layouts(frame_count, set_layout);
+        VkDescriptorSetAllocateInfo        alloc_info {};
+        alloc_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.descriptorPool     = descriptor_pool;
+        alloc_info.descriptorSetCount = frame_count;
+        alloc_info.pSetLayouts        = layouts.data();
+        descriptor_sets.resize(frame_count);
+        if (vkAllocateDescriptorSets(device, &alloc_info, descriptor_sets.data()) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate culling descriptor sets!");
+        }
+
+        for (uint32_t i = 0; i < frame_count; i++)
+        {
+            std::array<VkDescriptorBufferInfo, 3> buffer_infos {};
+            buffer_infos[0] = {object_buffers[i], 0, VK_WHOLE_SIZE};
+            buffer_infos[1] = {draw_buffers[i], 0, VK_WHOLE_SIZE};
+            buffer_infos[2] = {count_buffers[i], 0, VK_WHOLE_SIZE};
+
+            std::array<VkWriteDescriptorSet, 3> writes {};
+            for (uint32_t binding = 0; binding < writes.size(); binding++)
+            {
+                writes[binding].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                writes[binding].dstSet          = descriptor_sets[i];
+                writes[binding].dstBinding      = binding;
+                writes[binding].descriptorCount = 1;
+                writes[binding].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                writes[binding].pBufferInfo     = &buffer_infos[binding];
+            }
+            vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        }
+    }
+
+    void GpuCuller::createComputePipeline(GpuDevice& gpu, VkDevice device)
+    {
+        VkPushConstantRange push_constant_range {};
+        push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        push_constant_range.offset     = 0;
+        push_constant_range.size       = sizeof(GpuCullParams);
+
+        VkPipelineLayoutCreateInfo pipeline_layout_info {};
+        pipeline_layout_info.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipeline_layout_info.setLayoutCount         = 1;
+        pipeline_layout_info.pSetLayouts            = &set_layout;
+        pipeline_layout_info.pushConstantRangeCount = 1;
+        pipeline_layout_info.pPushConstantRanges    = &push_constant_range;
+        if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create culling pipeline layout!");
+        }
+
+        auto           compute_shader_code   = readFile("../shader/cull_comp.spv");
+        VkShaderModule compute_shader_module = gpu.createShaderModule(compute_shader_code);
+
+        VkComputePipelineCreateInfo pipeline_info {};
+        pipeline_info.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipeline_info.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipeline_info.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipeline_info.stage.module = compute_shader_module;
+        pipeline_info.stage.pName  = "main";
+        pipeline_info.layout       = pipeline_layout;
+        if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create culling pipeline!");
+        }
+        vkDestroyShaderModule(device, compute_shader_module, nullptr);
+    }
+
+    void GpuCuller::cleanup(VkDevice device) const
+    {
+        vkDestroyPipeline(device, pipeline, nullptr);
+        vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+        vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+        vkDestroyDescriptorSetLayout(device, set_layout, nullptr);
+        for (size_t i = 0; i < object_buffers.size(); i++)
+        {
+            vkDestroyBuffer(device, object_buffers[i], nullptr);
+            vkFreeMemory(device, object_buffers_memory[i], nullptr);
+            vkDestroyBuffer(device, draw_buffers[i], nullptr);
+            vkFreeMemory(device, draw_buffers_memory[i], nullptr);
+            vkDestroyBuffer(device, count_buffers[i], nullptr);
+            vkFreeMemory(device, count_buffers_memory[i], nullptr);
+        }
+    }
+
+    GpuObject* GpuCuller::mapObjects(uint32_t frame, uint32_t count)
+    {
+        if (count > max_objects)
+        {
+            throw std::runtime_error("too many objects for the gpu culling buffers!");
+        }
+        object_counts[frame] = count;
+        return static_cast<GpuObject*>(object_buffers_mapped[frame]);
+    }
+
+    void GpuCuller::recordCull(VkCommandBuffer command_buffer,
+                               uint32_t        frame,
+                               const Frustum&  frustum,
+                               uint32_t        index_count)
+    {
+        vkCmdFillBuffer(command_buffer, count_buffers[frame], 0, sizeof(uint32_t), 0);
+
+        BarrierBatch barriers;
+        barriers.bufferBarrier(count_buffers[frame],
+                               0,
+                               VK_WHOLE_SIZE,
+                               VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               VK_ACCESS_TRANSFER_WRITE_BIT,
+                               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+        barriers.flush(command_buffer);
+
+        GpuCullParams params {};
+        for (int i = 0; i < 6; i++)
+        {
+            params.planes[i] = frustum.planes[i];
+        }
+        params.object_count = object_counts[frame];
+        params.index_count  = index_count;
+        params.compact      = use_draw_count ? 1 : 0;
+
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        vkCmdBindDescriptorSets(
+            command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0, 1, &descriptor_sets[frame], 0, nullptr);
+        vkCmdPushConstants(
+            command_buffer, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GpuCullParams), &params);
+        vkCmdDispatch(command_buffer, (object_counts[frame] + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+        for (VkBuffer buffer : {draw_buffers[frame], count_buffers[frame]})
+        {
+            barriers.bufferBarrier(buffer,
+                                   0,
+                                   VK_WHOLE_SIZE,
+                                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                   VK_ACCESS_SHADER_WRITE_BIT,
+                                   VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                                   VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+        }
+        barriers.flush(command_buffer);
+    }
+
+    void GpuCuller::recordDraws(VkCommandBuffer command_buffer, uint32_t frame) const
+    {
+        constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+        if (use_draw_count)
+        {
+            draw_indexed_indirect_count(
+                command_buffer, draw_buffers[frame], 0, count_buffers[frame], 0, object_counts[frame], stride);
+        }
+        else if (use_multi_draw)
+        {
+            // without a count buffer every object keeps its slot and culled ones carry instanceCount = 0
+            vkCmdDrawIndexedIndirect(command_buffer, draw_buffers[frame], 0, object_counts[frame], stride);
+        }
+        else
+        {
+            for (uint32_t i = 0; i < object_counts[frame]; i++)
+            {
+                vkCmdDrawIndexedIndirect(command_buffer, draw_buffers[frame], static_cast<VkDeviceSize>(i) * stride, 1, stride);
+            }
+        }
+    }
+} // namespace vulkanDetails
@@ -0,0 +1,71 @@
+#pragma once
+#include "frustum_culling.hpp"
+#include "vulkan/vulkan.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace vulkanDetails
+{
+    class GpuDevice;
+
+    // Per-object record shared by cull.comp and shader_indirect.vert (std430, 80 bytes).
+    struct GpuObject
+    {
+        glm::mat4 model;
+        glm::vec4 bounds; // model-space bounding sphere: xyz = center, w = radius
+    };
+
+    struct GpuCullParams
+    {
+        glm::vec4 planes[6];
+        uint32_t  object_count;
+        uint32_t  index_count;
+        uint32_t  compact;
+    };
+
+    // Frustum culls GpuObjects in a compute pass and turns the survivors into VkDrawIndexedIndirectCommands,
+    // so recording a frame costs the same no matter how many objects there are.
+    class GpuCuller
+    {
+    public:
+        void init(GpuDevice&  gpu,
+                  VkDevice    device,
+                  uint32_t    max_object_count,
+                  uint32_t    frame_count,
+                  bool        draw_indirect_count,
+                  bool        multi_draw_indirect);
+        void cleanup(VkDevice device) const;
+
+        // Returns the persistently mapped object buffer of frame, sized for count objects; fill it before recordCull.
+        GpuObject* mapObjects(uint32_t frame, uint32_t count);
+        // Must be recorded outside of a render pass; recordDraws consumes its output inside the pass.
+        void recordCull(VkCommandBuffer command_buffer, uint32_t frame, const Frustum& frustum, uint32_t index_count);
+        void recordDraws(VkCommandBuffer command_buffer, uint32_t frame) const;
+
+        [[nodiscard]] VkDescriptorSetLayout getSetLayout() const { return set_layout; }
+        [[nodiscard]] VkDescriptorSet       getDescriptorSet(uint32_t frame) const { return descriptor_sets[frame]; }
+
+    private:
+        void createDescriptors(VkDevice device);
+        void createComputePipeline(GpuDevice& gpu, VkDevice device);
+
+        uint32_t                             max_objects = 0;
+        bool                                 use_draw_count = false;
+        bool                                 use_multi_draw = false;
+        PFN_vkCmdDrawIndexedIndirectCountKHR draw_indexed_indirect_count = nullptr;
+        VkDescriptorSetLayout                set_layout {};
+        VkDescriptorPool                     descriptor_pool {};
+        std::vector<VkDescriptorSet>         descriptor_sets;
+        VkPipelineLayout                     pipeline_layout {};
+        VkPipeline                           pipeline {};
+        std::vector<VkBuffer>                object_buffers;
+        std::vector<VkDeviceMemory>          object_buffers_memory;
+        std::vector<void*>                   object_buffers_mapped;
+        std::vector<uint32_t>                object_counts;
+        std::vector<VkBuffer>                draw_buffers;
+        std::vector<VkDeviceMemory>          draw_buffers_memory;
+        std::vector<VkBuffer>                count_buffers;
+        std::vector<VkDeviceMemory>          count_buffers_memory;
+    };
+} // namespace vulkanDetails
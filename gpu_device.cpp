@@ -0,0 +1,927 @@
+#include "gpu_device.hpp"
+#include "barrier_batch.hpp"
+#include "window_surface.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+namespace vulkanDetails
+{
+    constexpr uint32_t     PIPELINE_COMPILE_THREADS = 2;
+    constexpr VkDeviceSize STAGING_RING_SIZE        = 16 * 1024 * 1024;
+    // device index or part of its name, used when pickPhysicalDevice gets no preference
+    constexpr const char* GPU_PREFERENCE_ENV = "RENDERER_GPU";
+
+    const std::vector<const char*> validation_layers = {
+        "VK_LAYER_KHRONOS_validation",
+    };
+    const std::vector<const char*> device_extensions = {
+        VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+    };
+#ifdef NOEBUG
+    constexpr bool enable_validation_layers = false;
+#else
+    constexpr bool enable_validation_layers = true;
+#endif
+
+    namespace
+    {
+        VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback([[maybe_unused]] VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+                                                     [[maybe_unused]] VkDebugUtilsMessageTypeFlagsEXT        type,
+                                                     const VkDebugUtilsMessengerCallbackDataEXT*             data,
+                                                     [[maybe_unused]] void*                                  user_data)
+        {
+            std::cerr << "validation layer: " << data->pMessage << std::endl;
+            return VK_FALSE;
+        }
+    } // namespace
+
+    void GpuDevice::createInstance(std::vector<const char*> extensions)
+    {
+        // vkEnumerateInstanceVersion only exists from 1.1 on, a 1.0 loader cannot be asked for more
+        auto enumerate_version = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+            vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion"));
+        if (enumerate_version == nullptr || enumerate_version(&instance_version) != VK_SUCCESS)
+        {
+            instance_version = VK_API_VERSION_1_0;
+        }
+        instance_version = std::min(instance_version, static_cast<uint32_t>(VK_API_VERSION_1_3));
+
+        VkApplicationInfo app_info {};
+        app_info.sType              = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        app_info.pApplicationName   = "Hello Vulkan";
+        app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+        app_info.pEngineName        = "NinaEngine";
+        app_info.engineVersion      = VK_MAKE_VERSION(1, 0, 0);
+        app_info.apiVersion         = instance_version;
+
+        VkInstanceCreateInfo create_info {};
+        create_info.sType            = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        create_info.pApplicationInfo = &app_info;
+        if (enable_validation_layers)
+        {
+            if (!checkValidationLayerSupport(validation_layers))
+            {
+                throw std::runtime_error("validation layers requested, but not available!");
+            }
+            extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+            create_info.enabledLayerCount   = static_cast<uint32_t>(validation_layers.size());
+            create_info.ppEnabledLayerNames = validation_layers.data();
+        }
+        create_info.enabledExtensionCount   = static_cast<uint32_t>(extensions.size());
+        create_info.ppEnabledExtensionNames = extensions.data();
+
+        if (vkCreateInstance(&create_info, nullptr, &instance) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create instance!");
+        }
+        setupDebugMessenger();
+    }
+
+    bool GpuDevice::checkValidationLayerSupport(const std::vector<const char*>& layers)
+    {
+        uint32_t layer_count;
+        vkEnumerateInstanceLayerProperties(&layer_count, nullptr);
+        std::vector<VkLayerProperties> available_layers(layer_count);
+        vkEnumerateInstanceLayerProperties(&layer_count, available_layers.data());
+        for (const char* layer_name : layers)
+        {
+            bool found_layer = false;
+            for (const auto& layer_properties : available_layers)
+            {
+                if (strcmp(layer_name, layer_properties.layerName) == 0)
+                {
+                    found_layer = true;
+                    break;
+                }
+            }
+            if (!found_layer)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void GpuDevice::setupDebugMessenger()
+    {
+        if (!enable_validation_layers)
+        {
+            return;
+        }
+        VkDebugUtilsMessengerCreateInfoEXT create_info {};
+        create_info.sType           = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+        create_info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
+                                      VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
+                                      VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+        create_info.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
+                                  VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+                                  VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+        create_info.pfnUserCallback = debugCallback;
+        create_info.pUserData       = nullptr;
+
+        auto create_messenger = reinterpret_cast<PFN_vkCreateDebugUtilsMessengerEXT>(
+            vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT"));
+        if (create_messenger == nullptr || create_messenger(instance, &create_info, nullptr, &callback) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to set up debug messenger!");
+        }
+    }
+
+    void GpuDevice::pickPhysicalDevice(VkSurfaceKHR surface, std::string preference)
+    {
+        uint32_t device_count = 0;
+
+        vkEnumeratePhysicalDevices(instance, &device_count, nullptr);
+        if (device_count == 0)
+        {
+            throw std::runtime_error("failed to find GPUs with Vulkan support!");
+        }
+        std::vector<VkPhysicalDevice> devices(device_count);
+        vkEnumeratePhysicalDevices(instance, &device_count, devices.data());
+
+        if (preference.empty() && std::getenv(GPU_PREFERENCE_ENV) != nullptr)
+        {
+            preference = std::getenv(GPU_PREFERENCE_ENV);
+        }
+        std::optional<DeviceScore> best_score;
+        bool                       preferred = false;
+        for (uint32_t i = 0; i < device_count; i++)
+        {
+            VkPhysicalDevice candidate = devices[i];
+            if (!isDeviceSuitable(candidate, surface))
+            {
+                continue;
+            }
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(candidate, &properties);
+            DeviceScore score = scoreDevice(candidate);
+            std::cerr << "GPU " << i << ": " << properties.deviceName << " (type " << score.type_rank << ", "
+                      << (score.local_memory >> 20) << " MiB, " << score.feature_count << " features)" << std::endl;
+
+            // a preference that matches takes the device regardless of score; the first match wins
+            if (preferred)
+            {
+                continue;
+            }
+            if (matchesPreference(preference, i, properties.deviceName))
+            {
+                physical_device = candidate;
+                preferred       = true;
+            }
+            else if (!best_score || *best_score < score)
+            {
+                physical_device = candidate;
+                best_score      = score;
+            }
+        }
+        if (physical_device == VK_NULL_HANDLE)
+        {
+            throw std::runtime_error("failed to find a suitable GPU!");
+        }
+        if (!preference.empty() && !preferred)
+        {
+            std::cerr << "no suitable GPU matches \"" << preference << "\", picking by score" << std::endl;
+        }
+        queue_families = findQueueFamilies(physical_device, surface);
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physical_device, &properties);
+        std::cerr << "GPU: " << properties.deviceName << std::endl;
+        if (queue_families.compute_family)
+        {
+            std::cerr << "async compute queue family " << *queue_families.compute_family << std::endl;
+        }
+        if (queue_families.transfer_family)
+        {
+            std::cerr << "dedicated transfer queue family " << *queue_families.transfer_family << std::endl;
+        }
+    }
+
+    bool GpuDevice::matchesPreference(const std::string& preference, uint32_t index, const std::string& name)
+    {
+        if (preference.empty())
+        {
+            return false;
+        }
+        // an index only if all of it parses, anything else (including out of range numbers) is part of a name
+        uint32_t    preferred_index = 0;
+        const char* end             = preference.data() + preference.size();
+        auto [parsed_end, error]    = std::from_chars(preference.data(), end, preferred_index);
+        if (error == std::errc() && parsed_end == end)
+        {
+            return preferred_index == index;
+        }
+        auto lower = [](std::string text) {
+            std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+            return text;
+        };
+        return lower(name).find(lower(preference)) != std::string::npos;
+    }
+
+    GpuDevice::DeviceScore GpuDevice::scoreDevice(VkPhysicalDevice candidate) const
+    {
+        DeviceScore                score;
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(candidate, &properties);
+        switch (properties.deviceType)
+        {
+            case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+                score.type_rank = 4;
+                break;
+            case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+                score.type_rank = 3;
+                break;
+            case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+                score.type_rank = 2;
+                break;
+            case VK_PHYSICAL_DEVICE_TYPE_CPU:
+                score.type_rank = 1;
+                break;
+            default:
+                score.type_rank = 0;
+                break;
+        }
+
+        // integrated GPUs report (part of) system memory as device local, still their only measure of size
+        VkPhysicalDeviceMemoryProperties memory_properties;
+        vkGetPhysicalDeviceMemoryProperties(candidate, &memory_properties);
+        for (uint32_t i = 0; i < memory_properties.memoryHeapCount; i++)
+        {
+            if ((memory_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0)
+            {
+                score.local_memory = std::max(score.local_memory, memory_properties.memoryHeaps[i].size);
+            }
+        }
+
+        // what the renderer can make use of when it is there
+        VkPhysicalDeviceFeatures features;
+        vkGetPhysicalDeviceFeatures(candidate, &features);
+        score.feature_count += features.multiDrawIndirect == VK_TRUE;
+        score.feature_count += features.drawIndirectFirstInstance == VK_TRUE;
+        score.feature_count += features.samplerAnisotropy == VK_TRUE;
+        score.feature_count += checkDeviceExtensionSupport(candidate, {VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME});
+        score.feature_count += supportsVulkan13Rendering(candidate);
+        QueueFamilyIndices families = findQueueFamilies(candidate, VK_NULL_HANDLE);
+        score.feature_count += families.compute_family.has_value();
+        score.feature_count += families.transfer_family.has_value();
+        return score;
+    }
+
+    bool GpuDevice::isDeviceSuitable(VkPhysicalDevice candidate, VkSurfaceKHR surface) const
+    {
+        if (surface == VK_NULL_HANDLE)
+        {
+            // headless, nothing is ever presented
+            return findQueueFamilies(candidate, surface).graphics_family.has_value();
+        }
+        SwapChainSupportDetails swap_chain_support  = WindowSurface::querySupport(candidate, surface);
+        bool                    swap_chain_adequate =
+            !swap_chain_support.formats.empty() && !swap_chain_support.present_modes.empty();
+
+        QueueFamilyIndices indices              = findQueueFamilies(candidate, surface);
+        bool               extensions_supported = checkDeviceExtensionSupport(candidate, device_extensions);
+        return indices.isComplete() && extensions_supported && swap_chain_adequate;
+    }
+
+    QueueFamilyIndices GpuDevice::findQueueFamilies(VkPhysicalDevice candidate, VkSurfaceKHR surface)
+    {
+        QueueFamilyIndices indices;
+        uint32_t           queue_family_count = 0;
+
+        vkGetPhysicalDeviceQueueFamilyProperties(candidate, &queue_family_count, nullptr);
+        std::vector<VkQueueFamilyProperties> families(queue_family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(candidate, &queue_family_count, families.data());
+        for (uint32_t i = 0; i < queue_family_count; i++)
+        {
+            VkQueueFlags flags = families[i].queueFlags;
+            if (families[i].queueCount == 0)
+            {
+                continue;
+            }
+            VkBool32 present_support = VK_FALSE;
+            if (surface != VK_NULL_HANDLE)
+            {
+                vkGetPhysicalDeviceSurfaceSupportKHR(candidate, i, surface, &present_support);
+            }
+
+            // one family doing both saves the swapchain from concurrent sharing, so it beats an earlier split
+            bool graphics = (flags & VK_QUEUE_GRAPHICS_BIT) != 0;
+            if (graphics && present_support &&
+                (!indices.graphics_family || indices.graphics_family != indices.present_family))
+            {
+                indices.graphics_family = i;
+                indices.present_family  = i;
+            }
+            if (graphics && !indices.graphics_family)
+            {
+                indices.graphics_family = i;
+            }
+            if (present_support && !indices.present_family)
+            {
+                indices.present_family = i;
+            }
+
+            // families without graphics run next to it on the hardware instead of sharing its queue
+            if (!graphics && (flags & VK_QUEUE_COMPUTE_BIT) != 0 && !indices.compute_family)
+            {
+                indices.compute_family = i;
+            }
+            if (!graphics && (flags & VK_QUEUE_COMPUTE_BIT) == 0 && (flags & VK_QUEUE_TRANSFER_BIT) != 0 &&
+                !indices.transfer_family)
+            {
+                indices.transfer_family = i;
+            }
+        }
+        return indices;
+    }
+
+    bool GpuDevice::canPresent(VkSurfaceKHR surface) const
+    {
+        if (headless())
+        {
+            return false;
+        }
+        VkBool32 present_support = VK_FALSE;
+        vkGetPhysicalDeviceSurfaceSupportKHR(
+            physical_device, queue_families.present_family.value(), surface, &present_support);
+        return present_support == VK_TRUE;
+    }
+
+    bool GpuDevice::checkDeviceExtensionSupport(VkPhysicalDevice candidate, const std::vector<const char*>& extensions)
+    {
+        uint32_t extension_count;
+
+        vkEnumerateDeviceExtensionProperties(candidate, nullptr, &extension_count, nullptr);
+        std::vector<VkExtensionProperties> available_extensions(extension_count);
+        vkEnumerateDeviceExtensionProperties(candidate, nullptr, &extension_count, available_extensions.data());
+        std::set<std::string> required_extensions(extensions.begin(), extensions.end());
+        for (const auto& extension : available_extensions)
+        {
+            required_extensions.erase(extension.extensionName);
+        }
+        return required_extensions.empty();
+    }
+
+    bool GpuDevice::supportsExtension(const char* extension) const
+    {
+        return checkDeviceExtensionSupport(physical_device, {extension});
+    }
+
+    bool GpuDevice::extensionEnabled(const char* extension) const
+    {
+        for (const char* enabled : enabled_extensions)
+        {
+            if (strcmp(enabled, extension) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void GpuDevice::createLogicalDevice(const VkPhysicalDeviceFeatures&  features,
+                                        const std::vector<const char*>& extensions,
+                                        bool                            allow_vulkan13)
+    {
+        std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
+        std::set<uint32_t> unique_queue_families = {queue_families.graphics_family.value()};
+        float              queue_priority        = 1.0f;
+        if (queue_families.present_family)
+        {
+            unique_queue_families.insert(*queue_families.present_family);
+        }
+        for (auto queue_family : unique_queue_families)
+        {
+            VkDeviceQueueCreateInfo queue_create_info {};
+            queue_create_info.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            queue_create_info.queueFamilyIndex = queue_family;
+            queue_create_info.queueCount       = 1;
+            queue_create_info.pQueuePriorities = &queue_priority;
+            queue_create_infos.push_back(queue_create_info);
+        }
+
+        enabled_features = features;
+        enabled_extensions.clear();
+        if (!headless())
+        {
+            enabled_extensions.assign(device_extensions.begin(), device_extensions.end());
+        }
+        enabled_extensions.insert(enabled_extensions.end(), extensions.begin(), extensions.end());
+
+        VkDeviceCreateInfo device_create_info {};
+        device_create_info.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        device_create_info.pQueueCreateInfos       = queue_create_infos.data();
+        device_create_info.queueCreateInfoCount    = static_cast<uint32_t>(queue_create_infos.size());
+        device_create_info.pEnabledFeatures        = &enabled_features;
+        device_create_info.enabledExtensionCount   = static_cast<uint32_t>(enabled_extensions.size());
+        device_create_info.ppEnabledExtensionNames = enabled_extensions.data();
+        device_create_info.enabledLayerCount       = 0;
+
+        VkPhysicalDeviceVulkan13Features vulkan13_features {};
+        vulkan13_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+        dynamic_rendering       = allow_vulkan13 && supportsVulkan13Rendering(physical_device);
+        if (dynamic_rendering)
+        {
+            vulkan13_features.dynamicRendering = VK_TRUE;
+            vulkan13_features.synchronization2 = VK_TRUE;
+            device_create_info.pNext           = &vulkan13_features;
+        }
+        if (vkCreateDevice(physical_device, &device_create_info, nullptr, &device) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create logical device!");
+        }
+
+        vkGetDeviceQueue(device, queue_families.graphics_family.value(), 0, &graphics_queue);
+        if (queue_families.present_family)
+        {
+            vkGetDeviceQueue(device, *queue_families.present_family, 0, &present_queue);
+        }
+        if (dynamic_rendering)
+        {
+            BarrierBatch::useSynchronization2(reinterpret_cast<PFN_vkCmdPipelineBarrier2>(
+                vkGetDeviceProcAddr(device, "vkCmdPipelineBarrier2")));
+        }
+
+        VkCommandPoolCreateInfo pool_info {};
+        pool_info.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.queueFamilyIndex = queue_families.graphics_family.value();
+        // the upload command buffer is reused
+        pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        if (vkCreateCommandPool(device, &pool_info, nullptr, &command_pool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create command pool!");
+        }
+        pipeline_registry.init(device, PIPELINE_COMPILE_THREADS, "pipeline_cache.bin");
+
+        staging_ring.init(*this, STAGING_RING_SIZE);
+        VkCommandBufferAllocateInfo alloc_info {};
+        alloc_info.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        alloc_info.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        alloc_info.commandPool        = command_pool;
+        alloc_info.commandBufferCount = 1;
+        VkFenceCreateInfo fence_info {};
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkAllocateCommandBuffers(device, &alloc_info, &upload_command_buffer) != VK_SUCCESS ||
+            vkCreateFence(device, &fence_info, nullptr, &upload_fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create upload resources!");
+        }
+    }
+
+    bool GpuDevice::supportsVulkan13Rendering(VkPhysicalDevice candidate) const
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(candidate, &properties);
+        if (instance_version < VK_API_VERSION_1_3 || properties.apiVersion < VK_API_VERSION_1_3)
+        {
+            return false;
+        }
+        VkPhysicalDeviceVulkan13Features vulkan13_features {};
+        vulkan13_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+        VkPhysicalDeviceFeatures2 features {};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &vulkan13_features;
+        vkGetPhysicalDeviceFeatures2(candidate, &features);
+        // both or neither, the render graph switches its passes and its barriers together
+        return vulkan13_features.dynamicRendering == VK_TRUE && vulkan13_features.synchronization2 == VK_TRUE;
+    }
+
+    void GpuDevice::createFrameSync(uint32_t frame_count)
+    {
+        VkFenceCreateInfo fence_info {};
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+        in_flight_fences.resize(frame_count);
+        for (auto& fence : in_flight_fences)
+        {
+            if (vkCreateFence(device, &fence_info, nullptr, &fence) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create frame fences!");
+            }
+        }
+    }
+
+    void GpuDevice::cleanup()
+    {
+        vkDeviceWaitIdle(device);
+        pipeline_registry.cleanup();
+        staging_ring.cleanup(device);
+        vkDestroyFence(device, upload_fence, nullptr);
+        for (VkFence fence : in_flight_fences)
+        {
+            vkDestroyFence(device, fence, nullptr);
+        }
+        vkDestroyCommandPool(device, command_pool, nullptr);
+        vkDestroyDevice(device, nullptr);
+        BarrierBatch::useSynchronization2(nullptr);
+        if (enable_validation_layers)
+        {
+            auto destroy_messenger = reinterpret_cast<PFN_vkDestroyDebugUtilsMessengerEXT>(
+                vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT"));
+            if (destroy_messenger != nullptr)
+            {
+                destroy_messenger(instance, callback, nullptr);
+            }
+        }
+        vkDestroyInstance(instance, nullptr);
+    }
+
+    uint32_t GpuDevice::findMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties) const
+    {
+        VkPhysicalDeviceMemoryProperties mem_properties;
+        vkGetPhysicalDeviceMemoryProperties(physical_device, &mem_properties);
+        for (uint32_t i = 0; i < mem_properties.memoryTypeCount; i++)
+        {
+            if (type_filter & (1 << i) && (mem_properties.memoryTypes[i].propertyFlags & properties) == properties)
+            {
+                return i;
+            }
+        }
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+
+    void GpuDevice::createBuffer(VkDeviceSize          size,
+                                 VkBufferUsageFlags    usage,
+                                 VkMemoryPropertyFlags properties,
+                                 VkBuffer&             buffer,
+                                 VkDeviceMemory&       buffer_memory) const
+    {
+        VkBufferCreateInfo buffer_info = {};
+        buffer_info.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_info.size               = size;
+        buffer_info.usage              = usage;
+        buffer_info.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateBuffer(device, &buffer_info, nullptr, &buffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create buffer!");
+        }
+
+        VkMemoryRequirements mem_requirements;
+        vkGetBufferMemoryRequirements(device, buffer, &mem_requirements);
+        VkMemoryAllocateInfo alloc_info {};
+        alloc_info.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        alloc_info.allocationSize  = mem_requirements.size;
+        alloc_info.memoryTypeIndex = findMemoryType(mem_requirements.memoryTypeBits, properties);
+        if (vkAllocateMemory(device, &alloc_info, nullptr, &buffer_memory) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate buffer memory!");
+        }
+        vkBindBufferMemory(device, buffer, buffer_memory, 0);
+    }
+
+    void GpuDevice::createImage(uint32_t              width,
+                                uint32_t              height,
+                                VkFormat              format,
+                                VkImageTiling         tiling,
+                                VkImageUsageFlags     usage,
+                                VkMemoryPropertyFlags properties,
+                                VkImage&              image,
+                                VkDeviceMemory&       image_memory,
+                                VkSampleCountFlagBits samples) const
+    {
+        VkImageCreateInfo image_info {};
+        image_info.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_info.imageType     = VK_IMAGE_TYPE_2D;
+        image_info.extent.width  = width;
+        image_info.extent.height = height;
+        image_info.extent.depth  = 1;
+        image_info.mipLevels     = 1;
+        image_info.arrayLayers   = 1;
+        image_info.format        = format;
+        image_info.tiling        = tiling;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        image_info.usage         = usage;
+        image_info.samples       = samples;
+        image_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateImage(device, &image_info, nullptr, &image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create image!");
+        }
+
+        VkMemoryRequirements mem_requirements;
+        vkGetImageMemoryRequirements(device, image, &mem_requirements);
+
+        VkMemoryAllocateInfo alloc_info {};
+        alloc_info.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        alloc_info.allocationSize  = mem_requirements.size;
+        alloc_info.memoryTypeIndex = findMemoryType(mem_requirements.memoryTypeBits, properties);
+
+        if (vkAllocateMemory(device, &alloc_info, nullptr, &image_memory) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate image memory!");
+        }
+
+        vkBindImageMemory(device, image, image_memory, 0);
+    }
+
+    VkImageView GpuDevice::createImageView(VkImage image, VkFormat format) const
+    {
+        VkImageViewCreateInfo view_info {};
+        view_info.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.image                           = image;
+        view_info.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format                          = format;
+        view_info.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        view_info.subresourceRange.baseMipLevel   = 0;
+        view_info.subresourceRange.levelCount     = 1;
+        view_info.subresourceRange.baseArrayLayer = 0;
+        view_info.subresourceRange.layerCount     = 1;
+
+        VkImageView image_view;
+        if (vkCreateImageView(device, &view_info, nullptr, &image_view) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create image view!");
+        }
+
+        return image_view;
+    }
+
+    VkShaderModule GpuDevice::createShaderModule(const std::vector<char>& code) const
+    {
+        VkShaderModuleCreateInfo create_info {};
+        create_info.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        create_info.codeSize = code.size();
+        create_info.pCode    = reinterpret_cast<const uint32_t*>(code.data());
+        VkShaderModule shader_module;
+
+        if (vkCreateShaderModule(device, &create_info, nullptr, &shader_module) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create shader module!");
+        }
+        return shader_module;
+    }
+
+    VkCommandBuffer GpuDevice::beginSingleTimeCommands()
+    {
+        VkCommandBufferAllocateInfo alloc_info {};
+        alloc_info.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        alloc_info.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        alloc_info.commandPool        = command_pool;
+        alloc_info.commandBufferCount = 1;
+        VkCommandBuffer command_buffer;
+        vkAllocateCommandBuffers(device, &alloc_info, &command_buffer);
+        VkCommandBufferBeginInfo begin_info {};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(command_buffer, &begin_info);
+        return command_buffer;
+    }
+
+    void GpuDevice::endSingleTimeCommands(VkCommandBuffer command_buffer)
+    {
+        vkEndCommandBuffer(command_buffer);
+
+        VkSubmitInfo submit_info {};
+        submit_info.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers    = &command_buffer;
+
+        vkQueueSubmit(graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
+        vkQueueWaitIdle(graphics_queue);
+
+        vkFreeCommandBuffers(device, command_pool, 1, &command_buffer);
+    }
+
+    void GpuDevice::uploadBuffer(VkBuffer dst_buffer, VkDeviceSize dst_offset, const void* data, VkDeviceSize size)
+    {
+        const auto*  bytes      = static_cast<const uint8_t*>(data);
+        VkDeviceSize chunk_size = staging_ring.capacity() / 2;
+        for (VkDeviceSize offset = 0; offset < size; offset += chunk_size)
+        {
+            VkDeviceSize      length  = std::min(chunk_size, size - offset);
+            StagingAllocation staging = stageUpload(length);
+            memcpy(staging.data, bytes + offset, static_cast<size_t>(length));
+            VkBufferCopy copy_region {};
+            copy_region.srcOffset = staging.offset;
+            copy_region.dstOffset = dst_offset + offset;
+            copy_region.size      = length;
+            vkCmdCopyBuffer(uploadCommands(), staging.buffer, dst_buffer, 1, &copy_region);
+        }
+        submitUploads();
+    }
+
+    void GpuDevice::uploadImage(VkImage     image,
+                                VkFormat    format,
+                                VkExtent2D  extent,
+                                uint32_t    texel_size,
+                                const void* pixels)
+    {
+        const auto*             bytes    = static_cast<const uint8_t*>(pixels);
+        VkDeviceSize            row_size = static_cast<VkDeviceSize>(extent.width) * texel_size;
+        VkImageSubresourceRange range    = wholeImageRange(format);
+        BarrierBatch            barriers;
+        auto                    chunk_rows =
+            static_cast<uint32_t>(std::clamp<VkDeviceSize>(staging_ring.capacity() / 2 / row_size, 1, extent.height));
+        barriers.transitionImage(image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, range);
+        barriers.flush(uploadCommands());
+        // whole rows per chunk, so every chunk is one copy region
+        for (uint32_t row = 0; row < extent.height; row += chunk_rows)
+        {
+            uint32_t          rows    = std::min(chunk_rows, extent.height - row);
+            StagingAllocation staging = stageUpload(row_size * rows);
+            memcpy(staging.data, bytes + row_size * row, static_cast<size_t>(row_size * rows));
+            VkBufferImageCopy region {};
+            region.bufferOffset                    = staging.offset;
+            region.imageSubresource.aspectMask     = range.aspectMask;
+            region.imageSubresource.mipLevel       = 0;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount     = 1;
+            region.imageOffset                     = {0, static_cast<int32_t>(row), 0};
+            region.imageExtent                     = {extent.width, rows, 1};
+            vkCmdCopyBufferToImage(
+                uploadCommands(), staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        }
+        barriers.transitionImage(
+            image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, range);
+        barriers.flush(uploadCommands());
+        submitUploads();
+    }
+
+    StagingAllocation GpuDevice::stageForFrame(VkDeviceSize size, VkDeviceSize alignment)
+    {
+        while (true)
+        {
+            if (auto staging = staging_ring.allocate(size, alignment, in_flight_fences[current_frame]))
+            {
+                return *staging;
+            }
+            if (!staging_ring.waitOldest())
+            {
+                throw std::runtime_error("staging ring exhausted!");
+            }
+        }
+    }
+
+    void GpuDevice::reserveFrameStaging(VkDeviceSize size)
+    {
+        VkDeviceSize required = STAGING_RING_SIZE + size * std::max<VkDeviceSize>(in_flight_fences.size(), 1);
+        if (staging_ring.capacity() >= required)
+        {
+            return;
+        }
+        // nothing may still copy from the old ring
+        submitUploads();
+        vkDeviceWaitIdle(device);
+        staging_ring.cleanup(device);
+        staging_ring.init(*this, required);
+    }
+
+    StagingAllocation GpuDevice::stageUpload(VkDeviceSize size)
+    {
+        while (true)
+        {
+            if (auto staging = staging_ring.allocate(size, STAGING_ALIGNMENT, upload_fence))
+            {
+                return *staging;
+            }
+            // copies recorded so far go out first, then their space (and whatever is older) can come back
+            if (upload_recording)
+            {
+                submitUploads();
+            }
+            else if (!staging_ring.waitOldest())
+            {
+                throw std::runtime_error("staging ring exhausted!");
+            }
+        }
+    }
+
+    VkCommandBuffer GpuDevice::uploadCommands()
+    {
+        if (!upload_recording)
+        {
+            VkCommandBufferBeginInfo begin_info {};
+            begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(upload_command_buffer, &begin_info);
+            upload_recording = true;
+        }
+        return upload_command_buffer;
+    }
+
+    void GpuDevice::submitUploads()
+    {
+        if (!upload_recording)
+        {
+            return;
+        }
+        vkEndCommandBuffer(upload_command_buffer);
+        upload_recording = false;
+
+        VkSubmitInfo submit_info {};
+        submit_info.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers    = &upload_command_buffer;
+        vkResetFences(device, 1, &upload_fence);
+        if (vkQueueSubmit(graphics_queue, 1, &submit_info, upload_fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit uploads!");
+        }
+        staging_ring.submitted(upload_fence);
+        vkWaitForFences(device, 1, &upload_fence, VK_TRUE, UINT64_MAX);
+        staging_ring.reclaim();
+    }
+
+    void GpuDevice::waitForFrame()
+    {
+        vkWaitForFences(device, 1, &in_flight_fences[current_frame], VK_TRUE, UINT64_MAX);
+        // the fence is reset when this slot is submitted again, its staging space has to be taken back before
+        staging_ring.reclaim();
+    }
+
+    uint32_t GpuDevice::queueSubmission(const FrameSubmission& submission)
+    {
+        auto index = static_cast<uint32_t>(pending_command_buffers.size());
+        pending_command_buffers.push_back(submission.command_buffer);
+        if (submission.swap_chain == VK_NULL_HANDLE)
+        {
+            // offscreen, there was no acquire to wait for and there is no present to signal
+            return index;
+        }
+        pending_waits.push_back(submission.image_available);
+        pending_wait_stages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        pending_signals.push_back(submission.render_finished);
+        pending_swap_chains.push_back(submission.swap_chain);
+        pending_image_indices.push_back(submission.image_index);
+        pending_presented.push_back(index);
+        return index;
+    }
+
+    void GpuDevice::submitFrame()
+    {
+        auto count = static_cast<uint32_t>(pending_command_buffers.size());
+        if (count == 0)
+        {
+            // every output skipped this frame, nothing will signal the fence
+            return;
+        }
+        // a batch per output, all in one vkQueueSubmit: an output's commands wait only on its own acquire and
+        // its present only on its own commands, so a late acquire in one window does not hold up the others
+        auto presented = static_cast<uint32_t>(pending_swap_chains.size());
+        pending_submit_infos.assign(count, VkSubmitInfo {});
+        for (uint32_t i = 0, semaphore = 0; i < count; i++)
+        {
+            VkSubmitInfo& submit_info      = pending_submit_infos[i];
+            submit_info.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submit_info.commandBufferCount = 1;
+            submit_info.pCommandBuffers    = &pending_command_buffers[i];
+            if (semaphore < presented && pending_presented[semaphore] == i)
+            {
+                // offscreen outputs have nothing to wait on or signal
+                submit_info.waitSemaphoreCount   = 1;
+                submit_info.pWaitSemaphores      = &pending_waits[semaphore];
+                submit_info.pWaitDstStageMask    = &pending_wait_stages[semaphore];
+                submit_info.signalSemaphoreCount = 1;
+                submit_info.pSignalSemaphores    = &pending_signals[semaphore];
+                semaphore++;
+            }
+        }
+        vkResetFences(device, 1, &in_flight_fences[current_frame]);
+        if (vkQueueSubmit(graphics_queue, count, pending_submit_infos.data(), in_flight_fences[current_frame]) !=
+            VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit draw command buffer!");
+        }
+        staging_ring.submitted(in_flight_fences[current_frame]);
+
+        // offscreen outputs keep VK_SUCCESS, the outputs look at their own entry of present_results
+        present_results.assign(count, VK_SUCCESS);
+        if (presented > 0)
+        {
+            pending_present_results.assign(presented, VK_SUCCESS);
+            VkPresentInfoKHR present_info {};
+            present_info.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+            present_info.waitSemaphoreCount = presented;
+            present_info.pWaitSemaphores    = pending_signals.data();
+            present_info.swapchainCount     = presented;
+            present_info.pSwapchains        = pending_swap_chains.data();
+            present_info.pImageIndices      = pending_image_indices.data();
+            present_info.pResults           = pending_present_results.data();
+            vkQueuePresentKHR(present_queue, &present_info);
+            for (uint32_t i = 0; i < presented; i++)
+            {
+                present_results[pending_presented[i]] = pending_present_results[i];
+            }
+        }
+
+        pending_command_buffers.clear();
+        pending_waits.clear();
+        pending_wait_stages.clear();
+        pending_signals.clear();
+        pending_swap_chains.clear();
+        pending_image_indices.clear();
+        pending_presented.clear();
+        current_frame = (current_frame + 1) % static_cast<uint32_t>(in_flight_fences.size());
+    }
+} // namespace vulkanDetails
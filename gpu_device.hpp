@@ -0,0 +1,191 @@
+#pragma once
+#include "pipeline_registry.hpp"
+#include "staging_ring.hpp"
+#include "thread_pool.hpp"
+#include "vulkan/vulkan.h"
+#include <compare>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace vulkanDetails
+{
+    struct QueueFamilyIndices
+    {
+        std::optional<uint32_t> graphics_family;
+        std::optional<uint32_t> present_family;
+        // compute without graphics, i.e. async compute next to the graphics queue; only used for scoring so far,
+        // no queue is created on it
+        std::optional<uint32_t> compute_family;
+        // transfer only, usually the copy engines; only used for scoring so far, no queue is created on it
+        std::optional<uint32_t> transfer_family;
+
+        [[nodiscard]] bool isComplete() const { return graphics_family.has_value() && present_family.has_value(); }
+    };
+
+    // One output's share of a frame: its recorded commands and the swapchain image they draw into.
+    struct FrameSubmission
+    {
+        VkCommandBuffer command_buffer {};
+        VkSemaphore     image_available {}; // signaled by the acquire
+        VkSemaphore     render_finished {}; // waited on by the present
+        VkSwapchainKHR  swap_chain {};      // VK_NULL_HANDLE for offscreen outputs, nothing is waited or presented
+        uint32_t        image_index = 0;
+    };
+
+    // Everything that is per GPU rather than per window: the instance, the physical and logical device, queues,
+    // memory and command helpers, the pipeline cache and the worker threads for CPU side frame work (scene updates,
+    // culling), which outputs take turns on since they record one after another. Outputs (VulkanBase) share one
+    // through a shared_ptr; the first one brings it up and whoever created it calls cleanup() after the last output
+    // is gone.
+    //
+    // Frames in flight are paced here instead of per output, so every output's commands of a frame go out in one
+    // vkQueueSubmit behind one fence and all swapchains are presented with one vkQueuePresentKHR.
+    class GpuDevice
+    {
+    public:
+        // Enough for every texel size the renderer copies, and for vkCmdCopyBufferToImage's offset rules.
+        static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+        // Adds the debug utils extension and validation layers itself in debug builds.
+        void createInstance(std::vector<const char*> extensions);
+        // The surface only has to be one the device can present to; other outputs are checked with canPresent.
+        // Without one (VK_NULL_HANDLE) the device is headless and only needs a graphics queue. Among the suitable
+        // devices the best DeviceScore wins, unless preference (or RENDERER_GPU when it is empty) names one by
+        // index or by part of its name.
+        void pickPhysicalDevice(VkSurfaceKHR surface, std::string preference = {});
+        // Enables the swapchain extension on top of extensions unless the device is headless. With allow_vulkan13,
+        // dynamic rendering and synchronization2 are enabled too where the device supports both, see
+        // dynamicRenderingEnabled.
+        void createLogicalDevice(const VkPhysicalDeviceFeatures&  features,
+                                 const std::vector<const char*>& extensions,
+                                 bool                            allow_vulkan13);
+        void createFrameSync(uint32_t frame_count);
+        void cleanup();
+
+        [[nodiscard]] bool instanceCreated() const { return instance != VK_NULL_HANDLE; }
+        [[nodiscard]] bool physicalDeviceSelected() const { return physical_device != VK_NULL_HANDLE; }
+        [[nodiscard]] bool deviceCreated() const { return device != VK_NULL_HANDLE; }
+        [[nodiscard]] bool headless() const { return !queue_families.present_family.has_value(); }
+        [[nodiscard]] bool canPresent(VkSurfaceKHR surface) const;
+        [[nodiscard]] bool supportsExtension(const char* extension) const;
+        [[nodiscard]] bool extensionEnabled(const char* extension) const;
+        // vkCmdBeginRendering instead of render pass objects, and every BarrierBatch recorded with
+        // vkCmdPipelineBarrier2
+        [[nodiscard]] bool dynamicRenderingEnabled() const { return dynamic_rendering; }
+
+        [[nodiscard]] VkInstance                      getInstance() const { return instance; }
+        [[nodiscard]] VkPhysicalDevice                getPhysicalDevice() const { return physical_device; }
+        [[nodiscard]] VkDevice                        getDevice() const { return device; }
+        [[nodiscard]] VkQueue                         getGraphicsQueue() const { return graphics_queue; }
+        [[nodiscard]] const QueueFamilyIndices&       getQueueFamilies() const { return queue_families; }
+        [[nodiscard]] const VkPhysicalDeviceFeatures& getEnabledFeatures() const { return enabled_features; }
+        [[nodiscard]] PipelineRegistry&               getPipelineRegistry() { return pipeline_registry; }
+        [[nodiscard]] ThreadPool&                     getWorkerPool() { return worker_pool; }
+
+        uint32_t        findMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties) const;
+        void            createBuffer(VkDeviceSize          size,
+                                     VkBufferUsageFlags    usage,
+                                     VkMemoryPropertyFlags properties,
+                                     VkBuffer&             buffer,
+                                     VkDeviceMemory&       buffer_memory) const;
+        void            createImage(uint32_t              width,
+                                    uint32_t              height,
+                                    VkFormat              format,
+                                    VkImageTiling         tiling,
+                                    VkImageUsageFlags     usage,
+                                    VkMemoryPropertyFlags properties,
+                                    VkImage&              image,
+                                    VkDeviceMemory&       image_memory,
+                                    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT) const;
+        VkImageView     createImageView(VkImage image, VkFormat format) const;
+        VkShaderModule  createShaderModule(const std::vector<char>& code) const;
+        // Blocking one-off submissions on the graphics queue, for setup work outside of frames.
+        VkCommandBuffer beginSingleTimeCommands();
+        void            endSingleTimeCommands(VkCommandBuffer command_buffer);
+
+        // Copy data through the staging ring, split into chunks if it is larger than half the ring, and wait for
+        // the copies. For setup and loading; frames record their own copies from stageForFrame.
+        void uploadBuffer(VkBuffer dst_buffer, VkDeviceSize dst_offset, const void* data, VkDeviceSize size);
+        // Fills all of image (texel_size bytes per texel, tightly packed) and leaves it SHADER_READ_ONLY_OPTIMAL.
+        void uploadImage(VkImage image, VkFormat format, VkExtent2D extent, uint32_t texel_size, const void* pixels);
+        // Staging space for copies in the current frame's command buffers, taken back once the frame completes.
+        // Throws if size does not fit into the ring even after waiting for earlier frames.
+        StagingAllocation stageForFrame(VkDeviceSize size, VkDeviceSize alignment = STAGING_ALIGNMENT);
+        // Grows the ring until every frame in flight can stage size bytes from stageForFrame on top of its usual
+        // uploads. Replacing the ring waits for the device, so this is for setup between frames.
+        void              reserveFrameStaging(VkDeviceSize size);
+        [[nodiscard]] const StagingRing& getStagingRing() const { return staging_ring; }
+
+        // The frame-in-flight slot outputs record into until submitFrame.
+        [[nodiscard]] uint32_t currentFrame() const { return current_frame; }
+        // Blocks until the GPU is done with the current slot's previous frame.
+        void                   waitForFrame();
+        // Returns the index to look the present result up with once the frame is submitted.
+        uint32_t               queueSubmission(const FrameSubmission& submission);
+        // Submits and presents everything queued since the last call, then moves on to the next slot. Without
+        // submissions the slot is kept, its fence was never reset.
+        void                   submitFrame();
+        [[nodiscard]] VkResult presentResult(uint32_t submission) const { return present_results[submission]; }
+
+    private:
+        // Compared in member order: device type first, then memory, then what the renderer could use.
+        struct DeviceScore
+        {
+            uint32_t     type_rank     = 0; // discrete > integrated > virtual > CPU
+            VkDeviceSize local_memory  = 0; // largest device local heap
+            uint32_t     feature_count = 0;
+
+            auto operator<=>(const DeviceScore&) const = default;
+        };
+
+        [[nodiscard]] DeviceScore scoreDevice(VkPhysicalDevice candidate) const;
+        static bool               matchesPreference(const std::string& preference,
+                                                    uint32_t           index,
+                                                    const std::string& name);
+        bool                      isDeviceSuitable(VkPhysicalDevice candidate, VkSurfaceKHR surface) const;
+        static QueueFamilyIndices findQueueFamilies(VkPhysicalDevice candidate, VkSurfaceKHR surface);
+        static bool               checkDeviceExtensionSupport(VkPhysicalDevice                candidate,
+                                                              const std::vector<const char*>& extensions);
+        static bool               checkValidationLayerSupport(const std::vector<const char*>& layers);
+        [[nodiscard]] bool        supportsVulkan13Rendering(VkPhysicalDevice candidate) const;
+        void                      setupDebugMessenger();
+        StagingAllocation         stageUpload(VkDeviceSize size);
+        // The upload command buffer, begun if it is not recording yet.
+        VkCommandBuffer           uploadCommands();
+        void                      submitUploads();
+
+        VkInstance                        instance {};
+        uint32_t                          instance_version = VK_API_VERSION_1_0;
+        VkDebugUtilsMessengerEXT          callback {};
+        VkPhysicalDevice                  physical_device = VK_NULL_HANDLE;
+        VkDevice                          device {};
+        QueueFamilyIndices                queue_families;
+        VkQueue                           graphics_queue {};
+        VkQueue                           present_queue {};
+        VkPhysicalDeviceFeatures          enabled_features {};
+        std::vector<const char*>          enabled_extensions;
+        bool                              dynamic_rendering = false;
+        VkCommandPool                     command_pool {}; // single-time commands only, outputs record from their own
+        PipelineRegistry                  pipeline_registry;
+        ThreadPool                        worker_pool;
+        StagingRing                       staging_ring;
+        VkCommandBuffer                   upload_command_buffer {};
+        VkFence                           upload_fence {};
+        bool                              upload_recording = false;
+        std::vector<VkFence>              in_flight_fences;
+        uint32_t                          current_frame = 0;
+        // what queueSubmission collected, kept between frames so submitting does not allocate
+        std::vector<VkCommandBuffer>      pending_command_buffers;
+        std::vector<VkSemaphore>          pending_waits;
+        std::vector<VkPipelineStageFlags> pending_wait_stages;
+        std::vector<VkSemaphore>          pending_signals;
+        std::vector<VkSwapchainKHR>       pending_swap_chains;
+        std::vector<uint32_t>             pending_image_indices;
+        std::vector<uint32_t>             pending_presented; // submission index of each pending swapchain
+        std::vector<VkResult>             pending_present_results;
+        std::vector<VkSubmitInfo>         pending_submit_infos;
+        std::vector<VkResult>             present_results;
+    };
+} // namespace vulkanDetails
@@ -0,0 +1,22 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <cstdint>
+#include <type_traits>
+
+namespace vulkanDetails
+{
+    // Turns a non-dispatchable handle into a cache key component; those handles are pointers on 64-bit targets and
+    // uint64_t elsewhere.
+    template <typename Handle>
+    uint64_t handleKey(Handle handle)
+    {
+        if constexpr (std::is_pointer_v<Handle>)
+        {
+            return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle));
+        }
+        else
+        {
+            return static_cast<uint64_t>(handle);
+        }
+    }
+} // namespace vulkanDetails
@@ -5,7 +5,12 @@
 #include <vulkan/vulkan_core.h>
 #include "vulkan_util.hpp"
 #include <SDL2/SDL.h>
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
 #include <vulkan/vulkan.h>
 
 using namespace vulkanDetails;
@@ -13,12 +18,200 @@ using namespace vulkanDetails;
 constexpr uint32_t WIDTH  = 800;
 constexpr uint32_t HEIGHT = 600;
 
-int main()
+int main(int argc, char* argv[])
 {
-    VulkanBase* singleton = VulkanBase::getInstance();
-    singleton->initWindow();
-    singleton->initVulkan();
-    singleton->mainLoop();
-    singleton->cleanup();
-    return 0;
+    RendererOptions options;
+    uint32_t        window_count = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--gpu-culling") == 0)
+        {
+            options.gpu_culling = true;
+        }
+        else if (strcmp(argv[i], "--dynamic-uniforms") == 0)
+        {
+            options.draw_path = DrawPath::DynamicUniforms;
+        }
+        else if (strcmp(argv[i], "--msaa") == 0 && i + 1 < argc)
+        {
+            options.msaa_samples = static_cast<uint32_t>(std::atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--benchmark-draws") == 0)
+        {
+            options.benchmark = BenchmarkMode::Draws;
+        }
+        else if (strcmp(argv[i], "--benchmark-msaa") == 0)
+        {
+            options.benchmark = BenchmarkMode::Msaa;
+        }
+        else if (strcmp(argv[i], "--benchmark-streaming") == 0)
+        {
+            options.benchmark = BenchmarkMode::Streaming;
+        }
+        else if (strcmp(argv[i], "--benchmark-tilemap") == 0)
+        {
+            options.benchmark = BenchmarkMode::Tilemap;
+            options.tilemap   = true;
+        }
+        else if (strcmp(argv[i], "--tilemap") == 0)
+        {
+            options.tilemap = true;
+        }
+        else if (strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+        {
+            options.particles = static_cast<uint32_t>(std::atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--benchmark-particles") == 0)
+        {
+            // never draws a frame, so there is no window or surface
+            options.benchmark = BenchmarkMode::Particles;
+            options.headless  = true;
+        }
+        else if (strcmp(argv[i], "--benchmark-culling") == 0)
+        {
+            options.benchmark = BenchmarkMode::Culling;
+        }
+        else if (strcmp(argv[i], "--regress") == 0 && i + 1 < argc)
+        {
+            // compares against the references in the given directory; frames reach it through the readback sink,
+            // offscreen so it runs without a display; the tile map is the textured scene
+            options.benchmark      = BenchmarkMode::Regress;
+            options.regression_dir = argv[++i];
+            options.capture.format = CaptureFormat::Sink;
+            options.headless       = true;
+            options.tilemap        = true;
+        }
+        else if (strcmp(argv[i], "--regress-update") == 0)
+        {
+            options.regression_update = true;
+        }
+        else if (strcmp(argv[i], "--sim-rate") == 0 && i + 1 < argc)
+        {
+            options.simulation_rate = std::atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--on-demand") == 0)
+        {
+            options.on_demand_redraw = true;
+        }
+        else if (strcmp(argv[i], "--max-fps") == 0 && i + 1 < argc)
+        {
+            options.max_fps = std::atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--dynamic-resolution") == 0 && i + 1 < argc)
+        {
+            // GPU milliseconds per frame
+            options.gpu_budget_ms = std::atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--font") == 0 && i + 1 < argc)
+        {
+            options.font_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--capture-png") == 0 && i + 1 < argc)
+        {
+            options.capture.format = CaptureFormat::Png;
+            options.capture.path   = argv[++i];
+        }
+        else if (strcmp(argv[i], "--capture-raw") == 0 && i + 1 < argc)
+        {
+            options.capture.format = CaptureFormat::Raw;
+            options.capture.path   = argv[++i];
+        }
+        else if (strcmp(argv[i], "--capture-frames") == 0 && i + 1 < argc)
+        {
+            options.capture.max_frames = static_cast<uint32_t>(std::atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--legacy-render-passes") == 0)
+        {
+            options.legacy_render_passes = true;
+        }
+        else if (strcmp(argv[i], "--gpu") == 0 && i + 1 < argc)
+        {
+            options.gpu = argv[++i];
+        }
+        else if (strcmp(argv[i], "--windows") == 0 && i + 1 < argc)
+        {
+            // independent outputs on one device, all submitted and presented together
+            window_count = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 1));
+        }
+    }
+
+    // the raw stream owns stdout, so it cannot be shared with a benchmark report; diagnostics go to stderr
+    if (options.capture.format == CaptureFormat::Raw && options.capture.path == "-" &&
+        options.benchmark != BenchmarkMode::None)
+    {
+        std::cerr << "--capture-raw - writes frames to stdout and cannot be combined with a benchmark" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (options.benchmark == BenchmarkMode::Culling)
+    {
+        // CPU only, so no device or window is brought up
+        VulkanBase::runCullingBenchmark();
+        return EXIT_SUCCESS;
+    }
+
+    auto                                     gpu = std::make_shared<GpuDevice>();
+    std::vector<std::unique_ptr<VulkanBase>> outputs;
+    std::vector<VulkanBase*>                 output_pointers;
+    // benchmarks measure a single output
+    if (options.benchmark != BenchmarkMode::None)
+    {
+        window_count = 1;
+    }
+    for (uint32_t i = 0; i < window_count; i++)
+    {
+        auto output = std::make_unique<VulkanBase>(gpu);
+        output->setOptions(options);
+        output->initWindow();
+        if (i > 0)
+        {
+            // cascaded, so they do not hide each other
+            int x, y;
+            SDL_GetWindowPosition(outputs.front()->getWindow(), &x, &y);
+            SDL_SetWindowPosition(output->getWindow(), x + 40 * static_cast<int>(i), y + 40 * static_cast<int>(i));
+        }
+        output->initVulkan();
+        output_pointers.push_back(output.get());
+        outputs.push_back(std::move(output));
+    }
+    VulkanBase& renderer  = *outputs.front();
+    int         exit_code = EXIT_SUCCESS;
+    switch (options.benchmark)
+    {
+        case BenchmarkMode::Draws:
+            renderer.runDrawBenchmark();
+            break;
+        case BenchmarkMode::Msaa:
+            renderer.runMsaaBenchmark();
+            break;
+        case BenchmarkMode::Streaming:
+            renderer.runStreamingBenchmark();
+            break;
+        case BenchmarkMode::Tilemap:
+            renderer.runTilemapBenchmark();
+            break;
+        case BenchmarkMode::Particles:
+            renderer.runParticleBenchmark();
+            break;
+        case BenchmarkMode::Regress:
+            exit_code = renderer.runRegressionSuite() ? EXIT_SUCCESS : EXIT_FAILURE;
+            break;
+        default:
+            if (outputs.size() > 1)
+            {
+                VulkanBase::runOutputs(output_pointers);
+            }
+            else
+            {
+                renderer.mainLoop();
+            }
+            break;
+    }
+    for (auto& output : outputs)
+    {
+        output->cleanup();
+    }
+    gpu->cleanup();
+    SDL_Quit();
+    return exit_code;
 }
@@ -0,0 +1,339 @@
+#include "particle_system.hpp"
+#include "barrier_batch.hpp"
+#include "vulkan_util.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+
+namespace vulkanDetails
+{
+    void ParticleSystem::init(GpuDevice& gpu_device, VkDevice device, uint32_t particle_capacity)
+    {
+        gpu      = &gpu_device;
+        capacity = particle_capacity;
+        current  = 0;
+        for (uint32_t i = 0; i < 2; i++)
+        {
+            gpu->createBuffer(sizeof(GpuParticle) * capacity,
+                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                              particle_buffers[i],
+                              particle_buffers_memory[i]);
+            gpu->createBuffer(sizeof(GpuParticleCounters),
+                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                              counter_buffers[i],
+                              counter_buffers_memory[i]);
+            // nothing alive: the first draw has no instances and the first simulate no groups
+            GpuParticleCounters counters {};
+            counters.draw.vertexCount = 6;
+            counters.simulate         = {0, 1, 1};
+            gpu->uploadBuffer(counter_buffers[i], 0, &counters, sizeof(counters));
+        }
+        createDescriptors(device);
+        createComputePipelines(device);
+    }
+
+    void ParticleSystem::createDescriptors(VkDevice device)
+    {
+        // particles in, particles out, counters in, counters out; the vertex shader reads the particles out of the
+        // set the last step ran with
+        std::array<VkDescriptorSetLayoutBinding, 4> bindings {};
+        for (uint32_t i = 0; i < bindings.size(); i++)
+        {
+            bindings[i].binding         = i;
+            bindings[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        bindings[1].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+
+        VkDescriptorSetLayoutCreateInfo layout_info {};
+        layout_info.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+        layout_info.pBindings    = bindings.data();
+        if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &set_layout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create particle descriptor set layout!");
+        }
+
+        VkDescriptorPoolSize pool_size {};
+        pool_size.type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        pool_size.descriptorCount = static_cast<uint32_t>(descriptor_sets.size() * bindings.size());
+
+        VkDescriptorPoolCreateInfo pool_info {};
+        pool_info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.poolSizeCount = 1;
+        pool_info.pPoolSizes    = &pool_size;
+        pool_info.maxSets       = static_cast<uint32_t>(descriptor_sets.size());
+        if (vkCreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create particle descriptor pool!");
+        }
+
+        std::array<VkDescriptorSetLayout, 2> layouts = {set_layout, set_layout};
+        VkDescriptorSetAllocateInfo          alloc_info {};
+        alloc_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.descriptorPool     = descriptor_pool;
+        alloc_info.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+        alloc_info.pSetLayouts        = layouts.data();
+        if (vkAllocateDescriptorSets(device, &alloc_info, descriptor_sets.data()) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate particle descriptor sets!");
+        }
+
+        for (uint32_t i = 0; i < descriptor_sets.size(); i++)
+        {
+            uint32_t          other = 1 - i;
+            DescriptorBinding particles_in {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+            DescriptorBinding particles_out {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+            DescriptorBinding counters_in {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+            DescriptorBinding counters_out {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+            particles_in.buffer  = {particle_buffers[i], 0, VK_WHOLE_SIZE};
+            particles_out.buffer = {particle_buffers[other], 0, VK_WHOLE_SIZE};
+            counters_in.buffer   = {counter_buffers[i], 0, VK_WHOLE_SIZE};
+            counters_out.buffer  = {counter_buffers[other], 0, VK_WHOLE_SIZE};
+            writeDescriptorSet(device, descriptor_sets[i], {particles_in, particles_out, counters_in, counters_out});
+        }
+    }
+
+    void ParticleSystem::createComputePipelines(VkDevice device)
+    {
+        VkPushConstantRange push_constant_range {};
+        push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        push_constant_range.offset     = 0;
+        push_constant_range.size       = sizeof(ParticleParams);
+
+        VkPipelineLayoutCreateInfo pipeline_layout_info {};
+        pipeline_layout_info.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipeline_layout_info.setLayoutCount         = 1;
+        pipeline_layout_info.pSetLayouts            = &set_layout;
+        pipeline_layout_info.pushConstantRangeCount = 1;
+        pipeline_layout_info.pPushConstantRanges    = &push_constant_range;
+        if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create particle pipeline layout!");
+        }
+
+        std::array<std::pair<const char*, VkPipeline*>, 3> stages = {{
+            {"../shader/particle_simulate_comp.spv", &simulate_pipeline},
+            {"../shader/particle_emit_comp.spv", &emit_pipeline},
+            {"../shader/particle_finalize_comp.spv", &finalize_pipeline},
+        }};
+        for (const auto& [path, pipeline] : stages)
+        {
+            auto           compute_shader_code   = readFile(path);
+            VkShaderModule compute_shader_module = gpu->createShaderModule(compute_shader_code);
+
+            VkComputePipelineCreateInfo pipeline_info {};
+            pipeline_info.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            pipeline_info.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            pipeline_info.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+            pipeline_info.stage.module = compute_shader_module;
+            pipeline_info.stage.pName  = "main";
+            pipeline_info.layout       = pipeline_layout;
+            if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, pipeline) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create particle pipeline!");
+            }
+            vkDestroyShaderModule(device, compute_shader_module, nullptr);
+        }
+    }
+
+    void ParticleSystem::cleanup(VkDevice device)
+    {
+        vkDestroyPipeline(device, simulate_pipeline, nullptr);
+        vkDestroyPipeline(device, emit_pipeline, nullptr);
+        vkDestroyPipeline(device, finalize_pipeline, nullptr);
+        vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+        vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+        vkDestroyDescriptorSetLayout(device, set_layout, nullptr);
+        for (uint32_t i = 0; i < 2; i++)
+        {
+            vkDestroyBuffer(device, particle_buffers[i], nullptr);
+            vkFreeMemory(device, particle_buffers_memory[i], nullptr);
+            vkDestroyBuffer(device, counter_buffers[i], nullptr);
+            vkFreeMemory(device, counter_buffers_memory[i], nullptr);
+        }
+        *this = ParticleSystem();
+    }
+
+    void ParticleSystem::advance(float step_seconds)
+    {
+        step_time       = step_seconds;
+        float emitted   = emitter.rate * step_seconds + emit_remainder;
+        float whole     = std::floor(emitted);
+        emit_remainder  = emitted - whole;
+        uint64_t wanted = static_cast<uint64_t>(whole) + pending_burst;
+        pending_burst   = 0;
+        stats.requested += wanted;
+        // more than capacity would only be dropped again
+        emit_count = static_cast<uint32_t>(std::min<uint64_t>(wanted, capacity));
+    }
+
+    void ParticleSystem::recordStep(VkCommandBuffer command_buffer)
+    {
+        uint32_t     next = 1 - current;
+        BarrierBatch barriers;
+        // the buffers written here were last read by the draw (and the step) before the previous one
+        barriers.bufferBarrier(counter_buffers[next],
+                               0,
+                               VK_WHOLE_SIZE,
+                               VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+                               VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               VK_ACCESS_TRANSFER_WRITE_BIT);
+        barriers.bufferBarrier(particle_buffers[next],
+                               0,
+                               VK_WHOLE_SIZE,
+                               VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_SHADER_READ_BIT,
+                               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_SHADER_WRITE_BIT);
+        barriers.flush(command_buffer);
+        vkCmdFillBuffer(command_buffer,
+                        counter_buffers[next],
+                        offsetof(GpuParticleCounters, draw) + offsetof(VkDrawIndirectCommand, instanceCount),
+                        sizeof(uint32_t),
+                        0);
+        barriers.bufferBarrier(counter_buffers[next],
+                               0,
+                               VK_WHOLE_SIZE,
+                               VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               VK_ACCESS_TRANSFER_WRITE_BIT,
+                               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+        barriers.flush(command_buffer);
+
+        ParticleParams params {};
+        params.emitter_position = glm::vec4(emitter.position, emitter.lifetime);
+        params.emitter_velocity = glm::vec4(emitter.velocity, emitter.spread);
+        params.gravity          = glm::vec4(emitter.gravity, emitter.drag);
+        params.step_seconds     = step_time;
+        params.emit_count       = emit_count;
+        params.capacity         = capacity;
+        params.seed             = static_cast<uint32_t>(stats.steps);
+
+        vkCmdBindDescriptorSets(command_buffer,
+                                VK_PIPELINE_BIND_POINT_COMPUTE,
+                                pipeline_layout,
+                                0,
+                                1,
+                                &descriptor_sets[current],
+                                0,
+                                nullptr);
+        vkCmdPushConstants(
+            command_buffer, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ParticleParams), &params);
+        // every stage appends to the output count, each has to see the previous one's
+        auto append_barrier = [&]() {
+            for (VkBuffer buffer : {particle_buffers[next], counter_buffers[next]})
+            {
+                barriers.bufferBarrier(buffer,
+                                       0,
+                                       VK_WHOLE_SIZE,
+                                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                       VK_ACCESS_SHADER_WRITE_BIT,
+                                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+            }
+            barriers.flush(command_buffer);
+        };
+
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, simulate_pipeline);
+        vkCmdDispatchIndirect(command_buffer, counter_buffers[current], offsetof(GpuParticleCounters, simulate));
+        append_barrier();
+        if (emit_count > 0)
+        {
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, emit_pipeline);
+            vkCmdDispatch(command_buffer, (emit_count + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+            append_barrier();
+        }
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, finalize_pipeline);
+        vkCmdDispatch(command_buffer, 1, 1, 1);
+
+        barriers.bufferBarrier(counter_buffers[next],
+                               0,
+                               VK_WHOLE_SIZE,
+                               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_SHADER_WRITE_BIT,
+                               VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+        barriers.bufferBarrier(particle_buffers[next],
+                               0,
+                               VK_WHOLE_SIZE,
+                               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_SHADER_WRITE_BIT,
+                               VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_SHADER_READ_BIT);
+        barriers.flush(command_buffer);
+
+        current    = next;
+        emit_count = 0;
+        stats.steps++;
+    }
+
+    void ParticleSystem::recordDraw(VkCommandBuffer command_buffer, VkPipelineLayout layout) const
+    {
+        // the set whose output is the current buffer
+        vkCmdBindDescriptorSets(command_buffer,
+                                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                layout,
+                                1,
+                                1,
+                                &descriptor_sets[1 - current],
+                                0,
+                                nullptr);
+        vkCmdDrawIndirect(command_buffer,
+                          counter_buffers[current],
+                          offsetof(GpuParticleCounters, draw),
+                          1,
+                          sizeof(VkDrawIndirectCommand));
+    }
+
+    uint32_t ParticleSystem::readAliveCount()
+    {
+        VkBuffer       readback_buffer;
+        VkDeviceMemory readback_memory;
+        gpu->createBuffer(sizeof(uint32_t),
+                          VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                          readback_buffer,
+                          readback_memory);
+
+        VkCommandBuffer command_buffer = gpu->beginSingleTimeCommands();
+        BarrierBatch    barriers;
+        barriers.bufferBarrier(counter_buffers[current],
+                               0,
+                               VK_WHOLE_SIZE,
+                               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_ACCESS_SHADER_WRITE_BIT,
+                               VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               VK_ACCESS_TRANSFER_READ_BIT);
+        barriers.flush(command_buffer);
+        VkBufferCopy region {};
+        region.srcOffset = offsetof(GpuParticleCounters, draw) + offsetof(VkDrawIndirectCommand, instanceCount);
+        region.size      = sizeof(uint32_t);
+        vkCmdCopyBuffer(command_buffer, counter_buffers[current], readback_buffer, 1, &region);
+        // the fence alone does not make the copy visible to the mapped memory
+        barriers.bufferBarrier(readback_buffer,
+                               0,
+                               VK_WHOLE_SIZE,
+                               VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               VK_ACCESS_TRANSFER_WRITE_BIT,
+                               VK_PIPELINE_STAGE_HOST_BIT,
+                               VK_ACCESS_HOST_READ_BIT);
+        barriers.flush(command_buffer);
+        gpu->endSingleTimeCommands(command_buffer);
+
+        VkDevice device = gpu->getDevice();
+        void*    data;
+        vkMapMemory(device, readback_memory, 0, sizeof(uint32_t), 0, &data);
+        uint32_t alive = *static_cast<uint32_t*>(data);
+        vkUnmapMemory(device, readback_memory);
+        vkDestroyBuffer(device, readback_buffer, nullptr);
+        vkFreeMemory(device, readback_memory, nullptr);
+        return alive;
+    }
+} // namespace vulkanDetails
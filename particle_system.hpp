@@ -0,0 +1,114 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace vulkanDetails
+{
+    class GpuDevice;
+
+    // One particle as the particle shaders see it (std430, 32 bytes).
+    struct GpuParticle
+    {
+        glm::vec4 position; // xyz, w = age in seconds
+        glm::vec4 velocity; // xyz, w = lifetime in seconds
+    };
+
+    // Written by particle_finalize.comp after every step: the draw and the next step's dispatch size, both sized by
+    // the number of live particles, so neither has to be read back.
+    struct GpuParticleCounters
+    {
+        VkDrawIndirectCommand     draw;     // instanceCount is the live particle count
+        VkDispatchIndirectCommand simulate; // groups of particle_simulate.comp over the live particles
+        uint32_t                  padding;
+    };
+
+    struct ParticleParams
+    {
+        glm::vec4 emitter_position; // w = lifetime
+        glm::vec4 emitter_velocity; // w = random spread added to each component
+        glm::vec4 gravity;          // w = drag
+        float     step_seconds;
+        uint32_t  emit_count;
+        uint32_t  capacity;
+        uint32_t  seed;
+    };
+
+    struct ParticleEmitter
+    {
+        glm::vec3 position {0.0f, 0.0f, 0.25f};
+        glm::vec3 velocity {0.0f, 0.0f, 1.5f};
+        float     spread   = 0.75f;
+        float     rate     = 0.0f; // particles per second
+        float     lifetime = 2.0f; // seconds, each particle lives between half of it and all of it
+        glm::vec3 gravity {0.0f, 0.0f, -2.0f};
+        float     drag     = 0.2f;
+    };
+
+    struct ParticleStats
+    {
+        uint64_t steps     = 0;
+        uint64_t requested = 0; // particles asked to be emitted; what did not fit into capacity was dropped on the GPU
+    };
+
+    // Particles that live in device local storage buffers and never come back to the CPU. Every step is recorded
+    // as three compute dispatches: simulate ages and moves the live particles and compacts the survivors into the
+    // other buffer, emit appends new ones behind them, finalize turns the count into the indirect draw and the next
+    // step's indirect dispatch. Drawing is one vkCmdDrawIndirect of a quad per particle.
+    //
+    // There is a single copy of the state, not one per frame in flight: steps are ordered behind the previous
+    // frame's draw with a barrier, which the queue's submission order makes sufficient.
+    //
+    // Per frame: advance(), then recordStep() outside and recordDraw() inside the render pass.
+    class ParticleSystem
+    {
+    public:
+        static constexpr uint32_t GROUP_SIZE = 256;
+
+        void init(GpuDevice& gpu, VkDevice device, uint32_t particle_capacity);
+        void cleanup(VkDevice device);
+
+        void setEmitter(const ParticleEmitter& particle_emitter) { emitter = particle_emitter; }
+        // Emitted with the next step, on top of the emitter's rate.
+        void burst(uint32_t count) { pending_burst += count; }
+        // Sets the time the next step simulates and emits for.
+        void advance(float step_seconds);
+
+        // Must be recorded outside of a render pass.
+        void recordStep(VkCommandBuffer command_buffer);
+        // Expects a pipeline whose layout has the particle set as set 1 and no vertex input bound.
+        void recordDraw(VkCommandBuffer command_buffer, VkPipelineLayout layout) const;
+        // Blocks on a readback of the live particle count, for benchmarks and debugging; frames never need it.
+        uint32_t readAliveCount();
+
+        [[nodiscard]] VkDescriptorSetLayout getSetLayout() const { return set_layout; }
+        [[nodiscard]] uint32_t              getCapacity() const { return capacity; }
+        [[nodiscard]] const ParticleStats&  getStats() const { return stats; }
+
+    private:
+        void createDescriptors(VkDevice device);
+        void createComputePipelines(VkDevice device);
+
+        GpuDevice*                     gpu            = nullptr;
+        uint32_t                       capacity       = 0;
+        uint32_t                       current        = 0; // the buffer holding the live particles
+        ParticleEmitter                emitter;
+        float                          step_time      = 0.0f;
+        float                          emit_remainder = 0.0f; // fraction of a particle carried to the next step
+        uint32_t                       pending_burst  = 0;
+        uint32_t                       emit_count     = 0;
+        std::array<VkBuffer, 2>        particle_buffers {};
+        std::array<VkDeviceMemory, 2>  particle_buffers_memory {};
+        std::array<VkBuffer, 2>        counter_buffers {};
+        std::array<VkDeviceMemory, 2>  counter_buffers_memory {};
+        VkDescriptorSetLayout          set_layout {};
+        VkDescriptorPool               descriptor_pool {};
+        std::array<VkDescriptorSet, 2> descriptor_sets {}; // set i reads buffer i and writes the other one
+        VkPipelineLayout               pipeline_layout {};
+        VkPipeline                     simulate_pipeline {};
+        VkPipeline                     emit_pipeline {};
+        VkPipeline                     finalize_pipeline {};
+        ParticleStats                  stats;
+    };
+} // namespace vulkanDetails
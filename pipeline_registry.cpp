@@ -0,0 +1,397 @@
+#include "pipeline_registry.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+
+namespace vulkanDetails
+{
+    namespace
+    {
+        constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+        constexpr uint64_t FNV_PRIME  = 1099511628211ull;
+
+        void hashBytes(uint64_t& hash, const void* data, size_t size)
+        {
+            const auto* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++)
+            {
+                hash = (hash ^ bytes[i]) * FNV_PRIME;
+            }
+        }
+
+        template <typename T>
+        void hashValue(uint64_t& hash, const T& value)
+        {
+            hashBytes(hash, &value, sizeof(value));
+        }
+
+        std::vector<char> readBinaryFile(const std::string& path)
+        {
+            std::ifstream file(path, std::ios::ate | std::ios::binary);
+            if (!file.is_open())
+            {
+                return {};
+            }
+            std::vector<char> data(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(data.data(), static_cast<std::streamsize>(data.size()));
+            return data;
+        }
+
+        VkShaderModule loadShaderModule(VkDevice device, const std::string& path)
+        {
+            std::vector<char> code = readBinaryFile(path);
+            if (code.empty())
+            {
+                throw std::runtime_error("failed to open file!");
+            }
+            VkShaderModuleCreateInfo create_info {};
+            create_info.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            create_info.codeSize = code.size();
+            create_info.pCode    = reinterpret_cast<const uint32_t*>(code.data());
+            VkShaderModule shader_module;
+            if (vkCreateShaderModule(device, &create_info, nullptr, &shader_module) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create shader module!");
+            }
+            return shader_module;
+        }
+
+        VkPipelineColorBlendAttachmentState blendState(BlendMode mode)
+        {
+            VkPipelineColorBlendAttachmentState state {};
+            state.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
+                                   VK_COLOR_COMPONENT_A_BIT;
+            state.blendEnable         = mode == BlendMode::Opaque ? VK_FALSE : VK_TRUE;
+            state.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+            state.dstColorBlendFactor =
+                mode == BlendMode::Additive ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            state.colorBlendOp        = VK_BLEND_OP_ADD;
+            state.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            state.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            state.alphaBlendOp        = VK_BLEND_OP_ADD;
+            return state;
+        }
+    } // namespace
+
+    uint64_t GraphicsPipelineDesc::hash() const
+    {
+        // field by field, so struct padding never ends up in the key
+        uint64_t value = FNV_OFFSET;
+        hashBytes(value, vertex_shader.data(), vertex_shader.size());
+        hashValue(value, '\0');
+        hashBytes(value, fragment_shader.data(), fragment_shader.size());
+        hashValue(value, layout);
+        for (const auto& binding : vertex_bindings)
+        {
+            hashValue(value, binding.binding);
+            hashValue(value, binding.stride);
+            hashValue(value, binding.inputRate);
+        }
+        for (const auto& attribute : vertex_attributes)
+        {
+            hashValue(value, attribute.location);
+            hashValue(value, attribute.binding);
+            hashValue(value, attribute.format);
+            hashValue(value, attribute.offset);
+        }
+        hashValue(value, topology);
+        hashValue(value, polygon_mode);
+        hashValue(value, cull_mode);
+        hashValue(value, front_face);
+        hashValue(value, blend);
+        hashValue(value, color_format);
+        hashValue(value, samples);
+        hashValue(value, render_pass == VK_NULL_HANDLE);
+        return value;
+    }
+
+    bool GraphicsPipelineDesc::operator==(const GraphicsPipelineDesc& other) const
+    {
+        auto same_bindings = [](const VkVertexInputBindingDescription& a, const VkVertexInputBindingDescription& b) {
+            return a.binding == b.binding && a.stride == b.stride && a.inputRate == b.inputRate;
+        };
+        auto same_attributes = [](const VkVertexInputAttributeDescription& a,
+                                  const VkVertexInputAttributeDescription& b) {
+            return a.location == b.location && a.binding == b.binding && a.format == b.format && a.offset == b.offset;
+        };
+        return vertex_shader == other.vertex_shader && fragment_shader == other.fragment_shader &&
+               layout == other.layout &&
+               std::equal(vertex_bindings.begin(),
+                          vertex_bindings.end(),
+                          other.vertex_bindings.begin(),
+                          other.vertex_bindings.end(),
+                          same_bindings) &&
+               std::equal(vertex_attributes.begin(),
+                          vertex_attributes.end(),
+                          other.vertex_attributes.begin(),
+                          other.vertex_attributes.end(),
+                          same_attributes) &&
+               topology == other.topology && polygon_mode == other.polygon_mode && cull_mode == other.cull_mode &&
+               front_face == other.front_face && blend == other.blend && color_format == other.color_format &&
+               samples == other.samples && (render_pass == VK_NULL_HANDLE) == (other.render_pass == VK_NULL_HANDLE);
+    }
+
+    void PipelineRegistry::init(VkDevice logical_device, uint32_t compile_threads, const std::string& cache_path)
+    {
+        device              = logical_device;
+        pipeline_cache_path = cache_path;
+        // at least one worker: with none, submit() would compile inline while findOrCompile holds the mutex
+        compile_pool        = std::make_unique<ThreadPool>(std::max(compile_threads, 1u));
+
+        // the driver checks the header and ignores data from another device or driver version
+        std::vector<char>         initial_data = readBinaryFile(cache_path);
+        VkPipelineCacheCreateInfo cache_info {};
+        cache_info.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        cache_info.initialDataSize = initial_data.size();
+        cache_info.pInitialData    = initial_data.empty() ? nullptr : initial_data.data();
+        if (vkCreatePipelineCache(device, &cache_info, nullptr, &pipeline_cache) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create pipeline cache!");
+        }
+    }
+
+    void PipelineRegistry::cleanup()
+    {
+        waitIdle();
+        compile_pool.reset();
+
+        size_t data_size = 0;
+        if (vkGetPipelineCacheData(device, pipeline_cache, &data_size, nullptr) == VK_SUCCESS && data_size > 0)
+        {
+            std::vector<char> data(data_size);
+            if (vkGetPipelineCacheData(device, pipeline_cache, &data_size, data.data()) == VK_SUCCESS)
+            {
+                std::ofstream file(pipeline_cache_path, std::ios::binary | std::ios::trunc);
+                file.write(data.data(), static_cast<std::streamsize>(data_size));
+            }
+        }
+        vkDestroyPipelineCache(device, pipeline_cache, nullptr);
+
+        for (const auto& [desc, entry] : entries)
+        {
+            vkDestroyPipeline(device, entry->pipeline, nullptr);
+        }
+        entries.clear();
+    }
+
+    VkPipeline PipelineRegistry::get(const GraphicsPipelineDesc& desc, VkPipeline fallback)
+    {
+        std::lock_guard lock(mutex);
+        auto            found = entries.find(desc);
+        if (found == entries.end())
+        {
+            findOrCompile(desc);
+            stats.fallbacks++;
+            return fallback;
+        }
+        if (!found->second->ready)
+        {
+            stats.fallbacks++;
+            return fallback;
+        }
+        stats.hits++;
+        return readyPipeline(*found->second);
+    }
+
+    VkPipeline PipelineRegistry::getBlocking(const GraphicsPipelineDesc& desc)
+    {
+        std::shared_future<void> compiled;
+        {
+            std::lock_guard lock(mutex);
+            Entry&          entry = findOrCompile(desc);
+            if (entry.ready)
+            {
+                stats.hits++;
+                return readyPipeline(entry);
+            }
+            compiled = entry.compiled;
+        }
+        compiled.wait();
+        std::lock_guard lock(mutex);
+        return readyPipeline(*entries.at(desc));
+    }
+
+    void PipelineRegistry::waitIdle()
+    {
+        std::vector<std::shared_future<void>> running;
+        {
+            std::lock_guard lock(mutex);
+            for (const auto& [desc, entry] : entries)
+            {
+                if (!entry->ready)
+                {
+                    running.push_back(entry->compiled);
+                }
+            }
+        }
+        for (const auto& compiled : running)
+        {
+            compiled.wait();
+        }
+    }
+
+    PipelineRegistryStats PipelineRegistry::getStats()
+    {
+        std::lock_guard lock(mutex);
+        return stats;
+    }
+
+    PipelineRegistry::Entry& PipelineRegistry::findOrCompile(const GraphicsPipelineDesc& desc)
+    {
+        auto found = entries.find(desc);
+        if (found != entries.end())
+        {
+            return *found->second;
+        }
+        stats.misses++;
+        stats.pending++;
+        auto   inserted = entries.emplace(desc, std::make_unique<Entry>());
+        Entry& entry    = *inserted.first->second;
+        entry.desc      = desc;
+        // entries are never erased before cleanup, which waits for the compile first
+        entry.compiled = compile_pool->submit([this, &entry] { compile(entry); }).share();
+        return entry;
+    }
+
+    void PipelineRegistry::compile(Entry& entry)
+    {
+        auto        start    = std::chrono::high_resolution_clock::now();
+        VkPipeline  pipeline = VK_NULL_HANDLE;
+        std::string error;
+        try
+        {
+            const GraphicsPipelineDesc& desc = entry.desc;
+
+            VkShaderModule vertex_module   = loadShaderModule(device, desc.vertex_shader);
+            VkShaderModule fragment_module = VK_NULL_HANDLE;
+            try
+            {
+                fragment_module = loadShaderModule(device, desc.fragment_shader);
+            }
+            catch (...)
+            {
+                vkDestroyShaderModule(device, vertex_module, nullptr);
+                throw;
+            }
+            std::array<VkPipelineShaderStageCreateInfo, 2> shader_stages {};
+            shader_stages[0].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            shader_stages[0].stage  = VK_SHADER_STAGE_VERTEX_BIT;
+            shader_stages[0].module = vertex_module;
+            shader_stages[0].pName  = "main";
+            shader_stages[1].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            shader_stages[1].stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
+            shader_stages[1].module = fragment_module;
+            shader_stages[1].pName  = "main";
+
+            VkPipelineVertexInputStateCreateInfo vertex_input_info {};
+            vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+            vertex_input_info.vertexBindingDescriptionCount   = static_cast<uint32_t>(desc.vertex_bindings.size());
+            vertex_input_info.pVertexBindingDescriptions      = desc.vertex_bindings.data();
+            vertex_input_info.vertexAttributeDescriptionCount = static_cast<uint32_t>(desc.vertex_attributes.size());
+            vertex_input_info.pVertexAttributeDescriptions    = desc.vertex_attributes.data();
+
+            VkPipelineInputAssemblyStateCreateInfo input_assembly {};
+            input_assembly.sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+            input_assembly.topology               = desc.topology;
+            input_assembly.primitiveRestartEnable = VK_FALSE;
+
+            VkPipelineViewportStateCreateInfo viewport_state {};
+            viewport_state.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+            viewport_state.viewportCount = 1;
+            viewport_state.scissorCount  = 1;
+
+            VkPipelineRasterizationStateCreateInfo rasterizer {};
+            rasterizer.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+            rasterizer.depthClampEnable        = VK_FALSE;
+            rasterizer.rasterizerDiscardEnable = VK_FALSE;
+            rasterizer.polygonMode             = desc.polygon_mode;
+            rasterizer.lineWidth               = 1.0f;
+            rasterizer.cullMode                = desc.cull_mode;
+            rasterizer.frontFace               = desc.front_face;
+            rasterizer.depthBiasEnable         = VK_FALSE;
+
+            VkPipelineMultisampleStateCreateInfo multisampling {};
+            multisampling.sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+            multisampling.sampleShadingEnable  = VK_FALSE;
+            multisampling.rasterizationSamples = desc.samples;
+            multisampling.minSampleShading     = 1.0f;
+
+            VkPipelineColorBlendAttachmentState color_blend_attachment = blendState(desc.blend);
+            VkPipelineColorBlendStateCreateInfo color_blending {};
+            color_blending.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+            color_blending.logicOpEnable   = VK_FALSE;
+            color_blending.logicOp         = VK_LOGIC_OP_COPY;
+            color_blending.attachmentCount = 1;
+            color_blending.pAttachments    = &color_blend_attachment;
+
+            std::array<VkDynamicState, 2>    dynamic_states = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+            VkPipelineDynamicStateCreateInfo dynamic_state {};
+            dynamic_state.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+            dynamic_state.dynamicStateCount = static_cast<uint32_t>(dynamic_states.size());
+            dynamic_state.pDynamicStates    = dynamic_states.data();
+
+            // without a render pass the pipeline is for dynamic rendering and names its attachment format itself
+            VkPipelineRenderingCreateInfo rendering_info {};
+            rendering_info.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+            rendering_info.colorAttachmentCount    = 1;
+            rendering_info.pColorAttachmentFormats = &desc.color_format;
+
+            VkGraphicsPipelineCreateInfo pipeline_info {};
+            pipeline_info.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+            pipeline_info.pNext               = desc.render_pass == VK_NULL_HANDLE ? &rendering_info : nullptr;
+            pipeline_info.stageCount          = static_cast<uint32_t>(shader_stages.size());
+            pipeline_info.pStages             = shader_stages.data();
+            pipeline_info.pVertexInputState   = &vertex_input_info;
+            pipeline_info.pInputAssemblyState = &input_assembly;
+            pipeline_info.pViewportState      = &viewport_state;
+            pipeline_info.pRasterizationState = &rasterizer;
+            pipeline_info.pMultisampleState   = &multisampling;
+            pipeline_info.pDepthStencilState  = nullptr;
+            pipeline_info.pColorBlendState    = &color_blending;
+            pipeline_info.pDynamicState       = &dynamic_state;
+            pipeline_info.layout              = desc.layout;
+            pipeline_info.renderPass          = desc.render_pass;
+            pipeline_info.subpass             = 0;
+            pipeline_info.basePipelineHandle  = VK_NULL_HANDLE;
+            pipeline_info.basePipelineIndex   = -1;
+
+            // the cache is internally synchronized, every worker can compile against it at once
+            VkResult result = vkCreateGraphicsPipelines(device, pipeline_cache, 1, &pipeline_info, nullptr, &pipeline);
+            vkDestroyShaderModule(device, fragment_module, nullptr);
+            vkDestroyShaderModule(device, vertex_module, nullptr);
+            if (result != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create graphics pipeline");
+            }
+        }
+        catch (const std::exception& exception)
+        {
+            error = exception.what();
+        }
+
+        double compile_ms =
+            std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        std::lock_guard lock(mutex);
+        entry.pipeline = pipeline;
+        entry.error    = error;
+        entry.ready    = true;
+        stats.pending--;
+        stats.compiled++;
+        stats.compile_ms += compile_ms;
+        stats.max_compile_ms = std::max(stats.max_compile_ms, compile_ms);
+    }
+
+    VkPipeline PipelineRegistry::readyPipeline(const Entry& entry)
+    {
+        // compile errors surface on the thread that asked for the variant
+        if (!entry.error.empty())
+        {
+            throw std::runtime_error(entry.error + " (" + entry.desc.vertex_shader + ", " +
+                                     entry.desc.fragment_shader + ")");
+        }
+        return entry.pipeline;
+    }
+} // namespace vulkanDetails
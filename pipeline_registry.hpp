@@ -0,0 +1,104 @@
+#pragma once
+#include "thread_pool.hpp"
+#include "vulkan/vulkan.h"
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vulkanDetails
+{
+    enum class BlendMode
+    {
+        Opaque,
+        Alpha,    // src * a + dst * (1 - a)
+        Additive, // src * a + dst
+    };
+
+    // Everything a graphics pipeline is built from. Viewport and scissor are dynamic, so a variant survives
+    // swapchain resizes.
+    struct GraphicsPipelineDesc
+    {
+        std::string                                    vertex_shader;
+        std::string                                    fragment_shader;
+        VkPipelineLayout                               layout {};
+        std::vector<VkVertexInputBindingDescription>   vertex_bindings;
+        std::vector<VkVertexInputAttributeDescription> vertex_attributes;
+        VkPrimitiveTopology                            topology     = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        VkPolygonMode                                  polygon_mode = VK_POLYGON_MODE_FILL;
+        VkCullModeFlags                                cull_mode    = VK_CULL_MODE_BACK_BIT;
+        VkFrontFace                                    front_face   = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        BlendMode                                      blend        = BlendMode::Opaque;
+        VkFormat                                       color_format = VK_FORMAT_UNDEFINED;
+        VkSampleCountFlagBits                          samples      = VK_SAMPLE_COUNT_1_BIT;
+        // Only needed while compiling. Any render pass compatible with color_format and samples produces the same
+        // pipeline, so only whether there is one is hashed and compared; it has to stay alive until the variant is
+        // ready. VK_NULL_HANDLE builds the pipeline for dynamic rendering instead.
+        VkRenderPass                                   render_pass {};
+
+        [[nodiscard]] uint64_t hash() const;
+        bool                   operator==(const GraphicsPipelineDesc& other) const;
+    };
+
+    struct PipelineRegistryStats
+    {
+        uint64_t hits           = 0; // lookups answered with a ready pipeline
+        uint64_t misses         = 0; // lookups that started a compile
+        uint64_t fallbacks      = 0; // lookups answered with the fallback while the variant was compiling
+        uint32_t compiled       = 0;
+        uint32_t pending        = 0;
+        double   compile_ms     = 0.0; // summed over all compiles
+        double   max_compile_ms = 0.0;
+    };
+
+    // Pipeline variants keyed by a hash of their GraphicsPipelineDesc. A miss compiles the variant on a worker
+    // thread against one shared VkPipelineCache, and the caller draws with a fallback (or skips the draw) until it
+    // is ready. Owns every pipeline it hands out.
+    class PipelineRegistry
+    {
+    public:
+        // cache_path is loaded into the VkPipelineCache if it exists and rewritten by cleanup().
+        void init(VkDevice logical_device, uint32_t compile_threads, const std::string& cache_path);
+        void cleanup();
+
+        // The ready variant, or fallback while it compiles; VK_NULL_HANDLE as fallback means "skip the draw".
+        VkPipeline get(const GraphicsPipelineDesc& desc, VkPipeline fallback = VK_NULL_HANDLE);
+        // Waits for the variant, compiling it first on a miss.
+        VkPipeline getBlocking(const GraphicsPipelineDesc& desc);
+        // Waits for every compile that is still running.
+        void       waitIdle();
+
+        [[nodiscard]] PipelineRegistryStats getStats();
+
+    private:
+        struct Entry
+        {
+            GraphicsPipelineDesc     desc;
+            VkPipeline               pipeline {};
+            bool                     ready = false;
+            std::string              error;
+            std::shared_future<void> compiled;
+        };
+
+        struct DescHash
+        {
+            size_t operator()(const GraphicsPipelineDesc& desc) const { return static_cast<size_t>(desc.hash()); }
+        };
+
+        // Called with mutex held; starts the compile on a miss.
+        Entry&            findOrCompile(const GraphicsPipelineDesc& desc);
+        void              compile(Entry& entry);
+        static VkPipeline readyPipeline(const Entry& entry);
+
+        VkDevice                                                                   device {};
+        VkPipelineCache                                                            pipeline_cache {};
+        std::string                                                                pipeline_cache_path;
+        std::unique_ptr<ThreadPool>                                                compile_pool;
+        std::mutex                                                                 mutex;
+        std::unordered_map<GraphicsPipelineDesc, std::unique_ptr<Entry>, DescHash> entries;
+        PipelineRegistryStats                                                      stats;
+    };
+} // namespace vulkanDetails
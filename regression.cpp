@@ -0,0 +1,114 @@
+#include "regression.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <stb/stb_image.h>
+#include <stb/stb_image_write.h>
+#include <stdexcept>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace vulkanDetails
+{
+    bool loadPng(const std::string& path, RgbaImage& image)
+    {
+        int      width, height, channels;
+        stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (!pixels)
+        {
+            return false;
+        }
+        image.width  = static_cast<uint32_t>(width);
+        image.height = static_cast<uint32_t>(height);
+        image.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+        stbi_image_free(pixels);
+        return true;
+    }
+
+    void savePng(const std::string& path, const RgbaImage& image)
+    {
+        if (stbi_write_png(path.c_str(),
+                           static_cast<int>(image.width),
+                           static_cast<int>(image.height),
+                           4,
+                           image.pixels.data(),
+                           static_cast<int>(image.width * 4)) == 0)
+        {
+            throw std::runtime_error("failed to write " + path);
+        }
+    }
+
+    ImageComparison compareImages(const RgbaImage& actual, const RgbaImage& reference, uint32_t tolerance)
+    {
+        ImageComparison comparison {};
+        comparison.same_size = actual.width == reference.width && actual.height == reference.height &&
+                               actual.pixels.size() == reference.pixels.size();
+        if (!comparison.same_size)
+        {
+            return comparison;
+        }
+        size_t pixel_count = static_cast<size_t>(actual.width) * actual.height;
+        for (size_t i = 0; i < pixel_count; i++)
+        {
+            uint32_t pixel_difference = 0;
+            for (size_t channel = 0; channel < 4; channel++)
+            {
+                int difference   = std::abs(actual.pixels[i * 4 + channel] - reference.pixels[i * 4 + channel]);
+                pixel_difference = std::max(pixel_difference, static_cast<uint32_t>(difference));
+            }
+            comparison.max_difference = std::max(comparison.max_difference, pixel_difference);
+            if (pixel_difference > tolerance)
+            {
+                comparison.differing_pixels++;
+            }
+        }
+        if (pixel_count > 0)
+        {
+            comparison.differing_ratio =
+                static_cast<double>(comparison.differing_pixels) / static_cast<double>(pixel_count);
+        }
+        return comparison;
+    }
+
+    std::map<std::string, double> loadBaseline(const std::string& path)
+    {
+        std::map<std::string, double> values;
+        std::ifstream                 file(path);
+        std::string                   metric;
+        double                        value;
+        while (file >> metric >> value)
+        {
+            values[metric] = value;
+        }
+        return values;
+    }
+
+    void saveBaseline(const std::string& path, const std::map<std::string, double>& values)
+    {
+        std::ofstream file(path);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("failed to write " + path);
+        }
+        for (const auto& [metric, value] : values)
+        {
+            file << metric << " " << value << "\n";
+        }
+    }
+
+    double peakResidentMegabytes()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        rusage usage {};
+        getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+        return static_cast<double>(usage.ru_maxrss) / (1024.0 * 1024.0); // bytes
+#else
+        return static_cast<double>(usage.ru_maxrss) / 1024.0; // kilobytes
+#endif
+#else
+        return 0.0;
+#endif
+    }
+} // namespace vulkanDetails
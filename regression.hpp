@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace vulkanDetails
+{
+    // Tightly packed RGBA8 pixels.
+    struct RgbaImage
+    {
+        uint32_t             width  = 0;
+        uint32_t             height = 0;
+        std::vector<uint8_t> pixels;
+    };
+
+    struct ImageComparison
+    {
+        bool     same_size        = false;
+        uint64_t differing_pixels = 0; // pixels with any channel off by more than the tolerance
+        uint32_t max_difference   = 0; // largest channel difference over the whole image
+        double   differing_ratio  = 0.0;
+    };
+
+    // Returns false if the file does not exist or cannot be decoded.
+    bool            loadPng(const std::string& path, RgbaImage& image);
+    void            savePng(const std::string& path, const RgbaImage& image);
+    ImageComparison compareImages(const RgbaImage& actual, const RgbaImage& reference, uint32_t tolerance);
+
+    // Checked-in performance numbers, one "<metric> <value>" pair per line.
+    std::map<std::string, double> loadBaseline(const std::string& path);
+    void                          saveBaseline(const std::string& path, const std::map<std::string, double>& values);
+
+    // Peak resident set size of the process so far; 0 where the platform does not report it.
+    double peakResidentMegabytes();
+} // namespace vulkanDetails
@@ -0,0 +1,764 @@
+#include "render_graph.hpp"
+#include "handle_key.hpp"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace vulkanDetails
+{
+    namespace
+    {
+        struct AccessInfo
+        {
+            VkPipelineStageFlags stage;
+            VkAccessFlags        access;
+            VkAccessFlags        write_access;
+            VkImageLayout        layout;
+            VkImageUsageFlags    usage;
+        };
+
+        AccessInfo accessInfo(ImageAccess access, PassType type)
+        {
+            VkPipelineStageFlags shader_stage =
+                type == PassType::Compute ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                                          : VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+            switch (access)
+            {
+                case ImageAccess::ColorAttachment:
+                    return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                            VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT};
+                case ImageAccess::Sampled:
+                    return {shader_stage,
+                            VK_ACCESS_SHADER_READ_BIT,
+                            0,
+                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                            VK_IMAGE_USAGE_SAMPLED_BIT};
+                case ImageAccess::StorageRead:
+                    return {shader_stage,
+                            VK_ACCESS_SHADER_READ_BIT,
+                            0,
+                            VK_IMAGE_LAYOUT_GENERAL,
+                            VK_IMAGE_USAGE_STORAGE_BIT};
+                case ImageAccess::StorageWrite:
+                    return {shader_stage,
+                            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                            VK_ACCESS_SHADER_WRITE_BIT,
+                            VK_IMAGE_LAYOUT_GENERAL,
+                            VK_IMAGE_USAGE_STORAGE_BIT};
+                case ImageAccess::TransferSrc:
+                    return {VK_PIPELINE_STAGE_TRANSFER_BIT,
+                            VK_ACCESS_TRANSFER_READ_BIT,
+                            0,
+                            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                            VK_IMAGE_USAGE_TRANSFER_SRC_BIT};
+                case ImageAccess::TransferDst:
+                    return {VK_PIPELINE_STAGE_TRANSFER_BIT,
+                            VK_ACCESS_TRANSFER_WRITE_BIT,
+                            VK_ACCESS_TRANSFER_WRITE_BIT,
+                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            VK_IMAGE_USAGE_TRANSFER_DST_BIT};
+            }
+            throw std::runtime_error("unknown image access!");
+        }
+    } // namespace
+
+    void RenderGraph::PassBuilder::read(ResourceId resource, ImageAccess access)
+    {
+        graph.passes[pass].accesses.push_back({resource, access, false});
+    }
+
+    void RenderGraph::PassBuilder::write(ResourceId resource, ImageAccess access)
+    {
+        graph.passes[pass].accesses.push_back({resource, access, true});
+    }
+
+    void RenderGraph::PassBuilder::colorAttachment(ResourceId         resource,
+                                                   VkAttachmentLoadOp load_op,
+                                                   VkClearColorValue  clear_color)
+    {
+        VkClearValue clear_value {};
+        clear_value.color = clear_color;
+        graph.passes[pass].color_attachments.push_back({resource, load_op, clear_value});
+        graph.passes[pass].accesses.push_back({resource, ImageAccess::ColorAttachment, true});
+    }
+
+    void RenderGraph::PassBuilder::resolveAttachment(ResourceId resource)
+    {
+        graph.passes[pass].resolve_attachment = resource;
+        graph.passes[pass].accesses.push_back({resource, ImageAccess::ColorAttachment, true});
+    }
+
+    void RenderGraph::PassBuilder::sideEffect() { graph.passes[pass].side_effect = true; }
+
+    void RenderGraph::init(VkPhysicalDevice gpu,
+                           VkDevice         logical_device,
+                           DeletionQueue&   retired,
+                           bool             dynamic_rendering)
+    {
+        physical_device = gpu;
+        device          = logical_device;
+        deletion_queue  = &retired;
+        if (dynamic_rendering)
+        {
+            begin_rendering = reinterpret_cast<PFN_vkCmdBeginRendering>(
+                vkGetDeviceProcAddr(device, "vkCmdBeginRendering"));
+            end_rendering = reinterpret_cast<PFN_vkCmdEndRendering>(vkGetDeviceProcAddr(device, "vkCmdEndRendering"));
+        }
+    }
+
+    void RenderGraph::cleanup()
+    {
+        destroyTransients();
+        releaseFramebuffers();
+        for (const auto& [key, render_pass] : render_pass_cache)
+        {
+            vkDestroyRenderPass(device, render_pass, nullptr);
+        }
+        render_pass_cache.clear();
+    }
+
+    void RenderGraph::releaseFramebuffers()
+    {
+        for (const auto& [key, framebuffer] : framebuffer_cache)
+        {
+            vkDestroyFramebuffer(device, framebuffer, nullptr);
+        }
+        framebuffer_cache.clear();
+    }
+
+    void RenderGraph::reset()
+    {
+        resources.clear();
+        passes.clear();
+        final_barriers.clear();
+        stats          = {};
+    }
+
+    RenderGraph::ResourceId RenderGraph::importImage(const std::string&    name,
+                                                     VkImage               image,
+                                                     VkImageView           view,
+                                                     VkFormat              format,
+                                                     VkExtent2D            extent,
+                                                     VkSampleCountFlagBits samples,
+                                                     VkImageLayout         initial_layout,
+                                                     VkPipelineStageFlags  initial_stages,
+                                                     VkImageLayout         final_layout)
+    {
+        Resource resource {};
+        resource.name           = name;
+        resource.imported       = true;
+        resource.desc           = {extent.width, extent.height, format, 0, samples};
+        resource.image          = image;
+        resource.view           = view;
+        resource.initial_layout = initial_layout;
+        resource.initial_stages = initial_stages;
+        resource.final_layout   = final_layout;
+        resources.push_back(resource);
+        return static_cast<ResourceId>(resources.size() - 1);
+    }
+
+    RenderGraph::ResourceId RenderGraph::createImage(const std::string& name, const TransientImageDesc& desc)
+    {
+        Resource resource {};
+        resource.name = name;
+        resource.desc = desc;
+        resources.push_back(resource);
+        return static_cast<ResourceId>(resources.size() - 1);
+    }
+
+    RenderGraph::PassId RenderGraph::addPass(const std::string&                       name,
+                                             PassType                                 type,
+                                             const std::function<void(PassBuilder&)>& setup,
+                                             ExecuteFn                                execute)
+    {
+        auto pass_id = static_cast<PassId>(passes.size());
+        Pass pass {};
+        pass.name    = name;
+        pass.type    = type;
+        pass.execute = std::move(execute);
+        passes.push_back(std::move(pass));
+        PassBuilder builder(*this, pass_id);
+        setup(builder);
+        return pass_id;
+    }
+
+    void RenderGraph::markOutput(ResourceId resource) { resources[resource].output = true; }
+
+    VkImage RenderGraph::getImage(ResourceId resource) const { return resources[resource].image; }
+
+    VkImageView RenderGraph::getImageView(ResourceId resource) const { return resources[resource].view; }
+
+    void RenderGraph::compile()
+    {
+        cullPasses();
+        allocateTransients();
+        buildBarriers();
+        createRenderPasses();
+    }
+
+    void RenderGraph::cullPasses()
+    {
+        // walk backwards from the outputs; a pass survives if something that is still needed depends on its writes
+        std::vector<bool> needed(resources.size());
+        for (size_t i = 0; i < resources.size(); i++)
+        {
+            needed[i] = resources[i].output ||
+                        (resources[i].imported && resources[i].final_layout != VK_IMAGE_LAYOUT_UNDEFINED);
+        }
+        for (size_t i = passes.size(); i-- > 0;)
+        {
+            Pass& pass  = passes[i];
+            pass.culled = !pass.side_effect && std::none_of(pass.accesses.begin(),
+                                                            pass.accesses.end(),
+                                                            [&needed](const Access& access) {
+                                                                return access.write && needed[access.resource];
+                                                            });
+            if (pass.culled)
+            {
+                stats.culled_pass_count++;
+                continue;
+            }
+            for (const auto& access : pass.accesses)
+            {
+                if (!access.write)
+                {
+                    needed[access.resource] = true;
+                }
+            }
+            for (const auto& attachment : pass.color_attachments)
+            {
+                if (attachment.load_op == VK_ATTACHMENT_LOAD_OP_LOAD)
+                {
+                    needed[attachment.resource] = true;
+                }
+            }
+        }
+        stats.pass_count = static_cast<uint32_t>(passes.size());
+    }
+
+    void RenderGraph::allocateTransients()
+    {
+        // lifetimes are measured in pass indices of the surviving passes
+        std::vector<TransientImage> wanted;
+        for (uint32_t pass_index = 0; pass_index < passes.size(); pass_index++)
+        {
+            if (passes[pass_index].culled)
+            {
+                continue;
+            }
+            for (const auto& access : passes[pass_index].accesses)
+            {
+                Resource& resource = resources[access.resource];
+                if (resource.imported)
+                {
+                    continue;
+                }
+                if (!resource.transient)
+                {
+                    resource.transient = wanted.size();
+                    wanted.push_back({resource.desc, pass_index, pass_index});
+                }
+                TransientImage& transient = wanted[*resource.transient];
+                transient.last_pass       = pass_index;
+                transient.desc.usage |= accessInfo(access.access, passes[pass_index].type).usage;
+            }
+        }
+
+        bool same_shape = wanted.size() == transients.size() &&
+                          std::equal(wanted.begin(),
+                                     wanted.end(),
+                                     transients.begin(),
+                                     [](const TransientImage& a, const TransientImage& b) {
+                                         return a.desc == b.desc && a.first_pass == b.first_pass &&
+                                                a.last_pass == b.last_pass;
+                                     });
+        if (!same_shape)
+        {
+            retireTransients();
+            transients = std::move(wanted);
+
+            std::vector<VkMemoryRequirements> requirements(transients.size());
+            for (size_t i = 0; i < transients.size(); i++)
+            {
+                const TransientImageDesc& desc = transients[i].desc;
+                VkImageCreateInfo         image_info {};
+                image_info.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+                image_info.imageType     = VK_IMAGE_TYPE_2D;
+                image_info.extent.width  = desc.width;
+                image_info.extent.height = desc.height;
+                image_info.extent.depth  = 1;
+                image_info.mipLevels     = 1;
+                image_info.arrayLayers   = 1;
+                image_info.format        = desc.format;
+                image_info.tiling        = VK_IMAGE_TILING_OPTIMAL;
+                image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                image_info.usage         = desc.usage;
+                image_info.samples       = desc.samples;
+                image_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+                if (vkCreateImage(device, &image_info, nullptr, &transients[i].image) != VK_SUCCESS)
+                {
+                    throw std::runtime_error("failed to create transient image!");
+                }
+                vkGetImageMemoryRequirements(device, transients[i].image, &requirements[i]);
+            }
+
+            // greedy interval packing: an image moves into the first block whose occupants are all dead by the
+            // time it is first used. lazily allocated (tile memory) blocks never mix with regular ones.
+            std::vector<size_t> order(transients.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+                return transients[a].first_pass < transients[b].first_pass;
+            });
+            for (size_t index : order)
+            {
+                TransientImage& transient = transients[index];
+                bool            lazily    = (transient.desc.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0;
+                auto            block     = std::find_if(blocks.begin(), blocks.end(), [&](const MemoryBlock& b) {
+                    return b.last_pass < transient.first_pass && b.lazily == lazily &&
+                           (b.type_bits & requirements[index].memoryTypeBits) != 0;
+                });
+                if (block == blocks.end())
+                {
+                    blocks.push_back({});
+                    block         = blocks.end() - 1;
+                    block->lazily = lazily;
+                }
+                block->size = std::max(block->size, requirements[index].size);
+                block->type_bits &= requirements[index].memoryTypeBits;
+                block->last_pass = transient.last_pass;
+                transient.block  = static_cast<uint32_t>(block - blocks.begin());
+            }
+
+            for (auto& block : blocks)
+            {
+                uint32_t memory_type = findMemoryType(
+                    block.type_bits,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | (block.lazily ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0));
+                if (memory_type == UINT32_MAX)
+                {
+                    memory_type = findMemoryType(block.type_bits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+                }
+                if (memory_type == UINT32_MAX)
+                {
+                    throw std::runtime_error("failed to find a memory type for transient images!");
+                }
+                VkMemoryAllocateInfo alloc_info {};
+                alloc_info.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+                alloc_info.allocationSize  = block.size;
+                alloc_info.memoryTypeIndex = memory_type;
+                if (vkAllocateMemory(device, &alloc_info, nullptr, &block.memory) != VK_SUCCESS)
+                {
+                    throw std::runtime_error("failed to allocate transient image memory!");
+                }
+            }
+
+            for (auto& transient : transients)
+            {
+                vkBindImageMemory(device, transient.image, blocks[transient.block].memory, 0);
+
+                VkImageViewCreateInfo view_info {};
+                view_info.sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+                view_info.image            = transient.image;
+                view_info.viewType         = VK_IMAGE_VIEW_TYPE_2D;
+                view_info.format           = transient.desc.format;
+                view_info.subresourceRange = wholeImageRange(transient.desc.format);
+                if (vkCreateImageView(device, &view_info, nullptr, &transient.view) != VK_SUCCESS)
+                {
+                    throw std::runtime_error("failed to create transient image view!");
+                }
+            }
+        }
+
+        for (auto& resource : resources)
+        {
+            if (resource.transient)
+            {
+                resource.image = transients[*resource.transient].image;
+                resource.view  = transients[*resource.transient].view;
+            }
+        }
+        for (const auto& transient : transients)
+        {
+            VkMemoryRequirements requirements;
+            vkGetImageMemoryRequirements(device, transient.image, &requirements);
+            stats.transient_bytes += requirements.size;
+        }
+        for (const auto& block : blocks)
+        {
+            stats.allocated_bytes += block.size;
+        }
+    }
+
+    void RenderGraph::destroyTransients()
+    {
+        for (const auto& transient : transients)
+        {
+            vkDestroyImageView(device, transient.view, nullptr);
+            vkDestroyImage(device, transient.image, nullptr);
+        }
+        for (const auto& block : blocks)
+        {
+            vkFreeMemory(device, block.memory, nullptr);
+        }
+        transients.clear();
+        blocks.clear();
+    }
+
+    void RenderGraph::retireTransients()
+    {
+        // frames still in flight may be using the old images and the framebuffers built on them
+        for (const auto& [key, framebuffer] : framebuffer_cache)
+        {
+            deletion_queue->destroyFramebuffer(framebuffer);
+        }
+        framebuffer_cache.clear();
+        for (const auto& transient : transients)
+        {
+            deletion_queue->destroyImageView(transient.view);
+            deletion_queue->destroyImage(transient.image);
+        }
+        for (const auto& block : blocks)
+        {
+            deletion_queue->freeMemory(block.memory);
+        }
+        transients.clear();
+        blocks.clear();
+    }
+
+    void RenderGraph::buildBarriers()
+    {
+        std::vector<AccessState> states(resources.size());
+        std::vector<bool>        touched(resources.size());
+        std::vector<AccessState> block_states(blocks.size());
+        for (size_t i = 0; i < blocks.size(); i++)
+        {
+            block_states[i] = blocks[i].carried;
+        }
+        for (size_t i = 0; i < resources.size(); i++)
+        {
+            if (resources[i].imported)
+            {
+                states[i] = {resources[i].initial_layout, resources[i].initial_stages, 0};
+            }
+        }
+
+        for (auto& pass : passes)
+        {
+            pass.barriers.clear();
+            if (pass.culled)
+            {
+                continue;
+            }
+            for (const auto& access : pass.accesses)
+            {
+                const Resource& resource = resources[access.resource];
+                AccessState&    state    = states[access.resource];
+                AccessInfo      info     = accessInfo(access.access, pass.type);
+                bool            first    = !touched[access.resource];
+                touched[access.resource] = true;
+                if (first && resource.transient)
+                {
+                    // an aliased image inherits whatever the previous occupant of its memory was doing
+                    state        = block_states[transients[*resource.transient].block];
+                    state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+                }
+
+                // cleared/don't-care attachments and resolve targets overwrite everything, so the old contents
+                // (and layout) can be dropped
+                auto attachment = std::find_if(
+                    pass.color_attachments.begin(), pass.color_attachments.end(), [&access](const Attachment& a) {
+                        return a.resource == access.resource;
+                    });
+                bool discards =
+                    access.write && access.access == ImageAccess::ColorAttachment &&
+                    (attachment == pass.color_attachments.end() || attachment->load_op != VK_ATTACHMENT_LOAD_OP_LOAD);
+
+                // read-after-read in the same layout is the only case that needs nothing
+                if (state.layout != info.layout || state.write_access != 0 || access.write)
+                {
+                    pass.barriers.imageBarrier(resource.image,
+                                               first && discards ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout,
+                                               info.layout,
+                                               wholeImageRange(resource.desc.format),
+                                               state.stages,
+                                               state.write_access,
+                                               info.stage,
+                                               info.access);
+                    state = {info.layout, info.stage, access.write ? info.write_access : 0};
+                }
+                else
+                {
+                    state.stages |= info.stage;
+                }
+                if (resource.transient)
+                {
+                    block_states[transients[*resource.transient].block] = state;
+                }
+            }
+            stats.barrier_count += static_cast<uint32_t>(pass.barriers.size());
+        }
+
+        for (size_t i = 0; i < resources.size(); i++)
+        {
+            const Resource& resource = resources[i];
+            if (resource.imported && resource.final_layout != VK_IMAGE_LAYOUT_UNDEFINED &&
+                states[i].layout != resource.final_layout)
+            {
+                final_barriers.imageBarrier(resource.image,
+                                            states[i].layout,
+                                            resource.final_layout,
+                                            wholeImageRange(resource.desc.format),
+                                            states[i].stages,
+                                            states[i].write_access,
+                                            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                            0);
+            }
+        }
+        stats.barrier_count += static_cast<uint32_t>(final_barriers.size());
+        for (size_t i = 0; i < blocks.size(); i++)
+        {
+            blocks[i].carried = block_states[i];
+        }
+    }
+
+    VkAttachmentStoreOp RenderGraph::storeOpFor(ResourceId resource, uint32_t pass) const
+    {
+        if (resources[resource].imported || resources[resource].output)
+        {
+            return VK_ATTACHMENT_STORE_OP_STORE;
+        }
+        for (uint32_t later = pass + 1; later < passes.size(); later++)
+        {
+            if (passes[later].culled)
+            {
+                continue;
+            }
+            for (const auto& access : passes[later].accesses)
+            {
+                if (access.resource == resource)
+                {
+                    return VK_ATTACHMENT_STORE_OP_STORE;
+                }
+            }
+        }
+        // e.g. a multisample target that is resolved in the same pass never has to leave tile memory
+        return VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    }
+
+    void RenderGraph::createRenderPasses()
+    {
+        for (uint32_t pass_index = 0; pass_index < passes.size(); pass_index++)
+        {
+            Pass& pass = passes[pass_index];
+            if (pass.culled || pass.type != PassType::Graphics || pass.color_attachments.empty())
+            {
+                continue;
+            }
+            const Resource& first_attachment = resources[pass.color_attachments.front().resource];
+            pass.extent                      = {first_attachment.desc.width, first_attachment.desc.height};
+            if (begin_rendering != nullptr)
+            {
+                // nothing to build, beginRendering takes the views and ops as they are each frame
+                continue;
+            }
+
+            // the barriers already put every attachment into COLOR_ATTACHMENT_OPTIMAL, the pass leaves it there
+            std::vector<VkAttachmentDescription> descriptions;
+            std::vector<VkAttachmentReference>   color_refs;
+            std::vector<VkImageView>             views;
+            std::vector<uint64_t>                key;
+            for (const auto& attachment : pass.color_attachments)
+            {
+                const Resource&         resource = resources[attachment.resource];
+                VkAttachmentDescription description {};
+                description.format         = resource.desc.format;
+                description.samples        = resource.desc.samples;
+                description.loadOp         = attachment.load_op;
+                description.storeOp        = storeOpFor(attachment.resource, pass_index);
+                description.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                description.initialLayout  = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+                description.finalLayout    = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+                color_refs.push_back({static_cast<uint32_t>(descriptions.size()),
+                                      VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+                descriptions.push_back(description);
+                views.push_back(resource.view);
+                key.push_back(description.format);
+                key.push_back(description.samples);
+                key.push_back(description.loadOp);
+                key.push_back(description.storeOp);
+            }
+            VkAttachmentReference resolve_ref {};
+            if (pass.resolve_attachment)
+            {
+                const Resource&         resource = resources[*pass.resolve_attachment];
+                VkAttachmentDescription description {};
+                description.format         = resource.desc.format;
+                description.samples        = VK_SAMPLE_COUNT_1_BIT;
+                description.loadOp         = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                description.storeOp        = storeOpFor(*pass.resolve_attachment, pass_index);
+                description.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                description.initialLayout  = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+                description.finalLayout    = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+                resolve_ref = {static_cast<uint32_t>(descriptions.size()), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+                descriptions.push_back(description);
+                views.push_back(resource.view);
+                key.push_back(UINT32_MAX); // resolve marker
+                key.push_back(description.format);
+                key.push_back(description.storeOp);
+            }
+
+            auto cached_pass = render_pass_cache.find(key);
+            if (cached_pass == render_pass_cache.end())
+            {
+                VkSubpassDescription subpass {};
+                subpass.pipelineBindPoint    = VK_PIPELINE_BIND_POINT_GRAPHICS;
+                subpass.colorAttachmentCount = static_cast<uint32_t>(color_refs.size());
+                subpass.pColorAttachments    = color_refs.data();
+                subpass.pResolveAttachments  = pass.resolve_attachment ? &resolve_ref : nullptr;
+
+                VkRenderPassCreateInfo render_pass_info {};
+                render_pass_info.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+                render_pass_info.attachmentCount = static_cast<uint32_t>(descriptions.size());
+                render_pass_info.pAttachments    = descriptions.data();
+                render_pass_info.subpassCount    = 1;
+                render_pass_info.pSubpasses      = &subpass;
+
+                VkRenderPass render_pass;
+                if (vkCreateRenderPass(device, &render_pass_info, nullptr, &render_pass) != VK_SUCCESS)
+                {
+                    throw std::runtime_error("failed to create render graph pass!");
+                }
+                cached_pass = render_pass_cache.emplace(key, render_pass).first;
+            }
+            pass.render_pass = cached_pass->second;
+
+            std::vector<uint64_t> framebuffer_key = {
+                handleKey(pass.render_pass), pass.extent.width, pass.extent.height};
+            for (VkImageView view : views)
+            {
+                framebuffer_key.push_back(handleKey(view));
+            }
+            auto cached_framebuffer = framebuffer_cache.find(framebuffer_key);
+            if (cached_framebuffer == framebuffer_cache.end())
+            {
+                VkFramebufferCreateInfo framebuffer_info {};
+                framebuffer_info.sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+                framebuffer_info.renderPass      = pass.render_pass;
+                framebuffer_info.attachmentCount = static_cast<uint32_t>(views.size());
+                framebuffer_info.pAttachments    = views.data();
+                framebuffer_info.width           = pass.extent.width;
+                framebuffer_info.height          = pass.extent.height;
+                framebuffer_info.layers          = 1;
+
+                VkFramebuffer framebuffer;
+                if (vkCreateFramebuffer(device, &framebuffer_info, nullptr, &framebuffer) != VK_SUCCESS)
+                {
+                    throw std::runtime_error("failed to create render graph framebuffer!");
+                }
+                cached_framebuffer = framebuffer_cache.emplace(framebuffer_key, framebuffer).first;
+            }
+            pass.framebuffer = cached_framebuffer->second;
+        }
+    }
+
+    void RenderGraph::execute(VkCommandBuffer command_buffer) const
+    {
+        for (uint32_t pass_index = 0; pass_index < passes.size(); pass_index++)
+        {
+            const Pass& pass = passes[pass_index];
+            if (pass.culled)
+            {
+                continue;
+            }
+            pass.barriers.record(command_buffer);
+            if (begin_rendering != nullptr && pass.type == PassType::Graphics && !pass.color_attachments.empty())
+            {
+                beginRendering(command_buffer, pass_index);
+                pass.execute(command_buffer);
+                end_rendering(command_buffer);
+                continue;
+            }
+            if (pass.render_pass == VK_NULL_HANDLE)
+            {
+                pass.execute(command_buffer);
+                continue;
+            }
+
+            // one clear value per attachment, the resolve slot is ignored
+            std::vector<VkClearValue> clear_values;
+            for (const auto& attachment : pass.color_attachments)
+            {
+                clear_values.push_back(attachment.clear_value);
+            }
+            clear_values.push_back({});
+
+            VkRenderPassBeginInfo render_pass_info {};
+            render_pass_info.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            render_pass_info.renderPass        = pass.render_pass;
+            render_pass_info.framebuffer       = pass.framebuffer;
+            render_pass_info.renderArea.offset = {0, 0};
+            render_pass_info.renderArea.extent = pass.extent;
+            render_pass_info.clearValueCount   = static_cast<uint32_t>(clear_values.size());
+            render_pass_info.pClearValues      = clear_values.data();
+            vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+            pass.execute(command_buffer);
+            vkCmdEndRenderPass(command_buffer);
+        }
+        final_barriers.record(command_buffer);
+    }
+
+    void RenderGraph::beginRendering(VkCommandBuffer command_buffer, uint32_t pass_index) const
+    {
+        const Pass& pass = passes[pass_index];
+        // same layouts, ops and resolve as the render pass createRenderPasses would have built
+        std::vector<VkRenderingAttachmentInfo> color_attachments;
+        for (const auto& attachment : pass.color_attachments)
+        {
+            VkRenderingAttachmentInfo attachment_info {};
+            attachment_info.sType       = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+            attachment_info.imageView   = resources[attachment.resource].view;
+            attachment_info.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            attachment_info.resolveMode = VK_RESOLVE_MODE_NONE;
+            attachment_info.loadOp      = attachment.load_op;
+            attachment_info.storeOp     = storeOpFor(attachment.resource, pass_index);
+            attachment_info.clearValue  = attachment.clear_value;
+            color_attachments.push_back(attachment_info);
+        }
+        if (pass.resolve_attachment)
+        {
+            // the render pass path resolves the first attachment too
+            color_attachments.front().resolveMode        = VK_RESOLVE_MODE_AVERAGE_BIT;
+            color_attachments.front().resolveImageView   = resources[*pass.resolve_attachment].view;
+            color_attachments.front().resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        }
+
+        VkRenderingInfo rendering_info {};
+        rendering_info.sType                = VK_STRUCTURE_TYPE_RENDERING_INFO;
+        rendering_info.renderArea.offset    = {0, 0};
+        rendering_info.renderArea.extent    = pass.extent;
+        rendering_info.layerCount           = 1;
+        rendering_info.colorAttachmentCount = static_cast<uint32_t>(color_attachments.size());
+        rendering_info.pColorAttachments    = color_attachments.data();
+        begin_rendering(command_buffer, &rendering_info);
+    }
+
+    uint32_t RenderGraph::findMemoryType(uint32_t type_bits, VkMemoryPropertyFlags properties) const
+    {
+        VkPhysicalDeviceMemoryProperties mem_properties;
+        vkGetPhysicalDeviceMemoryProperties(physical_device, &mem_properties);
+        for (uint32_t i = 0; i < mem_properties.memoryTypeCount; i++)
+        {
+            if ((type_bits & (1u << i)) != 0 &&
+                (mem_properties.memoryTypes[i].propertyFlags & properties) == properties)
+            {
+                return i;
+            }
+        }
+        return UINT32_MAX;
+    }
+} // namespace vulkanDetails
@@ -0,0 +1,223 @@
+#pragma once
+#include "barrier_batch.hpp"
+#include "deletion_queue.hpp"
+#include "vulkan/vulkan.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace vulkanDetails
+{
+    enum class PassType
+    {
+        Graphics,
+        Compute,
+        Transfer,
+    };
+
+    // How a pass touches an image; decides the layout, pipeline stage and access mask the graph synchronizes on.
+    enum class ImageAccess
+    {
+        ColorAttachment,
+        Sampled,
+        StorageRead,
+        StorageWrite,
+        TransferSrc,
+        TransferDst,
+    };
+
+    // Images that only live within one frame. Usage bits implied by the declared accesses are added automatically;
+    // TRANSIENT_ATTACHMENT here also asks for lazily allocated memory.
+    struct TransientImageDesc
+    {
+        uint32_t              width   = 0;
+        uint32_t              height  = 0;
+        VkFormat              format  = VK_FORMAT_UNDEFINED;
+        VkImageUsageFlags     usage   = 0;
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+        bool operator==(const TransientImageDesc&) const = default;
+    };
+
+    struct RenderGraphStats
+    {
+        uint32_t     pass_count        = 0;
+        uint32_t     culled_pass_count = 0;
+        uint32_t     barrier_count     = 0;
+        VkDeviceSize transient_bytes   = 0; // memory the transient images would need without aliasing
+        VkDeviceSize allocated_bytes   = 0; // memory actually bound to them
+    };
+
+    // Frame graph: passes declare which images they read and write, compile() culls passes that do not contribute
+    // to an output, derives the image barriers between them and lets transient images with disjoint lifetimes share
+    // memory. Graphics passes get a render pass and framebuffer built from their attachments, or with dynamic
+    // rendering are begun straight from their attachments' views.
+    //
+    // The graph is rebuilt every frame (reset, import/create, addPass, compile, execute); transient images, render
+    // passes and framebuffers are cached across frames as long as the frame keeps the same shape.
+    class RenderGraph
+    {
+    public:
+        using ResourceId = uint32_t;
+        using PassId     = uint32_t;
+        using ExecuteFn  = std::function<void(VkCommandBuffer)>;
+
+        class PassBuilder
+        {
+        public:
+            void read(ResourceId resource, ImageAccess access);
+            void write(ResourceId resource, ImageAccess access);
+            // Attachments are bound in declaration order; load_op LOAD also counts as a read of the old contents.
+            void colorAttachment(ResourceId resource, VkAttachmentLoadOp load_op, VkClearColorValue clear_color = {});
+            void resolveAttachment(ResourceId resource);
+            // Keeps the pass alive even if nothing it writes is consumed, e.g. for work on untracked buffers.
+            void sideEffect();
+
+        private:
+            friend class RenderGraph;
+            PassBuilder(RenderGraph& render_graph, PassId pass_id) : graph(render_graph), pass(pass_id) {}
+
+            RenderGraph& graph;
+            PassId       pass;
+        };
+
+        // Transient images that are replaced while frames are in flight are handed to deletion_queue.
+        // dynamic_rendering needs the feature enabled on device; no render pass or framebuffer is created then.
+        void init(VkPhysicalDevice physical_device,
+                  VkDevice         device,
+                  DeletionQueue&   deletion_queue,
+                  bool             dynamic_rendering);
+        void cleanup();
+        // Destroys cached framebuffers; call when imported image views (e.g. the swapchain's) go away.
+        void releaseFramebuffers();
+
+        void       reset();
+        ResourceId importImage(const std::string&    name,
+                               VkImage               image,
+                               VkImageView           view,
+                               VkFormat              format,
+                               VkExtent2D            extent,
+                               VkSampleCountFlagBits samples,
+                               VkImageLayout         initial_layout,
+                               VkPipelineStageFlags  initial_stages,
+                               VkImageLayout         final_layout);
+        ResourceId createImage(const std::string& name, const TransientImageDesc& desc);
+        PassId     addPass(const std::string&                       name,
+                           PassType                                 type,
+                           const std::function<void(PassBuilder&)>& setup,
+                           ExecuteFn                                execute);
+        // Imported images with a final layout are outputs already; this marks any other image as one.
+        void       markOutput(ResourceId resource);
+
+        void compile();
+        void execute(VkCommandBuffer command_buffer) const;
+
+        [[nodiscard]] VkImage                 getImage(ResourceId resource) const;
+        [[nodiscard]] VkImageView             getImageView(ResourceId resource) const;
+        [[nodiscard]] VkRenderPass            getRenderPass(PassId pass) const { return passes[pass].render_pass; }
+        [[nodiscard]] const RenderGraphStats& getStats() const { return stats; }
+
+    private:
+        struct Access
+        {
+            ResourceId  resource;
+            ImageAccess access;
+            bool        write;
+        };
+
+        struct Attachment
+        {
+            ResourceId         resource;
+            VkAttachmentLoadOp load_op;
+            VkClearValue       clear_value;
+        };
+
+        struct Pass
+        {
+            std::string               name;
+            PassType                  type;
+            std::vector<Access>       accesses;
+            std::vector<Attachment>   color_attachments;
+            std::optional<ResourceId> resolve_attachment;
+            bool                      side_effect = false;
+            bool                      culled      = false;
+            ExecuteFn                 execute;
+            BarrierBatch              barriers;
+            VkRenderPass              render_pass {};
+            VkFramebuffer             framebuffer {};
+            VkExtent2D                extent {};
+        };
+
+        struct Resource
+        {
+            std::string           name;
+            bool                  imported = false;
+            bool                  output   = false;
+            TransientImageDesc    desc;
+            VkImage               image {};
+            VkImageView           view {};
+            VkImageLayout         initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkPipelineStageFlags  initial_stages = 0;
+            VkImageLayout         final_layout   = VK_IMAGE_LAYOUT_UNDEFINED;
+            std::optional<size_t> transient; // index into transients once compiled
+        };
+
+        // Synchronization state of an image (or of a memory block) while the frame is simulated in compile().
+        struct AccessState
+        {
+            VkImageLayout        layout       = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkPipelineStageFlags stages       = 0;
+            VkAccessFlags        write_access = 0;
+        };
+
+        struct TransientImage
+        {
+            TransientImageDesc desc;
+            uint32_t           first_pass = 0;
+            uint32_t           last_pass  = 0;
+            VkImage            image {};
+            VkImageView        view {};
+            uint32_t           block = 0;
+        };
+
+        struct MemoryBlock
+        {
+            VkDeviceMemory memory {};
+            VkDeviceSize   size      = 0;
+            uint32_t       type_bits = ~0u;
+            uint32_t       last_pass = 0;
+            bool           lazily    = false;
+            // state left behind by the previous frame, the first occupant of this frame waits on it
+            AccessState    carried;
+        };
+
+        void cullPasses();
+        void allocateTransients();
+        void destroyTransients();
+        void retireTransients();
+        void buildBarriers();
+        void createRenderPasses();
+        void beginRendering(VkCommandBuffer command_buffer, uint32_t pass_index) const;
+        [[nodiscard]] VkAttachmentStoreOp storeOpFor(ResourceId resource, uint32_t pass) const;
+        [[nodiscard]] uint32_t findMemoryType(uint32_t type_bits, VkMemoryPropertyFlags properties) const;
+
+        VkPhysicalDevice physical_device {};
+        VkDevice         device {};
+        DeletionQueue*   deletion_queue = nullptr;
+
+        PFN_vkCmdBeginRendering begin_rendering = nullptr; // both null on the render pass path
+        PFN_vkCmdEndRendering   end_rendering   = nullptr;
+
+        std::vector<Resource>                          resources;
+        std::vector<Pass>                              passes;
+        BarrierBatch                                   final_barriers;
+        std::vector<TransientImage>                    transients;
+        std::vector<MemoryBlock>                       blocks;
+        std::map<std::vector<uint64_t>, VkRenderPass>  render_pass_cache;
+        std::map<std::vector<uint64_t>, VkFramebuffer> framebuffer_cache;
+        RenderGraphStats                               stats;
+    };
+} // namespace vulkanDetails
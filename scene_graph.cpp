@@ -0,0 +1,171 @@
+#include "scene_graph.hpp"
+#include <algorithm>
+
+namespace vulkanDetails
+{
+    SceneGraph::NodeId SceneGraph::addNode(NodeId parent, const glm::mat4& local_transform, const glm::vec4& bounds)
+    {
+        auto     node        = static_cast<NodeId>(node_slots.size());
+        uint32_t parent_slot = parent == NO_PARENT ? NO_PARENT : node_slots[parent];
+        uint32_t depth       = parent == NO_PARENT ? 0 : depths[parent_slot] + 1;
+
+        // appended at the end; update() moves it into its depth level before the next traversal
+        node_slots.push_back(static_cast<uint32_t>(parents.size()));
+        slot_nodes.push_back(node);
+        local_transforms.push_back(local_transform);
+        world_transforms.push_back(local_transform);
+        local_bounds.push_back(bounds);
+        parents.push_back(parent_slot);
+        depths.push_back(depth);
+        dirty.push_back(1);
+        order_dirty     = true;
+        transform_dirty = true;
+        return node;
+    }
+
+    void SceneGraph::setLocalTransform(NodeId node, const glm::mat4& local_transform)
+    {
+        uint32_t slot          = node_slots[node];
+        local_transforms[slot] = local_transform;
+        dirty[slot]            = 1;
+        transform_dirty        = true;
+    }
+
+    void SceneGraph::reserve(size_t count)
+    {
+        local_transforms.reserve(count);
+        world_transforms.reserve(count);
+        local_bounds.reserve(count);
+        parents.reserve(count);
+        depths.reserve(count);
+        dirty.reserve(count);
+        slot_nodes.reserve(count);
+        node_slots.reserve(count);
+    }
+
+    void SceneGraph::clear()
+    {
+        local_transforms.clear();
+        world_transforms.clear();
+        local_bounds.clear();
+        world_bounds.clear();
+        parents.clear();
+        depths.clear();
+        dirty.clear();
+        slot_nodes.clear();
+        node_slots.clear();
+        level_offsets.clear();
+        order_dirty     = false;
+        transform_dirty = false;
+    }
+
+    void SceneGraph::sortByDepth()
+    {
+        auto     count       = static_cast<uint32_t>(parents.size());
+        uint32_t level_count = count == 0 ? 0 : *std::max_element(depths.begin(), depths.end()) + 1;
+        level_offsets.assign(level_count + 1, 0);
+        for (uint32_t depth : depths)
+        {
+            level_offsets[depth + 1]++;
+        }
+        for (uint32_t level = 0; level < level_count; level++)
+        {
+            level_offsets[level + 1] += level_offsets[level];
+        }
+        world_bounds.resize(count);
+        std::fill(dirty.begin(), dirty.end(), 1);
+        if (std::is_sorted(depths.begin(), depths.end()))
+        {
+            return;
+        }
+
+        // stable counting sort, so siblings keep their insertion order
+        std::vector<uint32_t> new_slots(count);
+        std::vector<uint32_t> cursors(level_offsets.begin(), level_offsets.end() - 1);
+        for (uint32_t slot = 0; slot < count; slot++)
+        {
+            new_slots[slot] = cursors[depths[slot]]++;
+        }
+        auto permute = [&new_slots](auto& values) {
+            std::remove_reference_t<decltype(values)> sorted(values.size());
+            for (size_t slot = 0; slot < values.size(); slot++)
+            {
+                sorted[new_slots[slot]] = values[slot];
+            }
+            values.swap(sorted);
+        };
+        permute(local_transforms);
+        permute(world_transforms);
+        permute(local_bounds);
+        permute(depths);
+        permute(slot_nodes);
+        for (auto& parent : parents)
+        {
+            parent = parent == NO_PARENT ? NO_PARENT : new_slots[parent];
+        }
+        permute(parents);
+        for (uint32_t slot = 0; slot < count; slot++)
+        {
+            node_slots[slot_nodes[slot]] = slot;
+        }
+    }
+
+    void SceneGraph::updateRange(uint32_t begin, uint32_t end)
+    {
+        for (uint32_t slot = begin; slot < end; slot++)
+        {
+            uint32_t parent = parents[slot];
+            // parents live in the previous level, which is already final, so their flag tells whether they moved
+            if (dirty[slot] == 0 && (parent == NO_PARENT || dirty[parent] == 0))
+            {
+                continue;
+            }
+            dirty[slot] = 1;
+
+            world_transforms[slot] =
+                parent == NO_PARENT ? local_transforms[slot] : world_transforms[parent] * local_transforms[slot];
+
+            const glm::mat4& world  = world_transforms[slot];
+            const glm::vec4& bounds = local_bounds[slot];
+            glm::vec3        center = glm::vec3(world * glm::vec4(glm::vec3(bounds), 1.0f));
+            float            scale  = std::max({glm::length(glm::vec3(world[0])),
+                                                glm::length(glm::vec3(world[1])),
+                                                glm::length(glm::vec3(world[2]))});
+            world_bounds.center_x[slot] = center.x;
+            world_bounds.center_y[slot] = center.y;
+            world_bounds.center_z[slot] = center.z;
+            world_bounds.radius[slot]   = bounds.w * scale;
+        }
+    }
+
+    void SceneGraph::update(ThreadPool* pool)
+    {
+        if (order_dirty)
+        {
+            sortByDepth();
+            order_dirty = false;
+        }
+        if (!transform_dirty)
+        {
+            return;
+        }
+
+        for (size_t level = 0; level + 1 < level_offsets.size(); level++)
+        {
+            uint32_t level_begin = level_offsets[level];
+            uint32_t level_end   = level_offsets[level + 1];
+            uint32_t chunk_count = (level_end - level_begin + CHUNK_SIZE - 1) / CHUNK_SIZE;
+            if (pool == nullptr || chunk_count <= 1)
+            {
+                updateRange(level_begin, level_end);
+                continue;
+            }
+            pool->parallelFor(chunk_count, [&](uint32_t chunk) {
+                uint32_t begin = level_begin + chunk * CHUNK_SIZE;
+                updateRange(begin, std::min(begin + CHUNK_SIZE, level_end));
+            });
+        }
+        std::fill(dirty.begin(), dirty.end(), 0);
+        transform_dirty = false;
+    }
+} // namespace vulkanDetails
@@ -0,0 +1,57 @@
+#pragma once
+#include "frustum_culling.hpp"
+#include "thread_pool.hpp"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace vulkanDetails
+{
+    // Transform hierarchy stored as parallel arrays sorted by depth, so a parent is always updated before its
+    // children and every depth level can be processed in parallel. Slots are reordered when nodes are added;
+    // NodeIds stay stable and are translated with slotOf().
+    class SceneGraph
+    {
+    public:
+        using NodeId = uint32_t;
+
+        static constexpr NodeId   NO_PARENT  = UINT32_MAX;
+        // Nodes per work item handed to the pool within one depth level.
+        static constexpr uint32_t CHUNK_SIZE = 1024;
+
+        // bounds is the model-space bounding sphere (xyz = center, w = radius) carried into worldBounds().
+        NodeId addNode(NodeId parent, const glm::mat4& local_transform, const glm::vec4& bounds = glm::vec4(0.0f));
+        void   setLocalTransform(NodeId node, const glm::mat4& local_transform);
+        void   reserve(size_t count);
+        void   clear();
+
+        // Recomputes world transforms and bounds of dirty nodes and their descendants.
+        void update(ThreadPool* pool);
+
+        [[nodiscard]] size_t           size() const { return parents.size(); }
+        [[nodiscard]] uint32_t         slotOf(NodeId node) const { return node_slots[node]; }
+        [[nodiscard]] const glm::mat4& worldTransform(NodeId node) const { return world_transforms[node_slots[node]]; }
+
+        // Slot-ordered outputs, valid after update().
+        [[nodiscard]] const std::vector<glm::mat4>& worldTransforms() const { return world_transforms; }
+        [[nodiscard]] const std::vector<glm::vec4>& localBounds() const { return local_bounds; }
+        [[nodiscard]] const BoundingSpheres&        worldBounds() const { return world_bounds; }
+
+    private:
+        void sortByDepth();
+        void updateRange(uint32_t begin, uint32_t end);
+
+        std::vector<glm::mat4> local_transforms;
+        std::vector<glm::mat4> world_transforms;
+        std::vector<glm::vec4> local_bounds;
+        BoundingSpheres        world_bounds;
+        std::vector<uint32_t>  parents; // parent slot or NO_PARENT
+        std::vector<uint32_t>  depths;
+        std::vector<uint8_t>   dirty;
+        std::vector<NodeId>    slot_nodes;
+        std::vector<uint32_t>  node_slots;
+        std::vector<uint32_t>  level_offsets; // level d occupies slots [level_offsets[d], level_offsets[d + 1])
+        bool                   order_dirty     = false;
+        bool                   transform_dirty = false;
+    };
+} // namespace vulkanDetails
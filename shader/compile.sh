@@ -1,2 +1,16 @@
 glslangValidator -V ./shader/shader_base.vert
-glslangValidator -V ./shader/shader_base.frag
\ No newline at end of file
+glslangValidator -V ./shader/shader_base.frag
+glslangValidator -V ./shader/shader_texture.vert -o ./shader/texture_vert.spv
+glslangValidator -V ./shader/shader_texture.frag -o ./shader/texture_frag.spv
+glslangValidator -V ./shader/shader_push.vert -o ./shader/push_vert.spv
+glslangValidator -V ./shader/shader_indirect.vert -o ./shader/indirect_vert.spv
+glslangValidator -V ./shader/cull.comp -o ./shader/cull_comp.spv
+glslangValidator -V ./shader/shader_text.vert -o ./shader/text_vert.spv
+glslangValidator -V ./shader/shader_text.frag -o ./shader/text_frag.spv
+glslangValidator -V ./shader/yuv.comp -o ./shader/yuv_comp.spv
+glslangValidator -V ./shader/shader_tilemap.frag -o ./shader/tilemap_frag.spv
+glslangValidator -V ./shader/particle_simulate.comp -o ./shader/particle_simulate_comp.spv
+glslangValidator -V ./shader/particle_emit.comp -o ./shader/particle_emit_comp.spv
+glslangValidator -V ./shader/particle_finalize.comp -o ./shader/particle_finalize_comp.spv
+glslangValidator -V ./shader/shader_particle.vert -o ./shader/particle_vert.spv
+glslangValidator -V ./shader/shader_particle.frag -o ./shader/particle_frag.spv
@@ -0,0 +1,38 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+struct Particle {
+    vec4 position; // w = age
+    vec4 velocity; // w = lifetime
+};
+
+// the output of the step that ran last
+layout(std430, set = 1, binding = 1) readonly buffer Particles {
+    Particle particles[];
+};
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragCorner;
+
+const float SIZE = 0.01;
+
+const vec2 CORNERS[6] = vec2[](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+                               vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
+
+void main() {
+    Particle particle = particles[gl_InstanceIndex];
+    float    life     = clamp(particle.position.w / particle.velocity.w, 0.0, 1.0);
+    vec2     corner   = CORNERS[gl_VertexIndex];
+
+    // a quad facing the camera
+    vec4 viewPosition = ubo.view * vec4(particle.position.xyz, 1.0);
+    viewPosition.xy += corner * SIZE;
+    gl_Position = ubo.proj * viewPosition;
+    fragColor = vec4(mix(vec3(1.0, 0.8, 0.3), vec3(0.8, 0.2, 0.1), life), 1.0 - life);
+    fragCorner = corner;
+}
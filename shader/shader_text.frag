@@ -0,0 +1,16 @@
+#version 450
+
+layout(binding = 0) uniform sampler2D glyphAtlas;
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 1) in vec4 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // 0.5 is the outline; smoothing over one screen pixel keeps edges sharp at any text size
+    float distance = texture(glyphAtlas, fragTexCoord).r;
+    float smoothing = max(fwidth(distance) * 0.5, 1e-4);
+    float coverage = smoothstep(0.5 - smoothing, 0.5 + smoothing, distance);
+    outColor = vec4(fragColor.rgb, fragColor.a * coverage);
+}
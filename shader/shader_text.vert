@@ -0,0 +1,19 @@
+#version 450
+
+layout(push_constant) uniform TextPushConstants {
+    vec2 pixelToNdc;
+} text;
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+layout(location = 2) in vec4 inColor;
+
+layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) out vec4 fragColor;
+
+void main() {
+    // positions are in pixels from the top-left corner, which is (-1, -1) in Vulkan's clip space
+    gl_Position = vec4(inPosition * text.pixelToNdc - 1.0, 0.0, 1.0);
+    fragTexCoord = inTexCoord;
+    fragColor = inColor;
+}
@@ -0,0 +1,13 @@
+#version 450
+
+layout(binding = 1) uniform sampler2D texSampler;
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // shader_texture.frag's inputs, with the texture of the same descriptor set actually sampled
+    outColor = vec4(fragColor, 1.0) * texture(texSampler, fragTexCoord);
+}
@@ -0,0 +1,110 @@
+#include "staging_ring.hpp"
+#include "gpu_device.hpp"
+
+namespace vulkanDetails
+{
+    void StagingRing::init(const GpuDevice& gpu, VkDeviceSize ring_capacity)
+    {
+        device    = gpu.getDevice();
+        ring_size = ring_capacity;
+        gpu.createBuffer(ring_size,
+                         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         buffer,
+                         memory);
+        void* data;
+        vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &data);
+        mapped = static_cast<uint8_t*>(data);
+    }
+
+    void StagingRing::cleanup(VkDevice logical_device)
+    {
+        vkUnmapMemory(logical_device, memory);
+        vkDestroyBuffer(logical_device, buffer, nullptr);
+        vkFreeMemory(logical_device, memory, nullptr);
+        spans.clear();
+    }
+
+    std::optional<StagingAllocation> StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment, VkFence consumer)
+    {
+        if (spans.empty())
+        {
+            head = 0;
+            tail = 0;
+        }
+        VkDeviceSize offset = (head + alignment - 1) / alignment * alignment;
+        if (spans.empty() || head > tail)
+        {
+            // free space is [head, end) and [0, tail)
+            if (offset + size > ring_size)
+            {
+                if (spans.empty() || size > tail)
+                {
+                    return std::nullopt;
+                }
+                // what is skipped at the end is freed together with the span before it
+                offset = 0;
+                stats.wraps++;
+            }
+        }
+        else if (head < tail)
+        {
+            // wrapped around already, free space is [head, tail)
+            if (offset + size > tail)
+            {
+                return std::nullopt;
+            }
+        }
+        else
+        {
+            // head caught up with tail: full
+            return std::nullopt;
+        }
+
+        head = offset + size;
+        if (!spans.empty() && spans.back().fence == consumer && !spans.back().submitted)
+        {
+            spans.back().end = head;
+        }
+        else
+        {
+            spans.push_back({head, consumer, false});
+        }
+        stats.allocations++;
+        stats.bytes += size;
+        return StagingAllocation {buffer, offset, mapped + offset};
+    }
+
+    void StagingRing::submitted(VkFence consumer)
+    {
+        for (auto& span : spans)
+        {
+            if (span.fence == consumer)
+            {
+                span.submitted = true;
+            }
+        }
+    }
+
+    void StagingRing::reclaim()
+    {
+        // in order, a span is only reused once everything before it is
+        while (!spans.empty() && spans.front().submitted && vkGetFenceStatus(device, spans.front().fence) == VK_SUCCESS)
+        {
+            tail = spans.front().end;
+            spans.pop_front();
+        }
+    }
+
+    bool StagingRing::waitOldest()
+    {
+        if (spans.empty() || !spans.front().submitted)
+        {
+            return false;
+        }
+        stats.stalls++;
+        vkWaitForFences(device, 1, &spans.front().fence, VK_TRUE, UINT64_MAX);
+        reclaim();
+        return true;
+    }
+} // namespace vulkanDetails
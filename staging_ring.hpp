@@ -0,0 +1,73 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <cstdint>
+#include <deque>
+#include <optional>
+
+namespace vulkanDetails
+{
+    class GpuDevice;
+
+    // A piece of the ring, written through data and copied from buffer at offset.
+    struct StagingAllocation
+    {
+        VkBuffer     buffer {};
+        VkDeviceSize offset = 0;
+        void*        data   = nullptr;
+    };
+
+    struct StagingStats
+    {
+        uint64_t     allocations = 0;
+        uint64_t     wraps       = 0; // allocations that skipped the end of the buffer and started over at 0
+        uint64_t     stalls      = 0; // times the CPU waited on a fence for space
+        VkDeviceSize bytes       = 0;
+    };
+
+    // One persistently mapped, host coherent staging buffer that every upload is carved out of, so uploading never
+    // creates buffers or allocates memory.
+    //
+    // Allocations are made for the fence of the submission that will copy from them. Space is handed out in ring
+    // order and comes back in the same order: once the oldest allocations' submission was made (submitted()) and
+    // its fence has signaled, reclaim() frees them. Fences are only looked at while their allocations are pending,
+    // so the owner has to call reclaim() after waiting on a fence and before resetting it. Not synchronized, one
+    // thread records at a time.
+    class StagingRing
+    {
+    public:
+        void init(const GpuDevice& gpu, VkDeviceSize ring_capacity);
+        void cleanup(VkDevice device);
+
+        // Space for size bytes, or nothing if the ring has no room until pending submissions complete. size larger
+        // than capacity() never fits; callers split their uploads.
+        std::optional<StagingAllocation> allocate(VkDeviceSize size, VkDeviceSize alignment, VkFence consumer);
+        // The submission signaling consumer has been made; its allocations are freed once the fence signals.
+        void                             submitted(VkFence consumer);
+        // Frees the oldest allocations whose submission has completed, without waiting.
+        void                             reclaim();
+        // Waits for the oldest submitted allocations and frees them; false if the oldest are not submitted yet.
+        bool                             waitOldest();
+
+        [[nodiscard]] VkDeviceSize        capacity() const { return ring_size; }
+        [[nodiscard]] const StagingStats& getStats() const { return stats; }
+
+    private:
+        // Consecutive allocations for the same consumer, ending at end.
+        struct Span
+        {
+            VkDeviceSize end = 0;
+            VkFence      fence {};
+            bool         submitted = false;
+        };
+
+        VkDevice         device {};
+        VkBuffer         buffer {};
+        VkDeviceMemory   memory {};
+        uint8_t*         mapped    = nullptr;
+        VkDeviceSize     ring_size = 0;
+        VkDeviceSize     head      = 0; // where the next allocation starts looking
+        VkDeviceSize     tail      = 0; // start of the oldest allocation still in use
+        std::deque<Span> spans;         // oldest first; empty means the whole ring is free
+        StagingStats     stats;
+    };
+} // namespace vulkanDetails
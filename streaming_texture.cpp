@@ -0,0 +1,451 @@
+#include "streaming_texture.hpp"
+#include "barrier_batch.hpp"
+#include "vulkan_util.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace vulkanDetails
+{
+    constexpr uint32_t CONVERT_GROUP_SIZE = 8;
+
+    namespace
+    {
+        struct ConvertParams
+        {
+            glm::ivec2 offset;
+            glm::ivec2 extent;
+        };
+
+        // rows of row_size bytes from pitch apart into tightly packed ones
+        void copyRows(uint8_t* dst, const uint8_t* src, size_t row_size, uint32_t rows, uint32_t pitch)
+        {
+            if (pitch == row_size)
+            {
+                memcpy(dst, src, row_size * rows);
+                return;
+            }
+            for (uint32_t row = 0; row < rows; row++)
+            {
+                memcpy(dst + row_size * row, src + static_cast<size_t>(pitch) * row, row_size);
+            }
+        }
+
+        VkRect2D unite(const VkRect2D& a, const VkRect2D& b)
+        {
+            int32_t x0 = std::min(a.offset.x, b.offset.x);
+            int32_t y0 = std::min(a.offset.y, b.offset.y);
+            int32_t x1 = std::max(a.offset.x + static_cast<int32_t>(a.extent.width),
+                                  b.offset.x + static_cast<int32_t>(b.extent.width));
+            int32_t y1 = std::max(a.offset.y + static_cast<int32_t>(a.extent.height),
+                                  b.offset.y + static_cast<int32_t>(b.extent.height));
+            return {{x0, y0}, {static_cast<uint32_t>(x1 - x0), static_cast<uint32_t>(y1 - y0)}};
+        }
+    } // namespace
+
+    void StreamingTexture::init(GpuDevice&      gpu_device,
+                                VkDevice        device,
+                                VkExtent2D      texture_extent,
+                                StreamingFormat texture_format,
+                                VkSampler       sampler,
+                                uint32_t        frame_count)
+    {
+        gpu    = &gpu_device;
+        format = texture_format;
+        extent = texture_extent;
+        if (format == StreamingFormat::Rgba8)
+        {
+            planes.resize(1);
+            createPlane(planes[0],
+                        extent,
+                        getPlaneFormat(),
+                        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+        }
+        else
+        {
+            VkExtent2D chroma_extent = {(extent.width + 1) / 2, (extent.height + 1) / 2};
+            planes.resize(3);
+            for (uint32_t i = 0; i < planes.size(); i++)
+            {
+                createPlane(planes[i],
+                            i == 0 ? extent : chroma_extent,
+                            getPlaneFormat(),
+                            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+            }
+            // written by the conversion only; transfer for the clear
+            createPlane(converted,
+                        extent,
+                        getImageFormat(),
+                        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+            createConverter(device, sampler);
+        }
+
+        // starts out black instead of undefined, so partial updates never show garbage around them and every
+        // frame can take the images over in SHADER_READ_ONLY_OPTIMAL
+        BarrierBatch    barriers;
+        VkCommandBuffer command_buffer = gpu->beginSingleTimeCommands();
+        std::vector<std::pair<VkImage, VkClearColorValue>> clears;
+        if (format == StreamingFormat::Rgba8)
+        {
+            clears.push_back({planes[0].image, {{0.0f, 0.0f, 0.0f, 1.0f}}});
+        }
+        else
+        {
+            // limited range black
+            clears.push_back({planes[0].image, {{16.0f / 255.0f}}});
+            clears.push_back({planes[1].image, {{0.5f}}});
+            clears.push_back({planes[2].image, {{0.5f}}});
+            clears.push_back({converted.image, {{0.0f, 0.0f, 0.0f, 1.0f}}});
+        }
+        VkImageSubresourceRange range = wholeImageRange(VK_FORMAT_R8G8B8A8_UNORM);
+        for (const auto& [image, color] : clears)
+        {
+            barriers.transitionImage(image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, range);
+        }
+        barriers.flush(command_buffer);
+        for (const auto& [image, color] : clears)
+        {
+            vkCmdClearColorImage(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1, &range);
+            barriers.transitionImage(
+                image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, range);
+        }
+        barriers.flush(command_buffer);
+        gpu->endSingleTimeCommands(command_buffer);
+
+        // one whole-texture update per frame, planes packed back to back, plus room to align where it starts
+        staging_size = 0;
+        for (uint32_t i = 0; i < planes.size(); i++)
+        {
+            VkRect2D plane_rect = planeRect(i, wholeRect());
+            staging_size += static_cast<VkDeviceSize>(plane_rect.extent.width) * plane_rect.extent.height * texelSize();
+        }
+        staging_size += GpuDevice::STAGING_ALIGNMENT;
+        // whatever overflows a frame's buffer is less than a whole texture (a whole update starts the buffer over),
+        // so the ring has to be able to take that much per frame
+        gpu->reserveFrameStaging(staging_size);
+        staging_buffers.resize(frame_count);
+        staging_buffers_memory.resize(frame_count);
+        staging_buffers_mapped.resize(frame_count);
+        for (uint32_t i = 0; i < frame_count; i++)
+        {
+            gpu->createBuffer(staging_size,
+                              VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                              staging_buffers[i],
+                              staging_buffers_memory[i]);
+            vkMapMemory(device, staging_buffers_memory[i], 0, VK_WHOLE_SIZE, 0, &staging_buffers_mapped[i]);
+        }
+    }
+
+    void StreamingTexture::createPlane(Plane&            plane,
+                                       VkExtent2D        plane_extent,
+                                       VkFormat          plane_format,
+                                       VkImageUsageFlags usage)
+    {
+        plane.extent = plane_extent;
+        gpu->createImage(plane_extent.width,
+                         plane_extent.height,
+                         plane_format,
+                         VK_IMAGE_TILING_OPTIMAL,
+                         usage,
+                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                         plane.image,
+                         plane.memory);
+        plane.view = gpu->createImageView(plane.image, plane_format);
+    }
+
+    void StreamingTexture::createConverter(VkDevice device, VkSampler sampler)
+    {
+        // the three planes, then the RGBA image they are converted into
+        std::array<VkDescriptorSetLayoutBinding, 4> bindings {};
+        for (uint32_t i = 0; i < bindings.size(); i++)
+        {
+            bindings[i].binding         = i;
+            bindings[i].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+
+        VkDescriptorSetLayoutCreateInfo layout_info {};
+        layout_info.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+        layout_info.pBindings    = bindings.data();
+        if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &set_layout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create yuv descriptor set layout!");
+        }
+
+        std::array<VkDescriptorPoolSize, 2> pool_sizes {};
+        pool_sizes[0] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3};
+        pool_sizes[1] = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1};
+        VkDescriptorPoolCreateInfo pool_info {};
+        pool_info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+        pool_info.pPoolSizes    = pool_sizes.data();
+        pool_info.maxSets       = 1;
+        if (vkCreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create yuv descriptor pool!");
+        }
+        VkDescriptorSetAllocateInfo alloc_info {};
+        alloc_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.descriptorPool     = descriptor_pool;
+        alloc_info.descriptorSetCount = 1;
+        alloc_info.pSetLayouts        = &set_layout;
+        if (vkAllocateDescriptorSets(device, &alloc_info, &descriptor_set) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate yuv descriptor set!");
+        }
+        std::vector<DescriptorBinding> set_bindings;
+        for (uint32_t i = 0; i < planes.size(); i++)
+        {
+            DescriptorBinding plane_binding {i, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
+            plane_binding.image = {sampler, planes[i].view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+            set_bindings.push_back(plane_binding);
+        }
+        DescriptorBinding output_binding {3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE};
+        output_binding.image = {VK_NULL_HANDLE, converted.view, VK_IMAGE_LAYOUT_GENERAL};
+        set_bindings.push_back(output_binding);
+        writeDescriptorSet(device, descriptor_set, set_bindings);
+
+        VkPushConstantRange push_constant_range {};
+        push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        push_constant_range.offset     = 0;
+        push_constant_range.size       = sizeof(ConvertParams);
+
+        VkPipelineLayoutCreateInfo pipeline_layout_info {};
+        pipeline_layout_info.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipeline_layout_info.setLayoutCount         = 1;
+        pipeline_layout_info.pSetLayouts            = &set_layout;
+        pipeline_layout_info.pushConstantRangeCount = 1;
+        pipeline_layout_info.pPushConstantRanges    = &push_constant_range;
+        if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create yuv pipeline layout!");
+        }
+
+        auto           compute_shader_code   = readFile("../shader/yuv_comp.spv");
+        VkShaderModule compute_shader_module = gpu->createShaderModule(compute_shader_code);
+
+        VkComputePipelineCreateInfo pipeline_info {};
+        pipeline_info.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipeline_info.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipeline_info.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipeline_info.stage.module = compute_shader_module;
+        pipeline_info.stage.pName  = "main";
+        pipeline_info.layout       = pipeline_layout;
+        if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create yuv pipeline!");
+        }
+        vkDestroyShaderModule(device, compute_shader_module, nullptr);
+    }
+
+    void StreamingTexture::cleanup(VkDevice device)
+    {
+        for (size_t i = 0; i < staging_buffers.size(); i++)
+        {
+            vkDestroyBuffer(device, staging_buffers[i], nullptr);
+            vkFreeMemory(device, staging_buffers_memory[i], nullptr);
+        }
+        auto destroy_plane = [device](const Plane& plane) {
+            vkDestroyImageView(device, plane.view, nullptr);
+            vkDestroyImage(device, plane.image, nullptr);
+            vkFreeMemory(device, plane.memory, nullptr);
+        };
+        for (const auto& plane : planes)
+        {
+            destroy_plane(plane);
+        }
+        // null handles for Rgba8
+        destroy_plane(converted);
+        vkDestroyPipeline(device, pipeline, nullptr);
+        vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+        vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+        vkDestroyDescriptorSetLayout(device, set_layout, nullptr);
+        // ready for another init
+        *this = StreamingTexture();
+    }
+
+    VkImage StreamingTexture::getImage() const
+    {
+        return format == StreamingFormat::Rgba8 ? planes[0].image : converted.image;
+    }
+
+    VkImageView StreamingTexture::getImageView() const
+    {
+        return format == StreamingFormat::Rgba8 ? planes[0].view : converted.view;
+    }
+
+    VkFormat StreamingTexture::getPlaneFormat() const
+    {
+        return format == StreamingFormat::Rgba8 ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R8_UNORM;
+    }
+
+    VkRect2D StreamingTexture::planeRect(uint32_t plane, const VkRect2D& rect) const
+    {
+        if (plane == 0)
+        {
+            return rect;
+        }
+        // every chroma sample that any pixel of rect uses
+        uint32_t x0 = static_cast<uint32_t>(rect.offset.x) / 2;
+        uint32_t y0 = static_cast<uint32_t>(rect.offset.y) / 2;
+        uint32_t x1 = (static_cast<uint32_t>(rect.offset.x) + rect.extent.width + 1) / 2;
+        uint32_t y1 = (static_cast<uint32_t>(rect.offset.y) + rect.extent.height + 1) / 2;
+        return {{static_cast<int32_t>(x0), static_cast<int32_t>(y0)}, {x1 - x0, y1 - y0}};
+    }
+
+    void StreamingTexture::begin(uint32_t frame)
+    {
+        current_frame = frame;
+        staging_used  = 0;
+        copies.clear();
+        dirty.reset();
+    }
+
+    StagingAllocation StreamingTexture::stage(const VkRect2D& rect)
+    {
+        if (rect.offset.x < 0 || rect.offset.y < 0 ||
+            static_cast<uint32_t>(rect.offset.x) + rect.extent.width > extent.width ||
+            static_cast<uint32_t>(rect.offset.y) + rect.extent.height > extent.height)
+        {
+            throw std::runtime_error("streaming texture update outside of the texture!");
+        }
+        if (rect.extent.width == extent.width && rect.extent.height == extent.height)
+        {
+            // nothing queued so far would survive this one, e.g. a decoder that got ahead of the renderer
+            stats.superseded += copies.size() / planes.size();
+            copies.clear();
+            staging_used = 0;
+        }
+
+        VkDeviceSize size = 0;
+        for (uint32_t i = 0; i < planes.size(); i++)
+        {
+            VkRect2D plane_rect = planeRect(i, rect);
+            size += static_cast<VkDeviceSize>(plane_rect.extent.width) * plane_rect.extent.height * texelSize();
+        }
+        VkDeviceSize alignment = GpuDevice::STAGING_ALIGNMENT;
+        VkDeviceSize offset    = (staging_used + alignment - 1) / alignment * alignment;
+        StagingAllocation staging;
+        if (offset + size <= staging_size)
+        {
+            staging_used = offset + size;
+            staging      = {staging_buffers[current_frame],
+                            offset,
+                            static_cast<uint8_t*>(staging_buffers_mapped[current_frame]) + offset};
+        }
+        else
+        {
+            // more than one whole texture's worth this frame, the rest shares the device's staging ring
+            stats.overflows++;
+            staging = gpu->stageForFrame(size);
+        }
+
+        VkDeviceSize plane_offset = staging.offset;
+        for (uint32_t i = 0; i < planes.size(); i++)
+        {
+            VkRect2D    plane_rect = planeRect(i, rect);
+            PendingCopy copy {staging.buffer, i, {}};
+            copy.region.bufferOffset                    = plane_offset;
+            copy.region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+            copy.region.imageSubresource.mipLevel       = 0;
+            copy.region.imageSubresource.baseArrayLayer = 0;
+            copy.region.imageSubresource.layerCount     = 1;
+            copy.region.imageOffset                     = {plane_rect.offset.x, plane_rect.offset.y, 0};
+            copy.region.imageExtent                     = {plane_rect.extent.width, plane_rect.extent.height, 1};
+            copies.push_back(copy);
+            plane_offset += static_cast<VkDeviceSize>(plane_rect.extent.width) * plane_rect.extent.height * texelSize();
+        }
+        dirty = dirty ? unite(*dirty, rect) : rect;
+        stats.updates++;
+        stats.bytes += size;
+        return staging;
+    }
+
+    void StreamingTexture::update(const void* pixels, uint32_t pitch, std::optional<VkRect2D> rect)
+    {
+        if (format != StreamingFormat::Rgba8)
+        {
+            throw std::runtime_error("update needs an rgba streaming texture, use updateYuv!");
+        }
+        VkRect2D          update_rect = rect.value_or(wholeRect());
+        StagingAllocation staging     = stage(update_rect);
+        copyRows(static_cast<uint8_t*>(staging.data),
+                 static_cast<const uint8_t*>(pixels),
+                 static_cast<size_t>(update_rect.extent.width) * 4,
+                 update_rect.extent.height,
+                 pitch);
+    }
+
+    void StreamingTexture::updateYuv(const uint8_t*          y_plane,
+                                     uint32_t                y_pitch,
+                                     const uint8_t*          u_plane,
+                                     uint32_t                u_pitch,
+                                     const uint8_t*          v_plane,
+                                     uint32_t                v_pitch,
+                                     std::optional<VkRect2D> rect)
+    {
+        if (format != StreamingFormat::Yuv420)
+        {
+            throw std::runtime_error("updateYuv needs a yuv streaming texture!");
+        }
+        VkRect2D                      update_rect = rect.value_or(wholeRect());
+        StagingAllocation             staging     = stage(update_rect);
+        std::array<const uint8_t*, 3> sources     = {y_plane, u_plane, v_plane};
+        std::array<uint32_t, 3>       pitches     = {y_pitch, u_pitch, v_pitch};
+        auto*                         dst         = static_cast<uint8_t*>(staging.data);
+        for (uint32_t i = 0; i < planes.size(); i++)
+        {
+            VkRect2D plane_rect = planeRect(i, update_rect);
+            copyRows(dst, sources[i], plane_rect.extent.width, plane_rect.extent.height, pitches[i]);
+            dst += static_cast<size_t>(plane_rect.extent.width) * plane_rect.extent.height;
+        }
+    }
+
+    StreamingLock StreamingTexture::lock(std::optional<VkRect2D> rect)
+    {
+        VkRect2D          lock_rect = rect.value_or(wholeRect());
+        StagingAllocation staging   = stage(lock_rect);
+        return {static_cast<uint8_t*>(staging.data), static_cast<uint32_t>(lock_rect.extent.width * texelSize())};
+    }
+
+    void StreamingTexture::recordUpload(VkCommandBuffer command_buffer)
+    {
+        for (const auto& copy : copies)
+        {
+            vkCmdCopyBufferToImage(command_buffer,
+                                   copy.buffer,
+                                   planes[copy.plane].image,
+                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   1,
+                                   &copy.region);
+        }
+        copies.clear();
+    }
+
+    void StreamingTexture::recordConvert(VkCommandBuffer command_buffer)
+    {
+        if (!dirty)
+        {
+            return;
+        }
+        // only what this frame's updates touched
+        ConvertParams params {};
+        params.offset = {dirty->offset.x, dirty->offset.y};
+        params.extent = {static_cast<int32_t>(dirty->extent.width), static_cast<int32_t>(dirty->extent.height)};
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        vkCmdBindDescriptorSets(
+            command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+        vkCmdPushConstants(
+            command_buffer, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ConvertParams), &params);
+        vkCmdDispatch(command_buffer,
+                      (dirty->extent.width + CONVERT_GROUP_SIZE - 1) / CONVERT_GROUP_SIZE,
+                      (dirty->extent.height + CONVERT_GROUP_SIZE - 1) / CONVERT_GROUP_SIZE,
+                      1);
+        dirty.reset();
+    }
+} // namespace vulkanDetails
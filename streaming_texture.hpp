@@ -0,0 +1,133 @@
+#pragma once
+#include "staging_ring.hpp"
+#include "vulkan/vulkan.h"
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace vulkanDetails
+{
+    class GpuDevice;
+
+    enum class StreamingFormat
+    {
+        Rgba8,
+        Yuv420, // I420: full resolution Y, then U and V at half width and height, converted to RGBA on the GPU
+    };
+
+    // Writable staging memory of lock(): the planes follow each other, tightly packed, like SDL_LockTexture's.
+    struct StreamingLock
+    {
+        uint8_t* pixels = nullptr;
+        uint32_t pitch  = 0; // bytes per row of the first plane, later planes use half of it for Yuv420
+    };
+
+    struct StreamingStats
+    {
+        uint64_t     updates    = 0;
+        uint64_t     superseded = 0; // pending updates dropped because a whole-texture update replaced them
+        uint64_t     overflows  = 0; // updates that did not fit the frame's staging buffer and went to the ring
+        VkDeviceSize bytes      = 0;
+    };
+
+    // A texture whose contents are replaced while it is being drawn, like SDL_TEXTUREACCESS_STREAMING: video
+    // frames, procedurally updated surfaces.
+    //
+    // Every frame in flight has its own persistently mapped staging buffer, big enough for one update of the whole
+    // texture, so writing the next frame's pixels never waits for the GPU to finish copying the previous ones.
+    // Updates only copy into that memory; the copies to the image (and the YUV conversion) are recorded into the
+    // frame's command buffer with the rest of the frame.
+    //
+    // Per frame: begin(), any number of update()/updateYuv()/lock(), then recordUpload() (and recordConvert() for
+    // Yuv420) before the image is sampled. getImage() stays in SHADER_READ_ONLY_OPTIMAL between frames.
+    class StreamingTexture
+    {
+    public:
+        void init(GpuDevice&      gpu,
+                  VkDevice        device,
+                  VkExtent2D      texture_extent,
+                  StreamingFormat texture_format,
+                  VkSampler       sampler,
+                  uint32_t        frame_count);
+        void cleanup(VkDevice device);
+
+        void begin(uint32_t frame);
+        // Rows of pitch bytes for rect, or for the whole texture without one. Rgba8 only.
+        void update(const void* pixels, uint32_t pitch, std::optional<VkRect2D> rect = std::nullopt);
+        // The three planes of rect; the chroma planes cover rect at half resolution, rounded outwards. Yuv420 only.
+        void updateYuv(const uint8_t*          y_plane,
+                       uint32_t                y_pitch,
+                       const uint8_t*          u_plane,
+                       uint32_t                u_pitch,
+                       const uint8_t*          v_plane,
+                       uint32_t                v_pitch,
+                       std::optional<VkRect2D> rect = std::nullopt);
+        // Staging memory to write rect into directly, saving the copy update() makes. There is no unlock: the
+        // memory is copied from when the frame is recorded, so it has to be written by then.
+        StreamingLock lock(std::optional<VkRect2D> rect = std::nullopt);
+
+        // Expects every plane in TRANSFER_DST_OPTIMAL.
+        void recordUpload(VkCommandBuffer command_buffer);
+        // Yuv420 only. Expects the planes in SHADER_READ_ONLY_OPTIMAL and getImage() in GENERAL.
+        void recordConvert(VkCommandBuffer command_buffer);
+
+        [[nodiscard]] bool            uploadPending() const { return !copies.empty(); }
+        [[nodiscard]] StreamingFormat getFormat() const { return format; }
+        [[nodiscard]] VkExtent2D      getExtent() const { return extent; }
+        // What to sample: the RGBA image itself, or the one the YUV planes are converted into.
+        [[nodiscard]] VkImage         getImage() const;
+        [[nodiscard]] VkImageView     getImageView() const;
+        [[nodiscard]] VkFormat        getImageFormat() const { return VK_FORMAT_R8G8B8A8_UNORM; }
+        // The images updates are copied into, one for Rgba8 and three for Yuv420.
+        [[nodiscard]] uint32_t        planeCount() const { return static_cast<uint32_t>(planes.size()); }
+        [[nodiscard]] VkImage         getPlaneImage(uint32_t plane) const { return planes[plane].image; }
+        [[nodiscard]] VkImageView     getPlaneView(uint32_t plane) const { return planes[plane].view; }
+        [[nodiscard]] VkFormat        getPlaneFormat() const;
+        [[nodiscard]] VkExtent2D      getPlaneExtent(uint32_t plane) const { return planes[plane].extent; }
+        [[nodiscard]] const StreamingStats& getStats() const { return stats; }
+
+    private:
+        struct Plane
+        {
+            VkImage        image {};
+            VkDeviceMemory memory {};
+            VkImageView    view {};
+            VkExtent2D     extent {};
+        };
+
+        struct PendingCopy
+        {
+            VkBuffer          buffer;
+            uint32_t          plane;
+            VkBufferImageCopy region;
+        };
+
+        void createPlane(Plane& plane, VkExtent2D plane_extent, VkFormat plane_format, VkImageUsageFlags usage);
+        void createConverter(VkDevice device, VkSampler sampler);
+        [[nodiscard]] VkRect2D     wholeRect() const { return {{0, 0}, extent}; }
+        [[nodiscard]] VkRect2D     planeRect(uint32_t plane, const VkRect2D& rect) const;
+        [[nodiscard]] VkDeviceSize texelSize() const { return format == StreamingFormat::Rgba8 ? 4 : 1; }
+        // Packs rect's planes into staging memory and queues their copies.
+        StagingAllocation stage(const VkRect2D& rect);
+
+        GpuDevice*                  gpu    = nullptr; // for updates that overflow into the staging ring
+        StreamingFormat             format = StreamingFormat::Rgba8;
+        VkExtent2D                  extent {};
+        std::vector<Plane>          planes;
+        Plane                       converted; // Yuv420 only
+        std::vector<VkBuffer>       staging_buffers;
+        std::vector<VkDeviceMemory> staging_buffers_memory;
+        std::vector<void*>          staging_buffers_mapped;
+        VkDeviceSize                staging_size  = 0; // per frame
+        VkDeviceSize                staging_used  = 0; // of the current frame's buffer
+        uint32_t                    current_frame = 0;
+        std::vector<PendingCopy>    copies;
+        std::optional<VkRect2D>     dirty; // union of this frame's updates, what recordConvert converts
+        VkDescriptorSetLayout       set_layout {};
+        VkDescriptorPool            descriptor_pool {};
+        VkDescriptorSet             descriptor_set {};
+        VkPipelineLayout            pipeline_layout {};
+        VkPipeline                  pipeline {};
+        StreamingStats              stats;
+    };
+} // namespace vulkanDetails
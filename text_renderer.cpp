@@ -0,0 +1,405 @@
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "text_renderer.hpp"
+#include "vulkan_util.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace vulkanDetails
+{
+    namespace
+    {
+        constexpr uint32_t      INITIAL_QUADS = 1024; // per frame, grown on demand
+        constexpr unsigned char SDF_ON_EDGE   = 128;  // distance field value on the outline
+        constexpr uint32_t      REPLACEMENT   = 0xFFFD;
+
+        // Decodes the UTF-8 sequence starting at text[i] and moves i past it; malformed input becomes U+FFFD.
+        uint32_t nextCodepoint(std::string_view text, size_t& i)
+        {
+            auto lead = static_cast<uint8_t>(text[i++]);
+            if (lead < 0x80)
+            {
+                return lead;
+            }
+            uint32_t length = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+            if (length == 0 || i + length > text.size())
+            {
+                return REPLACEMENT;
+            }
+            uint32_t codepoint = lead & (0x3F >> length);
+            for (uint32_t k = 0; k < length; k++, i++)
+            {
+                auto continuation = static_cast<uint8_t>(text[i]);
+                if ((continuation & 0xC0) != 0x80)
+                {
+                    return REPLACEMENT;
+                }
+                codepoint = (codepoint << 6) | (continuation & 0x3F);
+            }
+            return codepoint;
+        }
+
+        uint32_t packColor(glm::vec4 color)
+        {
+            auto unorm8 = [](float channel) {
+                return static_cast<uint32_t>(std::clamp(channel, 0.0f, 1.0f) * 255.0f + 0.5f);
+            };
+            return unorm8(color.x) | unorm8(color.y) << 8 | unorm8(color.z) << 16 | unorm8(color.w) << 24;
+        }
+    } // namespace
+
+    VkVertexInputBindingDescription TextVertex::getBindingDescription()
+    {
+        VkVertexInputBindingDescription binding_description {};
+        binding_description.binding   = 0;
+        binding_description.stride    = sizeof(TextVertex);
+        binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return binding_description;
+    }
+
+    std::array<VkVertexInputAttributeDescription, 3> TextVertex::getAttributeDescriptions()
+    {
+        std::array<VkVertexInputAttributeDescription, 3> attribute_descriptions {};
+        attribute_descriptions[0].binding  = 0;
+        attribute_descriptions[0].location = 0;
+        attribute_descriptions[0].format   = VK_FORMAT_R32G32_SFLOAT;
+        attribute_descriptions[0].offset   = offsetof(TextVertex, pos);
+        attribute_descriptions[1].binding  = 0;
+        attribute_descriptions[1].location = 1;
+        attribute_descriptions[1].format   = VK_FORMAT_R32G32_SFLOAT;
+        attribute_descriptions[1].offset   = offsetof(TextVertex, tex_coord);
+        attribute_descriptions[2].binding  = 0;
+        attribute_descriptions[2].location = 2;
+        attribute_descriptions[2].format   = VK_FORMAT_R8G8B8A8_UNORM;
+        attribute_descriptions[2].offset   = offsetof(TextVertex, color);
+        return attribute_descriptions;
+    }
+
+    void GlyphAtlas::load(const std::string& font_path)
+    {
+        std::vector<char> file = readFile(font_path);
+        font_data.assign(file.begin(), file.end());
+        if (stbtt_InitFont(&font, font_data.data(), stbtt_GetFontOffsetForIndex(font_data.data(), 0)) == 0)
+        {
+            throw std::runtime_error("failed to load font!");
+        }
+        int ascent, descent, line_gap;
+        stbtt_GetFontVMetrics(&font, &ascent, &descent, &line_gap);
+        font_scale  = stbtt_ScaleForPixelHeight(&font, BASE_PIXEL_SIZE);
+        font_ascent = static_cast<float>(ascent) * font_scale;
+        line_height = static_cast<float>(ascent - descent + line_gap) * font_scale;
+        pixels.assign(static_cast<size_t>(SIZE) * SIZE, 0);
+    }
+
+    const Glyph& GlyphAtlas::find(uint32_t codepoint)
+    {
+        auto it = glyphs.find(codepoint);
+        if (it != glyphs.end())
+        {
+            return it->second;
+        }
+        Glyph glyph;
+        glyph.index = stbtt_FindGlyphIndex(&font, static_cast<int>(codepoint));
+        int advance, left_side_bearing;
+        stbtt_GetGlyphHMetrics(&font, glyph.index, &advance, &left_side_bearing);
+        glyph.advance = static_cast<float>(advance) * font_scale;
+
+        // the padding is part of the bitmap, so the quad covers the whole range the edge is smoothed over
+        int            width, height, x_offset, y_offset;
+        unsigned char* sdf = stbtt_GetGlyphSDF(&font,
+                                               font_scale,
+                                               glyph.index,
+                                               SDF_PADDING,
+                                               SDF_ON_EDGE,
+                                               static_cast<float>(SDF_ON_EDGE) / SDF_PADDING,
+                                               &width,
+                                               &height,
+                                               &x_offset,
+                                               &y_offset);
+        if (sdf != nullptr)
+        {
+            uint32_t x, y;
+            if (place(static_cast<uint32_t>(width), static_cast<uint32_t>(height), x, y))
+            {
+                for (int row = 0; row < height; row++)
+                {
+                    memcpy(&pixels[(y + row) * SIZE + x], sdf + row * width, static_cast<size_t>(width));
+                }
+                glyph.has_bitmap = true;
+                glyph.uv_min     = glm::vec2(x, y) / static_cast<float>(SIZE);
+                glyph.uv_max     = glm::vec2(x + width, y + height) / static_cast<float>(SIZE);
+                glyph.offset     = glm::vec2(x_offset, y_offset);
+                glyph.size       = glm::vec2(width, height);
+                dirty_begin      = dirty() ? std::min(dirty_begin, y) : y;
+                dirty_end        = std::max(dirty_end, y + static_cast<uint32_t>(height));
+            }
+            else
+            {
+                fprintf(stderr, "glyph atlas is full, U+%04X is drawn blank\n", codepoint);
+            }
+            stbtt_FreeSDF(sdf, font.userdata);
+        }
+        return glyphs.emplace(codepoint, glyph).first->second;
+    }
+
+    float GlyphAtlas::kerning(const Glyph& left, const Glyph& right) const
+    {
+        return static_cast<float>(stbtt_GetGlyphKernAdvance(&font, left.index, right.index)) * font_scale;
+    }
+
+    bool GlyphAtlas::place(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y)
+    {
+        // a texel of gutter around every glyph keeps bilinear filtering from picking up its neighbours
+        if (shelf_x + width + 1 > SIZE)
+        {
+            shelf_y += shelf_height + 1;
+            shelf_x      = 1;
+            shelf_height = 0;
+        }
+        if (shelf_x + width + 1 > SIZE || shelf_y + height + 1 > SIZE)
+        {
+            return false;
+        }
+        x = shelf_x;
+        y = shelf_y;
+        shelf_x += width + 1;
+        shelf_height = std::max(shelf_height, height);
+        return true;
+    }
+
+    void TextRenderer::init(GpuDevice&           gpu,
+                            VkDevice             device,
+                            const std::string&   font_path,
+                            DescriptorAllocator& allocator,
+                            VkSampler            sampler,
+                            uint32_t             frame_count)
+    {
+        atlas.load(font_path);
+        gpu.createImage(GlyphAtlas::SIZE,
+                         GlyphAtlas::SIZE,
+                         VK_FORMAT_R8_UNORM,
+                         VK_IMAGE_TILING_OPTIMAL,
+                         VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                         atlas_image,
+                         atlas_memory);
+        atlas_view = gpu.createImageView(atlas_image, VK_FORMAT_R8_UNORM);
+
+        vertex_buffers.resize(frame_count);
+        vertex_buffers_memory.resize(frame_count);
+        vertex_buffers_mapped.resize(frame_count);
+        vertex_capacities.assign(frame_count, 0);
+        for (uint32_t i = 0; i < frame_count; i++)
+        {
+            createVertexBuffer(gpu, device, i, INITIAL_QUADS * 6);
+        }
+
+        VkDescriptorSetLayoutBinding atlas_binding {};
+        atlas_binding.binding         = 0;
+        atlas_binding.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        atlas_binding.descriptorCount = 1;
+        atlas_binding.stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT;
+        VkDescriptorSetLayoutCreateInfo layout_info {};
+        layout_info.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layout_info.bindingCount = 1;
+        layout_info.pBindings    = &atlas_binding;
+        if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &set_layout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create text descriptor set layout!");
+        }
+        DescriptorBinding image_binding {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
+        image_binding.image = {sampler, atlas_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        descriptor_set      = allocator.allocate(set_layout);
+        writeDescriptorSet(device, descriptor_set, {image_binding});
+
+        // the scale from pixels to normalized device coordinates, 2 / extent
+        VkPushConstantRange push_constant_range {};
+        push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        push_constant_range.offset     = 0;
+        push_constant_range.size       = sizeof(glm::vec2);
+
+        VkPipelineLayoutCreateInfo pipeline_layout_info {};
+        pipeline_layout_info.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipeline_layout_info.setLayoutCount         = 1;
+        pipeline_layout_info.pSetLayouts            = &set_layout;
+        pipeline_layout_info.pushConstantRangeCount = 1;
+        pipeline_layout_info.pPushConstantRanges    = &push_constant_range;
+        if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create text pipeline layout!");
+        }
+    }
+
+    void TextRenderer::createVertexBuffer(GpuDevice& gpu, VkDevice device, uint32_t frame, uint32_t capacity)
+    {
+        // rewritten by the CPU every frame, so it stays host visible and persistently mapped
+        gpu.createBuffer(sizeof(TextVertex) * capacity,
+                          VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                          vertex_buffers[frame],
+                          vertex_buffers_memory[frame]);
+        vkMapMemory(device, vertex_buffers_memory[frame], 0, VK_WHOLE_SIZE, 0, &vertex_buffers_mapped[frame]);
+        vertex_capacities[frame] = capacity;
+    }
+
+    void TextRenderer::cleanup(VkDevice device)
+    {
+        for (size_t i = 0; i < vertex_buffers.size(); i++)
+        {
+            vkDestroyBuffer(device, vertex_buffers[i], nullptr);
+            vkFreeMemory(device, vertex_buffers_memory[i], nullptr);
+        }
+        vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+        vkDestroyDescriptorSetLayout(device, set_layout, nullptr);
+        vkDestroyImageView(device, atlas_view, nullptr);
+        vkDestroyImage(device, atlas_image, nullptr);
+        vkFreeMemory(device, atlas_memory, nullptr);
+    }
+
+    GraphicsPipelineDesc TextRenderer::pipelineDesc(VkFormat              color_format,
+                                                    VkSampleCountFlagBits samples,
+                                                    VkRenderPass          render_pass) const
+    {
+        auto                 attribute_descriptions = TextVertex::getAttributeDescriptions();
+        GraphicsPipelineDesc desc;
+        desc.vertex_shader     = "../shader/text_vert.spv";
+        desc.fragment_shader   = "../shader/text_frag.spv";
+        desc.layout            = pipeline_layout;
+        desc.vertex_bindings   = {TextVertex::getBindingDescription()};
+        desc.vertex_attributes = {attribute_descriptions.begin(), attribute_descriptions.end()};
+        desc.cull_mode         = VK_CULL_MODE_NONE;
+        desc.blend             = BlendMode::Alpha;
+        desc.color_format      = color_format;
+        desc.samples           = samples;
+        desc.render_pass       = render_pass;
+        return desc;
+    }
+
+    void TextRenderer::begin(uint32_t frame)
+    {
+        current_frame = frame;
+        vertices.clear();
+    }
+
+    template <typename EmitFn>
+    glm::vec2 TextRenderer::layout(std::string_view utf8, glm::vec2 position, float pixel_size, EmitFn&& emit)
+    {
+        float        scale      = pixel_size / GlyphAtlas::BASE_PIXEL_SIZE;
+        float        line_step  = atlas.lineHeight() * scale;
+        glm::vec2    pen        = {position.x, position.y + atlas.ascent() * scale}; // on the baseline
+        float        width      = 0.0f;
+        uint32_t     line_count = 1;
+        const Glyph* previous   = nullptr;
+        for (size_t i = 0; i < utf8.size();)
+        {
+            uint32_t codepoint = nextCodepoint(utf8, i);
+            if (codepoint == '\n')
+            {
+                width = std::max(width, pen.x - position.x);
+                pen.x = position.x;
+                pen.y += line_step;
+                line_count++;
+                previous = nullptr;
+                continue;
+            }
+            const Glyph& glyph = atlas.find(codepoint);
+            if (previous != nullptr)
+            {
+                pen.x += atlas.kerning(*previous, glyph) * scale;
+            }
+            if (glyph.has_bitmap)
+            {
+                emit(glyph, pen + glyph.offset * scale, glyph.size * scale);
+            }
+            pen.x += glyph.advance * scale;
+            previous = &glyph;
+        }
+        width = std::max(width, pen.x - position.x);
+        return {width, static_cast<float>(line_count) * line_step};
+    }
+
+    glm::vec2 TextRenderer::addText(std::string_view utf8, glm::vec2 position, float pixel_size, glm::vec4 color)
+    {
+        uint32_t packed = packColor(color);
+        return layout(utf8, position, pixel_size, [&](const Glyph& glyph, glm::vec2 top_left, glm::vec2 size) {
+            glm::vec2 bottom_right = top_left + size;
+            TextVertex corners[4]  = {
+                {top_left, glyph.uv_min, packed},
+                {{bottom_right.x, top_left.y}, {glyph.uv_max.x, glyph.uv_min.y}, packed},
+                {bottom_right, glyph.uv_max, packed},
+                {{top_left.x, bottom_right.y}, {glyph.uv_min.x, glyph.uv_max.y}, packed},
+            };
+            vertices.insert(vertices.end(),
+                            {corners[0], corners[1], corners[2], corners[0], corners[2], corners[3]});
+        });
+    }
+
+    glm::vec2 TextRenderer::measure(std::string_view utf8, float pixel_size)
+    {
+        return layout(utf8, {0.0f, 0.0f}, pixel_size, [](const Glyph&, glm::vec2, glm::vec2) {});
+    }
+
+    void TextRenderer::flush(GpuDevice& gpu, VkDevice device)
+    {
+        auto vertex_count = static_cast<uint32_t>(vertices.size());
+        if (vertex_count > vertex_capacities[current_frame])
+        {
+            // this frame's fence has been waited on, nothing reads the old buffer any more
+            vkDestroyBuffer(device, vertex_buffers[current_frame], nullptr);
+            vkFreeMemory(device, vertex_buffers_memory[current_frame], nullptr);
+            createVertexBuffer(gpu, device, current_frame, std::bit_ceil(vertex_count));
+        }
+        memcpy(vertex_buffers_mapped[current_frame], vertices.data(), sizeof(TextVertex) * vertex_count);
+
+        if (atlas.dirty())
+        {
+            // only the rows new glyphs landed in
+            size_t begin   = static_cast<size_t>(atlas.dirtyBegin()) * GlyphAtlas::SIZE;
+            size_t end     = static_cast<size_t>(atlas.dirtyEnd()) * GlyphAtlas::SIZE;
+            upload_staging = gpu.stageForFrame(end - begin);
+            memcpy(upload_staging.data, atlas.getPixels().data() + begin, end - begin);
+            upload_rows = {atlas.dirtyBegin(), atlas.dirtyEnd()};
+            atlas.clearDirty();
+        }
+    }
+
+    void TextRenderer::recordUpload(VkCommandBuffer command_buffer)
+    {
+        VkBufferImageCopy region {};
+        region.bufferOffset                    = upload_staging.offset;
+        region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel       = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount     = 1;
+        region.imageOffset                     = {0, static_cast<int32_t>(upload_rows.first), 0};
+        region.imageExtent = {GlyphAtlas::SIZE, upload_rows.second - upload_rows.first, 1};
+        vkCmdCopyBufferToImage(command_buffer,
+                               upload_staging.buffer,
+                               atlas_image,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               1,
+                               &region);
+        atlas_initialized = true;
+        upload_rows       = {};
+    }
+
+    void TextRenderer::recordDraw(VkCommandBuffer command_buffer, VkPipeline pipeline, VkExtent2D extent) const
+    {
+        if (vertices.empty())
+        {
+            return;
+        }
+        glm::vec2    pixel_to_ndc = {2.0f / static_cast<float>(extent.width), 2.0f / static_cast<float>(extent.height)};
+        VkDeviceSize offset       = 0;
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        vkCmdBindDescriptorSets(
+            command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+        vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertex_buffers[current_frame], &offset);
+        vkCmdPushConstants(
+            command_buffer, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pixel_to_ndc), &pixel_to_ndc);
+        // every label of the frame in one draw
+        vkCmdDraw(command_buffer, static_cast<uint32_t>(vertices.size()), 1, 0, 0);
+    }
+} // namespace vulkanDetails
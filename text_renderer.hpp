@@ -0,0 +1,148 @@
+#pragma once
+#include "descriptor_allocator.hpp"
+#include "pipeline_registry.hpp"
+#include "staging_ring.hpp"
+#include "vulkan/vulkan.h"
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <stb/stb_truetype.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vulkanDetails
+{
+    class GpuDevice;
+
+    // One corner of a glyph quad; positions are in pixels from the top-left of the target.
+    struct TextVertex
+    {
+        glm::vec2 pos;
+        glm::vec2 tex_coord;
+        uint32_t  color; // RGBA8
+
+        static VkVertexInputBindingDescription                  getBindingDescription();
+        static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions();
+    };
+
+    // Where a rasterized glyph sits in the atlas and how to place it, in pixels at GlyphAtlas::BASE_PIXEL_SIZE.
+    struct Glyph
+    {
+        int       index      = 0;     // glyph index in the font, for kerning
+        bool      has_bitmap = false; // false for whitespace, which only advances the pen
+        glm::vec2 uv_min {};
+        glm::vec2 uv_max {};
+        glm::vec2 offset {}; // top-left corner relative to the pen on the baseline
+        glm::vec2 size {};
+        float     advance = 0.0f;
+    };
+
+    // Signed distance fields of a TTF font's glyphs, packed into one R8 image on the CPU. Glyphs are rasterized the
+    // first time they are asked for; the rows touched since the last upload are tracked so only those are copied.
+    //
+    // A distance field keeps edges sharp under magnification, so one size in the atlas serves every text size.
+    // Glyphs that no longer fit are laid out but drawn blank.
+    class GlyphAtlas
+    {
+    public:
+        static constexpr uint32_t SIZE            = 1024;
+        static constexpr float    BASE_PIXEL_SIZE = 48.0f;
+        static constexpr int      SDF_PADDING     = 6; // distance range in pixels on either side of an edge
+
+        void load(const std::string& font_path);
+
+        const Glyph&        find(uint32_t codepoint);
+        [[nodiscard]] float kerning(const Glyph& left, const Glyph& right) const;
+        [[nodiscard]] float ascent() const { return font_ascent; }
+        [[nodiscard]] float lineHeight() const { return line_height; }
+
+        [[nodiscard]] const std::vector<uint8_t>& getPixels() const { return pixels; }
+        [[nodiscard]] bool                        dirty() const { return dirty_end > dirty_begin; }
+        // First and one-past-last row changed since clearDirty().
+        [[nodiscard]] uint32_t dirtyBegin() const { return dirty_begin; }
+        [[nodiscard]] uint32_t dirtyEnd() const { return dirty_end; }
+        void                   clearDirty() { dirty_begin = dirty_end = 0; }
+
+    private:
+        bool place(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y);
+
+        std::vector<unsigned char>          font_data; // stbtt_fontinfo points into it
+        stbtt_fontinfo                      font {};
+        float                               font_scale  = 0.0f;
+        float                               font_ascent = 0.0f;
+        float                               line_height = 0.0f;
+        std::vector<uint8_t>                pixels;
+        std::unordered_map<uint32_t, Glyph> glyphs; // references stay valid while glyphs are added
+        // shelf packer: glyphs fill rows left to right, a new shelf starts below the tallest glyph of the last one
+        uint32_t                            shelf_x      = 1;
+        uint32_t                            shelf_y      = 1;
+        uint32_t                            shelf_height = 0;
+        uint32_t                            dirty_begin  = 0;
+        uint32_t                            dirty_end    = SIZE; // the first upload initializes the whole image
+    };
+
+    // Lays strings out into glyph quads of one shared vertex buffer per frame in flight and draws all of them with
+    // a single vkCmdDraw, no matter how many labels there are or how large each one is.
+    //
+    // Per frame: begin(), any number of addText(), flush() before recording, then recordUpload() outside and
+    // recordDraw() inside the render pass. The atlas stays in SHADER_READ_ONLY_OPTIMAL between frames.
+    class TextRenderer
+    {
+    public:
+        void init(GpuDevice&           gpu,
+                  VkDevice             device,
+                  const std::string&   font_path,
+                  DescriptorAllocator& allocator,
+                  VkSampler            sampler,
+                  uint32_t             frame_count);
+        void cleanup(VkDevice device);
+
+        [[nodiscard]] GraphicsPipelineDesc pipelineDesc(VkFormat              color_format,
+                                                        VkSampleCountFlagBits samples,
+                                                        VkRenderPass          render_pass) const;
+
+        void begin(uint32_t frame);
+        // Lays utf8 out with its top-left corner at position; '\n' starts a new line. Returns the size of the text.
+        glm::vec2 addText(std::string_view utf8, glm::vec2 position, float pixel_size, glm::vec4 color);
+        glm::vec2 measure(std::string_view utf8, float pixel_size);
+        // Copies this frame's quads into its vertex buffer, growing it if needed, and any new glyphs into the
+        // frame's staging space.
+        void      flush(GpuDevice& gpu, VkDevice device);
+
+        [[nodiscard]] bool        uploadPending() const { return upload_rows.second > upload_rows.first; }
+        [[nodiscard]] bool        atlasInitialized() const { return atlas_initialized; }
+        [[nodiscard]] VkImage     getAtlasImage() const { return atlas_image; }
+        [[nodiscard]] VkImageView getAtlasView() const { return atlas_view; }
+        [[nodiscard]] uint32_t    quadCount() const { return static_cast<uint32_t>(vertices.size() / 6); }
+
+        // Expects the atlas in TRANSFER_DST_OPTIMAL.
+        void recordUpload(VkCommandBuffer command_buffer);
+        void recordDraw(VkCommandBuffer command_buffer, VkPipeline pipeline, VkExtent2D extent) const;
+
+    private:
+        // Walks the glyphs of utf8 and calls emit for every one with a bitmap; returns the size of the text.
+        template <typename EmitFn>
+        glm::vec2 layout(std::string_view utf8, glm::vec2 position, float pixel_size, EmitFn&& emit);
+        void      createVertexBuffer(GpuDevice& gpu, VkDevice device, uint32_t frame, uint32_t capacity);
+
+        GlyphAtlas                    atlas;
+        VkImage                       atlas_image {};
+        VkDeviceMemory                atlas_memory {};
+        VkImageView                   atlas_view {};
+        bool                          atlas_initialized = false; // false until the first upload left it readable
+        StagingAllocation             upload_staging; // the dirty rows, packed, in the frame's staging space
+        std::pair<uint32_t, uint32_t> upload_rows {}; // atlas rows upload_staging holds
+        VkDescriptorSetLayout         set_layout {};
+        VkDescriptorSet               descriptor_set {};
+        VkPipelineLayout              pipeline_layout {};
+        std::vector<VkBuffer>         vertex_buffers;
+        std::vector<VkDeviceMemory>   vertex_buffers_memory;
+        std::vector<void*>            vertex_buffers_mapped;
+        std::vector<uint32_t>         vertex_capacities; // in vertices
+        std::vector<TextVertex>       vertices;          // the current frame's quads, 6 vertices each
+        uint32_t                      current_frame = 0;
+    };
+} // namespace vulkanDetails
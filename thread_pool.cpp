@@ -0,0 +1,154 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace vulkanDetails
+{
+    ThreadPool::ThreadPool(uint32_t thread_count)
+    {
+        workers.reserve(thread_count);
+        for (uint32_t i = 0; i < thread_count; i++)
+        {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        task_available.notify_all();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    uint32_t ThreadPool::defaultThreadCount()
+    {
+        // leave one hardware thread for the caller, which always participates in parallelFor
+        uint32_t hardware_threads = std::thread::hardware_concurrency();
+        return hardware_threads > 1 ? hardware_threads - 1 : 0;
+    }
+
+    void ThreadPool::workerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(mutex);
+                task_available.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty())
+                {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::future<void> ThreadPool::submit(std::function<void()> task)
+    {
+        auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+        auto future   = packaged->get_future();
+        if (workers.empty())
+        {
+            (*packaged)();
+            return future;
+        }
+        {
+            std::lock_guard lock(mutex);
+            tasks.emplace_back([packaged] { (*packaged)(); });
+        }
+        task_available.notify_one();
+        return future;
+    }
+
+    void ThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t)>& fn)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        if (count == 1 || workers.empty())
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                fn(i);
+            }
+            return;
+        }
+
+        // helpers may start after the caller has already drained every item, so the shared state must outlive this call
+        struct Job
+        {
+            const std::function<void(uint32_t)>* fn;
+            uint32_t                             count;
+            std::atomic<uint32_t>                next {0};
+            std::atomic<uint32_t>                finished {0};
+            std::atomic<bool>                    failed {false};
+            std::exception_ptr                   error; // the first one thrown, guarded by done_mutex
+            std::mutex                           done_mutex;
+            std::condition_variable              done;
+        };
+        auto job   = std::make_shared<Job>();
+        job->fn    = &fn;
+        job->count = count;
+
+        auto run = [](Job& state) {
+            uint32_t completed = 0;
+            for (uint32_t i = state.next.fetch_add(1); i < state.count; i = state.next.fetch_add(1))
+            {
+                // after a failure the remaining items are still claimed and counted, just not run, so the
+                // countdown the caller waits on always completes
+                if (!state.failed.load())
+                {
+                    try
+                    {
+                        (*state.fn)(i);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard lock(state.done_mutex);
+                        if (!state.error)
+                        {
+                            state.error = std::current_exception();
+                        }
+                        state.failed = true;
+                    }
+                }
+                completed++;
+            }
+            if (completed > 0 && state.finished.fetch_add(completed) + completed == state.count)
+            {
+                std::lock_guard lock(state.done_mutex);
+                state.done.notify_all();
+            }
+        };
+
+        uint32_t helper_count = std::min(static_cast<uint32_t>(workers.size()), count - 1);
+        {
+            std::lock_guard lock(mutex);
+            for (uint32_t i = 0; i < helper_count; i++)
+            {
+                tasks.emplace_back([job, run] { run(*job); });
+            }
+        }
+        task_available.notify_all();
+
+        run(*job);
+        std::unique_lock lock(job->done_mutex);
+        job->done.wait(lock, [&job] { return job->finished.load() == job->count; });
+        if (job->error)
+        {
+            std::rethrow_exception(job->error);
+        }
+    }
+} // namespace vulkanDetails
@@ -0,0 +1,40 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vulkanDetails
+{
+    // Small fixed-size worker pool. parallelFor() blocks the caller, who also takes part in the work;
+    // submit() queues a fire-and-forget task and hands back a future for its completion.
+    class ThreadPool
+    {
+    public:
+        explicit ThreadPool(uint32_t thread_count = defaultThreadCount());
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&)            = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Calls fn(i) for every i in [0, count). Work items are handed out dynamically, so uneven items balance out.
+        // If fn throws, the items not started yet are skipped and the first exception is rethrown on the caller.
+        void              parallelFor(uint32_t count, const std::function<void(uint32_t)>& fn);
+        std::future<void> submit(std::function<void()> task);
+        [[nodiscard]] uint32_t workerCount() const { return static_cast<uint32_t>(workers.size()); }
+
+        static uint32_t defaultThreadCount();
+
+    private:
+        void workerLoop();
+
+        std::vector<std::thread>          workers;
+        std::deque<std::function<void()>> tasks;
+        std::mutex                        mutex;
+        std::condition_variable           task_available;
+        bool                              stopping = false;
+    };
+} // namespace vulkanDetails
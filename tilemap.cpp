@@ -0,0 +1,393 @@
+#include "tilemap.hpp"
+#include "barrier_batch.hpp"
+#include "vulkan_util.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace vulkanDetails
+{
+    // chunks and the animated buffer draw from the same index buffer
+    constexpr uint32_t MAX_QUADS = std::max(Tilemap::CHUNK_SIZE * Tilemap::CHUNK_SIZE, Tilemap::ANIMATED_BATCH_QUADS);
+    static_assert(MAX_QUADS * 4 <= UINT16_MAX + 1, "tile quads are indexed with 16 bits");
+    // a full chunk, so a slot never has to move when its chunk gains tiles
+    constexpr VkDeviceSize CHUNK_SLOT_SIZE = sizeof(Vertex) * 4 * Tilemap::CHUNK_SIZE * Tilemap::CHUNK_SIZE;
+
+    void Tilemap::init(GpuDevice& gpu_device,
+                       uint32_t   map_width,
+                       uint32_t   map_height,
+                       glm::uvec2 tileset_grid,
+                       glm::vec2  origin,
+                       float      tile_size,
+                       uint32_t   frame_count)
+    {
+        gpu         = &gpu_device;
+        width       = map_width;
+        height      = map_height;
+        chunks_x    = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        chunks_y    = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        tileset     = tileset_grid;
+        map_origin  = origin;
+        tile_extent = tile_size;
+        tiles.assign(static_cast<size_t>(width) * height, EMPTY);
+        chunks.resize(static_cast<size_t>(chunks_x) * chunks_y);
+        stats.chunk_count = static_cast<uint32_t>(chunks.size());
+
+        // the same two triangles for every quad, so one buffer serves every chunk
+        std::vector<uint16_t> quad_indices;
+        quad_indices.reserve(MAX_QUADS * 6);
+        for (uint32_t quad = 0; quad < MAX_QUADS; quad++)
+        {
+            auto first = static_cast<uint16_t>(quad * 4);
+            for (uint16_t corner : {0, 1, 2, 2, 3, 0})
+            {
+                quad_indices.push_back(static_cast<uint16_t>(first + corner));
+            }
+        }
+        VkDeviceSize index_size = sizeof(uint16_t) * quad_indices.size();
+        gpu->createBuffer(index_size,
+                          VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                          index_buffer,
+                          index_memory);
+        gpu->uploadBuffer(index_buffer, 0, quad_indices.data(), index_size);
+
+        animated_buffers.resize(frame_count);
+        animated_buffers_memory.resize(frame_count);
+        animated_buffers_mapped.resize(frame_count);
+        animated_capacities.resize(frame_count);
+        for (uint32_t i = 0; i < frame_count; i++)
+        {
+            createAnimatedBuffer(i, ANIMATED_BATCH_QUADS);
+        }
+    }
+
+    void Tilemap::createAnimatedBuffer(uint32_t frame, uint32_t quad_capacity)
+    {
+        // rewritten by the CPU every frame, so it stays host visible and persistently mapped
+        gpu->createBuffer(sizeof(Vertex) * 4 * quad_capacity,
+                          VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                          animated_buffers[frame],
+                          animated_buffers_memory[frame]);
+        vkMapMemory(
+            gpu->getDevice(), animated_buffers_memory[frame], 0, VK_WHOLE_SIZE, 0, &animated_buffers_mapped[frame]);
+        animated_capacities[frame] = quad_capacity;
+    }
+
+    void Tilemap::destroyAnimatedBuffer(VkDevice device, uint32_t frame)
+    {
+        vkDestroyBuffer(device, animated_buffers[frame], nullptr);
+        vkFreeMemory(device, animated_buffers_memory[frame], nullptr);
+    }
+
+    void Tilemap::cleanup(VkDevice device)
+    {
+        for (size_t i = 0; i < arena_pages.size(); i++)
+        {
+            vkDestroyBuffer(device, arena_pages[i], nullptr);
+            vkFreeMemory(device, arena_pages_memory[i], nullptr);
+        }
+        for (uint32_t i = 0; i < animated_buffers.size(); i++)
+        {
+            destroyAnimatedBuffer(device, i);
+        }
+        vkDestroyBuffer(device, index_buffer, nullptr);
+        vkFreeMemory(device, index_memory, nullptr);
+        chunks.clear();
+        arena_pages.clear();
+        arena_pages_memory.clear();
+        free_slots.clear();
+        animated_buffers.clear();
+        animated_buffers_memory.clear();
+        animated_buffers_mapped.clear();
+        animated_capacities.clear();
+    }
+
+    void Tilemap::setTile(uint32_t x, uint32_t y, TileId tile)
+    {
+        TileId& current = tiles[static_cast<size_t>(y) * width + x];
+        if (current == tile)
+        {
+            return;
+        }
+        current = tile;
+        chunks[static_cast<size_t>(y / CHUNK_SIZE) * chunks_x + x / CHUNK_SIZE].dirty = true;
+    }
+
+    void Tilemap::setAnimation(TileId tile, const TileAnimation& animation)
+    {
+        animations[tile] = animation;
+        // tiles with this id move between the chunk buffers and the per-frame one; rare enough to not track which
+        for (auto& chunk : chunks)
+        {
+            chunk.dirty = true;
+        }
+    }
+
+    glm::vec2 Tilemap::chunkOrigin(uint32_t chunk_index) const
+    {
+        float chunk_extent = tile_extent * CHUNK_SIZE;
+        return map_origin + glm::vec2(static_cast<float>(chunk_index % chunks_x) * chunk_extent,
+                                      static_cast<float>(chunk_index / chunks_x) * chunk_extent);
+    }
+
+    void Tilemap::writeQuad(Vertex* out, glm::vec2 position, TileId tile) const
+    {
+        // v runs down the texture while y runs up the map
+        uint32_t  cell    = tile - 1u;
+        glm::vec2 uv_min  = {static_cast<float>(cell % tileset.x) / static_cast<float>(tileset.x),
+                             static_cast<float>(cell / tileset.x % tileset.y) / static_cast<float>(tileset.y)};
+        glm::vec2 uv_size = {1.0f / static_cast<float>(tileset.x), 1.0f / static_cast<float>(tileset.y)};
+        glm::vec2 uv_max  = uv_min + uv_size;
+        glm::vec3 white   = {1.0f, 1.0f, 1.0f};
+        out[0]            = {position, white, {uv_min.x, uv_max.y}};
+        out[1]            = {position + glm::vec2(tile_extent, 0.0f), white, uv_max};
+        out[2]            = {position + glm::vec2(tile_extent, tile_extent), white, {uv_max.x, uv_min.y}};
+        out[3]            = {position + glm::vec2(0.0f, tile_extent), white, uv_min};
+    }
+
+    VkDeviceSize Tilemap::slotOffset(uint32_t slot) const { return slot % SLOTS_PER_PAGE * CHUNK_SLOT_SIZE; }
+
+    uint32_t Tilemap::allocateSlot()
+    {
+        if (free_slots.empty())
+        {
+            // one allocation per SLOTS_PER_PAGE chunks instead of one per rebuild
+            VkBuffer       page;
+            VkDeviceMemory page_memory;
+            gpu->createBuffer(CHUNK_SLOT_SIZE * SLOTS_PER_PAGE,
+                              VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                              page,
+                              page_memory);
+            auto first = static_cast<uint32_t>(arena_pages.size()) * SLOTS_PER_PAGE;
+            arena_pages.push_back(page);
+            arena_pages_memory.push_back(page_memory);
+            // handed out lowest first
+            for (uint32_t i = SLOTS_PER_PAGE; i > 0; i--)
+            {
+                free_slots.push_back(first + i - 1);
+            }
+        }
+        uint32_t slot = free_slots.back();
+        free_slots.pop_back();
+        return slot;
+    }
+
+    void Tilemap::rebuildChunk(uint32_t chunk_index)
+    {
+        Chunk&   chunk   = chunks[chunk_index];
+        uint32_t first_x = chunk_index % chunks_x * CHUNK_SIZE;
+        uint32_t first_y = chunk_index / chunks_x * CHUNK_SIZE;
+        uint32_t end_x   = std::min(first_x + CHUNK_SIZE, width);
+        uint32_t end_y   = std::min(first_y + CHUNK_SIZE, height);
+
+        chunk.animated.clear();
+        uint32_t quad_count = 0;
+        for (uint32_t y = first_y; y < end_y; y++)
+        {
+            for (uint32_t x = first_x; x < end_x; x++)
+            {
+                TileId tile = tiles[static_cast<size_t>(y) * width + x];
+                if (tile == EMPTY)
+                {
+                    continue;
+                }
+                if (isAnimated(tile))
+                {
+                    chunk.animated.push_back(static_cast<uint16_t>((y - first_y) * CHUNK_SIZE + (x - first_x)));
+                    continue;
+                }
+                quad_count++;
+            }
+        }
+
+        // a slot given back is safe to hand out again right away: recordUpload orders every copy into the arena
+        // behind the vertex reads of frames in flight
+        chunk.quad_count = quad_count;
+        chunk.dirty      = false;
+        stats.rebuilt_chunks++;
+        stats.total_rebuilds++;
+        if (quad_count == 0)
+        {
+            if (chunk.slot != NO_SLOT)
+            {
+                free_slots.push_back(chunk.slot);
+                chunk.slot = NO_SLOT;
+            }
+            return;
+        }
+        if (chunk.slot == NO_SLOT)
+        {
+            chunk.slot = allocateSlot();
+        }
+
+        VkDeviceSize size = sizeof(Vertex) * 4 * quad_count;
+        // written straight into the frame's staging space, positions relative to the chunk
+        StagingAllocation staging = gpu->stageForFrame(size);
+        auto*             out     = static_cast<Vertex*>(staging.data);
+        for (uint32_t y = first_y; y < end_y; y++)
+        {
+            for (uint32_t x = first_x; x < end_x; x++)
+            {
+                TileId tile = tiles[static_cast<size_t>(y) * width + x];
+                if (tile == EMPTY || isAnimated(tile))
+                {
+                    continue;
+                }
+                glm::vec2 local = {static_cast<float>(x - first_x) * tile_extent,
+                                   static_cast<float>(y - first_y) * tile_extent};
+                writeQuad(out, local, tile);
+                out += 4;
+            }
+        }
+        uploads.push_back({staging.buffer, staging.offset, slotBuffer(chunk.slot), slotOffset(chunk.slot), size});
+    }
+
+    void Tilemap::update(const Frustum& frustum, uint32_t frame, float time)
+    {
+        current_frame         = frame;
+        stats.visible_chunks  = 0;
+        stats.rebuilt_chunks  = 0;
+        stats.deferred_chunks = 0;
+        stats.static_quads    = 0;
+        visible.clear();
+
+        float        chunk_extent = tile_extent * CHUNK_SIZE;
+        float        radius       = chunk_extent * std::sqrt(0.5f);
+        VkDeviceSize uploaded     = 0;
+        for (uint32_t i = 0; i < chunks.size(); i++)
+        {
+            glm::vec2 center = chunkOrigin(i) + glm::vec2(chunk_extent * 0.5f);
+            if (!frustum.intersectsSphere(glm::vec3(center, 0.0f), radius))
+            {
+                continue;
+            }
+            visible.push_back(i);
+            if (chunks[i].dirty)
+            {
+                // the rest keeps showing its old contents for another frame, so a large edit or the first look at
+                // the map never stalls on the staging ring
+                if (uploaded < UPLOAD_BUDGET_BYTES)
+                {
+                    rebuildChunk(i);
+                    uploaded += sizeof(Vertex) * 4 * chunks[i].quad_count;
+                }
+                else
+                {
+                    stats.deferred_chunks++;
+                }
+            }
+            stats.static_quads += chunks[i].quad_count;
+        }
+        stats.visible_chunks = static_cast<uint32_t>(visible.size());
+
+        // room for every animated tile of the visible chunks; this frame's fence has been waited on, so the old
+        // buffer is idle and can go right away
+        uint32_t animated_needed = 0;
+        for (uint32_t chunk_index : visible)
+        {
+            animated_needed += static_cast<uint32_t>(chunks[chunk_index].animated.size());
+        }
+        if (animated_needed > animated_capacities[current_frame])
+        {
+            uint32_t capacity = std::max(animated_needed, animated_capacities[current_frame] * 2);
+            destroyAnimatedBuffer(gpu->getDevice(), current_frame);
+            createAnimatedBuffer(current_frame, capacity);
+        }
+
+        auto* out           = static_cast<Vertex*>(animated_buffers_mapped[current_frame]);
+        animated_quad_count = 0;
+        for (uint32_t chunk_index : visible)
+        {
+            glm::vec2 origin = chunkOrigin(chunk_index);
+            uint32_t  first  = (chunk_index / chunks_x * CHUNK_SIZE) * width + chunk_index % chunks_x * CHUNK_SIZE;
+            for (uint16_t local : chunks[chunk_index].animated)
+            {
+                uint32_t x     = local % CHUNK_SIZE;
+                uint32_t y     = local / CHUNK_SIZE;
+                auto     found = animations.find(tiles[first + y * width + x]);
+                if (found == animations.end())
+                {
+                    // changed since the chunk was built, and its rebuild was deferred
+                    continue;
+                }
+                const TileAnimation& animation = found->second;
+                auto step = static_cast<uint32_t>(time / animation.frame_seconds) % animation.frame_count;
+                writeQuad(out + animated_quad_count * 4,
+                          origin + glm::vec2(static_cast<float>(x), static_cast<float>(y)) * tile_extent,
+                          static_cast<TileId>(animation.first_tile + step));
+                animated_quad_count++;
+            }
+        }
+        stats.animated_quads = animated_quad_count;
+    }
+
+    void Tilemap::recordUpload(VkCommandBuffer command_buffer)
+    {
+        // slots are written in place, earlier frames may still be drawing their old contents
+        BarrierBatch barriers;
+        for (const auto& upload : uploads)
+        {
+            barriers.bufferBarrier(upload.dst,
+                                   upload.dst_offset,
+                                   upload.size,
+                                   VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                   0,
+                                   VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                   VK_ACCESS_TRANSFER_WRITE_BIT);
+        }
+        barriers.flush(command_buffer);
+        for (const auto& upload : uploads)
+        {
+            VkBufferCopy region {};
+            region.srcOffset = upload.src_offset;
+            region.dstOffset = upload.dst_offset;
+            region.size      = upload.size;
+            vkCmdCopyBuffer(command_buffer, upload.src, upload.dst, 1, &region);
+            barriers.bufferBarrier(upload.dst,
+                                   upload.dst_offset,
+                                   upload.size,
+                                   VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                   VK_ACCESS_TRANSFER_WRITE_BIT,
+                                   VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                   VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+        }
+        barriers.flush(command_buffer);
+        uploads.clear();
+    }
+
+    void Tilemap::recordDraw(VkCommandBuffer command_buffer, VkPipelineLayout layout) const
+    {
+        ObjectPushConstants push {glm::mat4(1.0f), glm::vec4(1.0f)};
+        vkCmdBindIndexBuffer(command_buffer, index_buffer, 0, VK_INDEX_TYPE_UINT16);
+        for (uint32_t chunk_index : visible)
+        {
+            const Chunk& chunk = chunks[chunk_index];
+            if (chunk.quad_count == 0)
+            {
+                continue;
+            }
+            VkBuffer     buffer = slotBuffer(chunk.slot);
+            VkDeviceSize offset = slotOffset(chunk.slot);
+            push.model          = glm::translate(glm::mat4(1.0f), glm::vec3(chunkOrigin(chunk_index), 0.0f));
+            vkCmdBindVertexBuffers(command_buffer, 0, 1, &buffer, &offset);
+            vkCmdPushConstants(command_buffer, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push), &push);
+            vkCmdDrawIndexed(command_buffer, chunk.quad_count * 6, 1, 0, 0, 0);
+        }
+        if (animated_quad_count > 0)
+        {
+            // already in map space
+            push.model          = glm::mat4(1.0f);
+            VkDeviceSize offset = 0;
+            vkCmdBindVertexBuffers(command_buffer, 0, 1, &animated_buffers[current_frame], &offset);
+            vkCmdPushConstants(command_buffer, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push), &push);
+            // the shared index buffer only reaches ANIMATED_BATCH_QUADS quads, larger counts go out in batches
+            for (uint32_t first = 0; first < animated_quad_count; first += ANIMATED_BATCH_QUADS)
+            {
+                uint32_t count = std::min(animated_quad_count - first, ANIMATED_BATCH_QUADS);
+                vkCmdDrawIndexed(command_buffer, count * 6, 1, 0, static_cast<int32_t>(first * 4), 0);
+            }
+        }
+    }
+} // namespace vulkanDetails
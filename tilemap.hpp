@@ -0,0 +1,139 @@
+#pragma once
+#include "frustum_culling.hpp"
+#include "vulkan/vulkan.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace vulkanDetails
+{
+    class GpuDevice;
+    struct Vertex;
+
+    using TileId = uint16_t;
+
+    // Tiles with this id cycle through frame_count consecutive ids of the tileset, frame_seconds each.
+    struct TileAnimation
+    {
+        TileId   first_tile    = 0;
+        uint32_t frame_count   = 1;
+        float    frame_seconds = 0.25f;
+    };
+
+    struct TilemapStats
+    {
+        uint32_t chunk_count     = 0;
+        uint32_t visible_chunks  = 0;
+        uint32_t rebuilt_chunks  = 0; // this frame
+        uint32_t deferred_chunks = 0; // visible and changed, left for the next frames by the upload budget
+        uint32_t static_quads    = 0; // drawn this frame from chunk buffers
+        uint32_t animated_quads  = 0; // written this frame into the per-frame buffer
+        uint64_t total_rebuilds  = 0;
+    };
+
+    // A grid of tiles drawn from a tileset laid out as a grid in one texture, with the Vertex format, the push
+    // constant pipeline layout and the texture of the scene's descriptor set.
+    //
+    // Tiles are grouped into CHUNK_SIZE x CHUNK_SIZE chunks. Each chunk's vertices live in a slot of a pooled,
+    // device local arena, big enough for a full chunk, and are only rebuilt when one of its tiles changed, and only
+    // once the chunk is visible. A rebuild writes over the chunk's own slot; the upload waits for earlier frames'
+    // vertex reads first. Frames then cost one draw per visible chunk, however many tiles it has. All quads share
+    // one index buffer. Animated tiles stay out of the chunk slots: their quads are written every frame into a host
+    // visible buffer per frame in flight, which grows when the visible chunks hold more of them.
+    //
+    // Per frame: any number of setTile(), update(), recordUpload() outside and recordDraw() inside the render pass.
+    class Tilemap
+    {
+    public:
+        static constexpr uint32_t     CHUNK_SIZE           = 32; // tiles per side
+        static constexpr TileId       EMPTY                = 0;  // id n > 0 is cell n - 1 of the tileset
+        static constexpr uint32_t     ANIMATED_BATCH_QUADS = 4096; // per animated draw, and the initial capacity
+        static constexpr VkDeviceSize UPLOAD_BUDGET_BYTES  = 4 * 1024 * 1024; // chunk rebuilds per frame
+        static constexpr uint32_t     SLOTS_PER_PAGE       = 64; // chunk slots per arena buffer
+
+        // The map spans width x height tiles of tile_size from origin along +x and +y, in the z = 0 plane.
+        void init(GpuDevice& gpu,
+                  uint32_t   width,
+                  uint32_t   height,
+                  glm::uvec2 tileset_grid,
+                  glm::vec2  origin,
+                  float      tile_size,
+                  uint32_t   frame_count);
+        void cleanup(VkDevice device);
+
+        void                 setTile(uint32_t x, uint32_t y, TileId tile);
+        [[nodiscard]] TileId getTile(uint32_t x, uint32_t y) const { return tiles[static_cast<size_t>(y) * width + x]; }
+        void                 setAnimation(TileId tile, const TileAnimation& animation);
+
+        // Culls the chunks against frustum, rebuilds the visible changed ones within the upload budget and writes
+        // the animated tiles of the visible ones at time.
+        void update(const Frustum& frustum, uint32_t frame, float time);
+
+        [[nodiscard]] bool uploadPending() const { return !uploads.empty(); }
+        // Copies the rebuilt chunks into their slots and makes them visible to vertex input.
+        void               recordUpload(VkCommandBuffer command_buffer);
+        // Expects the tilemap pipeline and the scene's descriptor set bound; layout takes ObjectPushConstants.
+        void               recordDraw(VkCommandBuffer command_buffer, VkPipelineLayout layout) const;
+
+        [[nodiscard]] const TilemapStats& getStats() const { return stats; }
+
+    private:
+        static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+        struct Chunk
+        {
+            uint32_t              slot       = NO_SLOT; // in the arena, held while the chunk has static quads
+            uint32_t              quad_count = 0;
+            bool                  dirty      = true;
+            std::vector<uint16_t> animated; // tiles within the chunk drawn from the per-frame buffer
+        };
+
+        struct PendingUpload
+        {
+            VkBuffer     src;
+            VkDeviceSize src_offset;
+            VkBuffer     dst;
+            VkDeviceSize dst_offset;
+            VkDeviceSize size;
+        };
+
+        void                       rebuildChunk(uint32_t chunk_index);
+        // A free slot, adding a page to the arena when there is none.
+        uint32_t                   allocateSlot();
+        void                       createAnimatedBuffer(uint32_t frame, uint32_t quad_capacity);
+        void                       destroyAnimatedBuffer(VkDevice device, uint32_t frame);
+        [[nodiscard]] VkBuffer     slotBuffer(uint32_t slot) const { return arena_pages[slot / SLOTS_PER_PAGE]; }
+        [[nodiscard]] VkDeviceSize slotOffset(uint32_t slot) const;
+        // Four vertices of tile's quad with its lower left corner at position.
+        void                       writeQuad(Vertex* out, glm::vec2 position, TileId tile) const;
+        [[nodiscard]] glm::vec2    chunkOrigin(uint32_t chunk_index) const;
+        [[nodiscard]] bool         isAnimated(TileId tile) const { return animations.contains(tile); }
+
+        GpuDevice*                                gpu            = nullptr;
+        uint32_t                                  width          = 0;
+        uint32_t                                  height         = 0;
+        uint32_t                                  chunks_x       = 0;
+        uint32_t                                  chunks_y       = 0;
+        glm::uvec2                                tileset {1, 1};
+        glm::vec2                                 map_origin {};
+        float                                     tile_extent    = 1.0f;
+        uint32_t                                  current_frame  = 0;
+        std::vector<TileId>                       tiles;
+        std::vector<Chunk>                        chunks;
+        std::unordered_map<TileId, TileAnimation> animations;
+        std::vector<uint32_t>                     visible; // chunk indices, this frame
+        std::vector<PendingUpload>                uploads;
+        std::vector<VkBuffer>                     arena_pages;
+        std::vector<VkDeviceMemory>               arena_pages_memory;
+        std::vector<uint32_t>                     free_slots;
+        VkBuffer                                  index_buffer {};
+        VkDeviceMemory                            index_memory {};
+        std::vector<VkBuffer>                     animated_buffers;
+        std::vector<VkDeviceMemory>               animated_buffers_memory;
+        std::vector<void*>                        animated_buffers_mapped;
+        std::vector<uint32_t>                     animated_capacities; // quads, per frame in flight
+        uint32_t                                  animated_quad_count = 0;
+        TilemapStats                              stats;
+    };
+} // namespace vulkanDetails
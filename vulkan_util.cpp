@@ -4,13 +4,21 @@
 #include <SDL_events.h>
 #include <SDL_video.h>
 #include <SDL_vulkan.h>
+#include <algorithm>
+#include <bit>
 #include <chrono>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <exception>
+#include <filesystem>
 #include <glm/trigonometric.hpp>
+#include <map>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
@@ -18,15 +26,13 @@
 
 namespace vulkanDetails
 {
-    constexpr uint32_t       WIDTH                = 800;
-    constexpr uint32_t       HEIGHT               = 600;
-    constexpr int            MAX_FRAMES_IN_FLIGHT = 2;
-    std::vector<const char*> validation_layers    = {
-        "VK_LAYER_KHRONOS_validation",
-    };
-    const std::vector<const char*> device_extensions = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-    };
+    constexpr uint32_t WIDTH                    = 800;
+    constexpr uint32_t HEIGHT                   = 600;
+    constexpr int      MAX_FRAMES_IN_FLIGHT     = 2;
+    constexpr uint32_t MAX_GPU_OBJECTS          = 1 << 20;
+    constexpr uint32_t MAX_UNIFORM_OBJECTS      = 4096;
+    constexpr uint32_t DESCRIPTOR_SETS_PER_POOL = 64;
+    constexpr float    OVERLAY_TEXT_SIZE        = 18.0f; // pixels
     // const std::vector<Vertex> vertices = {{{0.0f, -0.5f}, {1.0f, 1.0f, 1.0f}},
     //                                       {{0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
     //                                       {{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
@@ -45,99 +51,98 @@ namespace vulkanDetails
 };
 
     const std::vector<uint16_t> indices = {0, 1, 2, 2, 3, 0};
-#ifdef NOEBUG
-    constexpr bool enable_validation_layers = false;
-#else
-    constexpr bool enable_validation_layers = true;
-#endif
-    VulkanBase* VulkanBase::m_singleton = nullptr;
-    VulkanBase* VulkanBase::getInstance()
+
+    VulkanBase::VulkanBase(std::shared_ptr<GpuDevice> gpu_device) : gpu(std::move(gpu_device)) {}
+
+    void VulkanBase::setOptions(const RendererOptions& renderer_options)
     {
-        if (m_singleton == nullptr)
-        {
-            m_singleton = new VulkanBase();
-        }
-        return m_singleton;
+        options = renderer_options;
+        simulation_clock.setRate(options.simulation_rate);
     }
 
     void VulkanBase::initWindow()
     {
+        startup_begin = std::chrono::high_resolution_clock::now();
+        if (options.headless)
+        {
+            drawable_extent = {WIDTH, HEIGHT};
+            return;
+        }
         if (SDL_Init(SDL_INIT_VIDEO) != 0)
         {
             std::cerr << "Failed to initialize SDL: " << SDL_GetError() << std::endl;
             return;
         }
 
-        window = SDL_CreateWindow("Vulkan",
-                                  SDL_WINDOWPOS_CENTERED,
-                                  SDL_WINDOWPOS_CENTERED,
-                                  WIDTH,
-                                  HEIGHT,
-                                  SDL_WINDOW_VULKAN | SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+        SDL_Window* window = SDL_CreateWindow("Vulkan",
+                                              SDL_WINDOWPOS_CENTERED,
+                                              SDL_WINDOWPOS_CENTERED,
+                                              WIDTH,
+                                              HEIGHT,
+                                              SDL_WINDOW_VULKAN | SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
         if (!window)
         {
             std::cerr << "Failed to create SDL window: " << SDL_GetError() << std::endl;
             SDL_Quit();
             return;
         }
+        output.setWindow(window);
+        int width, height;
+        SDL_Vulkan_GetDrawableSize(window, &width, &height);
+        drawable_extent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
     }
-    void VulkanBase::createInstance()
+    void VulkanBase::initVulkan()
     {
-        VkApplicationInfo app_info {};
-        app_info.sType              = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-        app_info.pApplicationName   = "Hello Vulkan";
-        app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
-        app_info.pEngineName        = "NinaEngine";
-        app_info.engineVersion      = VK_MAKE_VERSION(1, 0, 0);
-        app_info.apiVersion         = VK_API_VERSION_1_0;
-
-        VkInstanceCreateInfo create_info {};
-        create_info.sType            = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-        create_info.pApplicationInfo = &app_info;
-
-        auto extensions                     = getRequiredExtensions();
-        create_info.enabledExtensionCount   = static_cast<uint32_t>(extensions.size());
-        create_info.ppEnabledExtensionNames = extensions.data();
-
-        if (VkResult result = vkCreateInstance(&create_info, nullptr, &instance); result != VK_SUCCESS)
+        // the first output brings the shared device up, later ones only have to be able to present with it
+        if (!gpu->instanceCreated())
         {
-            throw std::runtime_error("failed to create instance!");
+            gpu->createInstance(getRequiredExtensions());
         }
-        if (enable_validation_layers && !checkValidationLayerSupport(validation_layers))
+        if (!options.headless)
         {
-            throw std::runtime_error("validation layers requested, but not available!");
+            output.createSurface(gpu->getInstance());
         }
-        if (enable_validation_layers)
+        if (!gpu->physicalDeviceSelected())
         {
-            create_info.enabledLayerCount   = static_cast<uint32_t>(validation_layers.size());
-            create_info.ppEnabledLayerNames = validation_layers.data();
+            gpu->pickPhysicalDevice(output.getSurface(), options.gpu);
         }
-    }
-
-    void VulkanBase::initVulkan()
-    {
-        createInstance();
-        setupDebugMessenger();
-        createSurface();
-        pickPhysicalDevice();
+        else if (!options.headless && !gpu->canPresent(output.getSurface()))
+        {
+            throw std::runtime_error("the shared device cannot present to this window!");
+        }
+        physical_device = gpu->getPhysicalDevice();
+        msaa_samples    = chooseMsaaSamples(options.msaa_samples);
+        initDynamicResolution();
         createLogicalDevice();
+        deletion_queue.init(device);
+        frame_readback.init(options.capture, MAX_FRAMES_IN_FLIGHT);
+        frame_graph.init(physical_device, device, deletion_queue, dynamic_rendering);
         createSwapChain();
-        createImageViews();
+        checkUpscaleSupport();
+        frame_readback.resize(*gpu, device, output.getExtent(), output.getFormat());
         createTextureSampler();
         createRenderPass();
         createDescriptorSetLayout();
+        createDescriptorAllocators();
+        initGpuCulling();
+        initText();
+        initParticles();
+        createPipelineLayouts();
         createGraphicsPipeline();
-        createFrameBuffer();
         createCommandPool();
         createTextureImage();
         createTextureImageView();
         createVertexBuffer();
         createIndexBuffer();
         createUniformBuffer();
-        createDescriptorPool();
+        initScene();
+        initTilemap();
         createDescriptorSets();
         createCommandBuffers();
         createSyncObject();
+        createTimestampQueries();
+        auto startup_end = std::chrono::high_resolution_clock::now();
+        startup_ms       = std::chrono::duration<double, std::milli>(startup_end - startup_begin).count();
     }
     void VulkanBase::createTextureSampler()
     {
@@ -164,84 +169,117 @@ namespace vulkanDetails
         }
     }
 
-    VkImageView VulkanBase::createImageView(VkImage image, VkFormat format)
+    VkSampleCountFlagBits VulkanBase::chooseMsaaSamples(uint32_t requested_samples)
     {
-        VkImageViewCreateInfo view_info {};
-        view_info.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        view_info.image                           = image;
-        view_info.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
-        view_info.format                          = format;
-        view_info.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        view_info.subresourceRange.baseMipLevel   = 0;
-        view_info.subresourceRange.levelCount     = 1;
-        view_info.subresourceRange.baseArrayLayer = 0;
-        view_info.subresourceRange.layerCount     = 1;
-
-        VkImageView image_view;
-        if (vkCreateImageView(device, &view_info, nullptr, &image_view) != VK_SUCCESS)
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physical_device, &properties);
+        VkSampleCountFlags supported = properties.limits.framebufferColorSampleCounts;
+        for (uint32_t samples = std::bit_floor(std::clamp(requested_samples, 1u, 8u)); samples > 1; samples >>= 1)
         {
-            throw std::runtime_error("failed to create image view!");
+            if ((supported & samples) != 0)
+            {
+                return static_cast<VkSampleCountFlagBits>(samples);
+            }
         }
+        return VK_SAMPLE_COUNT_1_BIT;
+    }
 
-        return image_view;
+    void VulkanBase::setMsaaSamples(uint32_t requested_samples)
+    {
+        msaa_samples = chooseMsaaSamples(requested_samples);
+        // the render pass and pipelines depend on the sample count, the graph picks up the new target itself
+        recreateSwapChain();
     }
-    void VulkanBase::createTextureImageView()
+
+    uint32_t VulkanBase::graphicsTimestampBits() const
     {
-        texture_image_view = createImageView(texture_image, VK_FORMAT_R8G8B8A8_SRGB);
+        uint32_t family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, nullptr);
+        std::vector<VkQueueFamilyProperties> families(family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, families.data());
+        return families[gpu->getQueueFamilies().graphics_family.value()].timestampValidBits;
     }
-    VkCommandBuffer VulkanBase::beginSingleTimeCommands()
+
+    void VulkanBase::createTimestampQueries()
     {
-        VkCommandBufferAllocateInfo alloc_info {};
-        alloc_info.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        alloc_info.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        alloc_info.commandPool        = command_pool;
-        alloc_info.commandBufferCount = 1;
-        VkCommandBuffer command_buffer;
-        vkAllocateCommandBuffers(device, &alloc_info, &command_buffer);
-        VkCommandBufferBeginInfo begin_info {};
-        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        uint32_t valid_bits = graphicsTimestampBits();
+        if (valid_bits == 0)
+        {
+            return;
+        }
+        // the bits above valid_bits are undefined, and the counter wraps at 2^valid_bits
+        timestamp_mask = valid_bits >= 64 ? ~uint64_t(0) : (uint64_t(1) << valid_bits) - 1;
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physical_device, &properties);
+        timestamp_period = properties.limits.timestampPeriod;
 
-        vkBeginCommandBuffer(command_buffer, &begin_info);
-        return command_buffer;
+        // a begin/end pair per frame in flight
+        VkQueryPoolCreateInfo query_pool_info {};
+        query_pool_info.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        query_pool_info.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+        query_pool_info.queryCount = MAX_FRAMES_IN_FLIGHT * 2;
+        if (vkCreateQueryPool(device, &query_pool_info, nullptr, &timestamp_query_pool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
     }
-    void VulkanBase::endSingleTimeCommands(VkCommandBuffer command_buffer)
+
+    void VulkanBase::initDynamicResolution()
     {
-        vkEndCommandBuffer(command_buffer);
+        if (options.gpu_budget_ms <= 0.0)
+        {
+            return;
+        }
+        if (graphicsTimestampBits() == 0)
+        {
+            // the controller has nothing to go by
+            std::cerr << "GPU timestamps are not supported, dynamic resolution is disabled" << std::endl;
+            return;
+        }
+        resolution_controller.init(options.gpu_budget_ms);
+        dynamic_resolution_active = true;
+    }
 
-        VkSubmitInfo submit_info {};
-        submit_info.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submit_info.commandBufferCount = 1;
-        submit_info.pCommandBuffers    = &command_buffer;
+    void VulkanBase::checkUpscaleSupport()
+    {
+        if (!dynamic_resolution_active)
+        {
+            return;
+        }
+        // the scaled target has the swapchain's format and both are optimally tiled, one query covers both ends
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physical_device, output.getFormat(), &properties);
+        VkFormatFeatureFlags blit = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+        if ((properties.optimalTilingFeatures & blit) != blit)
+        {
+            std::cerr << "the swapchain format cannot be blitted, dynamic resolution is disabled" << std::endl;
+            dynamic_resolution_active = false;
+            return;
+        }
+        if ((properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) == 0)
+        {
+            upscale_filter = VK_FILTER_NEAREST;
+        }
+    }
 
-        vkQueueSubmit(graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
-        vkQueueWaitIdle(graphics_queue);
+    void VulkanBase::createTextureImageView()
+    {
+        texture_image_view = gpu->createImageView(texture_image, VK_FORMAT_R8G8B8A8_SRGB);
+    }
 
-        vkFreeCommandBuffers(device, command_pool, 1, &command_buffer);
+    VkImageView VulkanBase::sceneTextureView() const
+    {
+        return stream_source ? streaming_texture.getImageView() : texture_image_view;
     }
     void VulkanBase::createTextureImage()
     {
         int      tex_width, tex_height, tex_channels;
         stbi_uc* pixels = stbi_load("../textures/texture.jpg", &tex_width, &tex_height, &tex_channels, STBI_rgb_alpha);
-        VkDeviceSize image_size = tex_width * tex_height * 4;
         if (!pixels)
         {
             throw std::runtime_error("failed to load texture image!");
         }
-        VkBuffer       staging_buffer;
-        VkDeviceMemory staging_buffer_memory;
-        createBuffer(image_size,
-                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                     staging_buffer,
-                     staging_buffer_memory);
-        void* data;
-        vkMapMemory(device, staging_buffer_memory, 0, image_size, 0, &data);
-        memcpy(data, pixels, static_cast<size_t>(image_size));
-        vkUnmapMemory(device, staging_buffer_memory);
-        stbi_image_free(pixels);
-
-        createImage(tex_width,
+        gpu->createImage(tex_width,
                     tex_height,
                     VK_FORMAT_R8G8B8A8_SRGB,
                     VK_IMAGE_TILING_OPTIMAL,
@@ -249,136 +287,53 @@ namespace vulkanDetails
                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                     texture_image,
                     texture_image_memory);
-        transitionImageLayout(
-            texture_image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        copyBufferToImage(
-            staging_buffer, texture_image, static_cast<uint32_t>(tex_width), static_cast<uint32_t>(tex_height));
-        transitionImageLayout(texture_image,
-                              VK_FORMAT_R8G8B8A8_SRGB,
-                              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-        vkDestroyBuffer(device, staging_buffer, nullptr);
-        vkFreeMemory(device, staging_buffer_memory, nullptr);
-    }
-
-    void VulkanBase::createImage(uint32_t              width,
-                                 uint32_t              height,
-                                 VkFormat              format,
-                                 VkImageTiling         tiling,
-                                 VkImageUsageFlags     usage,
-                                 VkMemoryPropertyFlags properties,
-                                 VkImage&              image,
-                                 VkDeviceMemory&       image_memory)
-    {
-        VkImageCreateInfo image_info {};
-        image_info.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-        image_info.imageType     = VK_IMAGE_TYPE_2D;
-        image_info.extent.width  = width;
-        image_info.extent.height = height;
-        image_info.extent.depth  = 1;
-        image_info.mipLevels     = 1;
-        image_info.arrayLayers   = 1;
-        image_info.format        = format;
-        image_info.tiling        = tiling;
-        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        image_info.usage         = usage;
-        image_info.samples       = VK_SAMPLE_COUNT_1_BIT;
-        image_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
-
-        if (vkCreateImage(device, &image_info, nullptr, &image) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to create image!");
-        }
-
-        VkMemoryRequirements mem_requirements;
-        vkGetImageMemoryRequirements(device, image, &mem_requirements);
-
-        VkMemoryAllocateInfo alloc_info {};
-        alloc_info.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        alloc_info.allocationSize  = mem_requirements.size;
-        alloc_info.memoryTypeIndex = findMemoryType(mem_requirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(device, &alloc_info, nullptr, &image_memory) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to allocate image memory!");
-        }
-
-        vkBindImageMemory(device, image, image_memory, 0);
+        // straight from the decoded pixels into the staging ring, both transitions go out with the copies
+        gpu->uploadImage(texture_image,
+                         VK_FORMAT_R8G8B8A8_SRGB,
+                         {static_cast<uint32_t>(tex_width), static_cast<uint32_t>(tex_height)},
+                         4,
+                         pixels);
+        stbi_image_free(pixels);
     }
+
     void VulkanBase::createDescriptorSets()
     {
-        std::vector<VkDescriptorSetLayout> layouts(swap_chain_images.size(), descriptor_set_layout);
-        VkDescriptorSetAllocateInfo        alloc_info {};
-        alloc_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        alloc_info.descriptorPool     = descriptor_pool;
-        alloc_info.descriptorSetCount = static_cast<uint32_t>(swap_chain_images.size());
-        alloc_info.pSetLayouts        = layouts.data();
-
-        descriptor_sets.resize(swap_chain_images.size());
-        if (vkAllocateDescriptorSets(device, &alloc_info, &descriptor_sets[0]) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to allocate descriptor sets!");
-        }
-        for (size_t i = 0; i < swap_chain_images.size(); i++)
+        descriptor_sets.resize(output.getImages().size());
+        for (size_t i = 0; i < output.getImages().size(); i++)
         {
-            VkDescriptorBufferInfo buffer_info {};
-            buffer_info.buffer = uniform_buffers[i];
-            buffer_info.offset = 0;
-            buffer_info.range  = sizeof(UniformBufferObject);
-            VkDescriptorImageInfo image_info{};
-            image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            image_info.imageView = texture_image_view;
-            image_info.sampler = texture_sampler;
-
-           
-            std::array<VkWriteDescriptorSet, 2> descriptor_writes{};
-
-            descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptor_writes[0].dstSet = descriptor_sets[i];
-            descriptor_writes[0].dstBinding = 0;
-            descriptor_writes[0].dstArrayElement = 0;
-            descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            descriptor_writes[0].descriptorCount = 1;
-            descriptor_writes[0].pBufferInfo = &buffer_info;
-
-            descriptor_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptor_writes[1].dstSet = descriptor_sets[i];
-            descriptor_writes[1].dstBinding = 1;
-            descriptor_writes[1].dstArrayElement = 0;
-            descriptor_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            descriptor_writes[1].descriptorCount = 1;
-            descriptor_writes[1].pImageInfo = &image_info;
-            vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptor_writes.size()), descriptor_writes.data(), 0, nullptr);
+            DescriptorBinding ubo_binding {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER};
+            ubo_binding.buffer = {uniform_buffers[i], 0, sizeof(UniformBufferObject)};
+            DescriptorBinding texture_binding {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
+            texture_binding.image = {texture_sampler, texture_image_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+            descriptor_sets[i]    = descriptor_cache.get(descriptor_set_layout, {ubo_binding, texture_binding});
         }
     }
-    void VulkanBase::createDescriptorPool()
+    void VulkanBase::createDescriptorAllocators()
     {
-        std::array<VkDescriptorPoolSize, 2> pool_sizes {};
-        pool_sizes[0].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        pool_sizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-        pool_sizes[1].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        pool_sizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-
-        VkDescriptorPoolCreateInfo pool_info;
-        pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
-        pool_info.pPoolSizes    = pool_sizes.data();
-        pool_info.maxSets       = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-
-        if (vkCreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to create descriptor pool!");
+        // every layout in the renderer draws from these types, at most one descriptor of each per set
+        std::vector<DescriptorPoolRatio> ratios = {
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f},
+        };
+        descriptor_allocator.init(device, DESCRIPTOR_SETS_PER_POOL, ratios);
+        descriptor_cache.init(device, descriptor_allocator);
+        frame_descriptors.resize(MAX_FRAMES_IN_FLIGHT);
+        for (auto& allocator : frame_descriptors)
+        {
+            allocator.init(device, DESCRIPTOR_SETS_PER_POOL, ratios);
         }
     }
 
     void VulkanBase::createUniformBuffer()
     {
         VkDeviceSize buffer_size = sizeof(UniformBufferObject);
-        uniform_buffers.resize(swap_chain_images.size());
-        uniform_buffers_memory.resize(swap_chain_images.size());
-        for (size_t i = 0; i < swap_chain_images.size(); i++)
+        uniform_buffers.resize(output.getImages().size());
+        uniform_buffers_memory.resize(output.getImages().size());
+        for (size_t i = 0; i < output.getImages().size(); i++)
         {
-            createBuffer(buffer_size,
+            gpu->createBuffer(buffer_size,
                          VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                          uniform_buffers[i],
@@ -412,200 +367,99 @@ namespace vulkanDetails
         {
             throw std::runtime_error("failed to create descriptor set layout!");
         }
+
+        // same shape, but the ubo is addressed with a dynamic offset into one buffer shared by every object
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &object_set_layout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create per-object descriptor set layout!");
+        }
     }
     void VulkanBase::createIndexBuffer()
     {
-        VkDeviceSize   buffer_size = sizeof(indices[0]) * indices.size();
-        VkBuffer       staging_buffer;
-        VkDeviceMemory staging_buffer_memory;
-        createBuffer(buffer_size,
-                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                     staging_buffer,
-                     staging_buffer_memory);
-
-        void* data;
-        vkMapMemory(device, staging_buffer_memory, 0, buffer_size, 0, &data);
-        memcpy(data, indices.data(), static_cast<size_t>(buffer_size));
-        vkUnmapMemory(device, staging_buffer_memory);
-        createBuffer(buffer_size,
+        VkDeviceSize buffer_size = sizeof(indices[0]) * indices.size();
+        gpu->createBuffer(buffer_size,
                      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                      index_buffer,
                      index_buffer_memory);
-        copyBuffer(staging_buffer, index_buffer, buffer_size);
-        vkDestroyBuffer(device, staging_buffer, nullptr);
-        vkFreeMemory(device, staging_buffer_memory, nullptr);
+        gpu->uploadBuffer(index_buffer, 0, indices.data(), buffer_size);
     }
 
     void VulkanBase::createVertexBuffer()
     {
-        VkDeviceSize   buffer_size = sizeof(vertices[0]) * vertices.size();
-        VkBuffer       staging_buffer;
-        VkDeviceMemory staging_buffer_memory;
-        createBuffer(buffer_size,
-                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                     staging_buffer,
-                     staging_buffer_memory);
-        void* data;
-        vkMapMemory(device, staging_buffer_memory, 0, buffer_size, 0, &data);
-        memcpy(data, vertices.data(), static_cast<size_t>(buffer_size));
-        vkUnmapMemory(device, staging_buffer_memory);
-        createBuffer(buffer_size,
+        VkDeviceSize buffer_size = sizeof(vertices[0]) * vertices.size();
+        gpu->createBuffer(buffer_size,
                      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                      vertex_buffer,
                      vertex_buffer_memory);
-        copyBuffer(staging_buffer, vertex_buffer, buffer_size);
-        vkDestroyBuffer(device, staging_buffer, nullptr);
-        vkFreeMemory(device, staging_buffer_memory, nullptr);
+        gpu->uploadBuffer(vertex_buffer, 0, vertices.data(), buffer_size);
     }
 
-    uint32_t VulkanBase::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+    void VulkanBase::transitionImageLayout(VkImage       image,
+                                           VkFormat      format,
+                                           VkImageLayout old_layout,
+                                           VkImageLayout new_layout)
     {
-        VkPhysicalDeviceMemoryProperties mem_properties;
-        vkGetPhysicalDeviceMemoryProperties(physical_device, &mem_properties);
-        for (uint32_t i = 0; i < mem_properties.memoryTypeCount; i++)
-        {
-            if (typeFilter & (1 << i) && (mem_properties.memoryTypes[i].propertyFlags & properties) == properties)
-            {
-                //  std::cout << "Memory type properties: " << mem_properties.memoryTypes[i].propertyFlags << std::endl;
-                return i;
-            }
-        }
-        throw std::runtime_error("failed to find suitable memory type!");
+        // several transitions should share one BarrierBatch and one command buffer instead
+        BarrierBatch barriers;
+        barriers.transitionImage(image, old_layout, new_layout, wholeImageRange(format));
+        VkCommandBuffer command_buffer = gpu->beginSingleTimeCommands();
+        barriers.flush(command_buffer);
+        gpu->endSingleTimeCommands(command_buffer);
     }
 
-    void VulkanBase::createBuffer(VkDeviceSize          size,
-                                  VkBufferUsageFlags    usage,
-                                  VkMemoryPropertyFlags properties,
-                                  VkBuffer&             buffer,
-                                  VkDeviceMemory&       buffer_memory)
+    void VulkanBase::cleanup()
     {
-        VkBufferCreateInfo buffer_info = {};
-        buffer_info.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        buffer_info.size               = size;
-        buffer_info.usage              = usage;
-        buffer_info.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
-
-        if (vkCreateBuffer(device, &buffer_info, nullptr, &buffer) != VK_SUCCESS)
+        vkDeviceWaitIdle(device);
+        frame_readback.collect(frame_counter);
+        frame_readback.cleanup(device);
+        if (options.capture.format != CaptureFormat::None)
         {
-            throw std::runtime_error("failed to create buffer!");
+            // stdout may be the capture stream
+            ReadbackStats readback_stats = frame_readback.getStats();
+            fprintf(stderr,
+                    "captured %llu frames, writer stalled %llu times\n",
+                    static_cast<unsigned long long>(readback_stats.written),
+                    static_cast<unsigned long long>(readback_stats.stalls));
         }
-
-        VkMemoryRequirements mem_requirements;
-        vkGetBufferMemoryRequirements(device, buffer, &mem_requirements);
-        VkMemoryAllocateInfo alloc_info {};
-        alloc_info.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        alloc_info.allocationSize  = mem_requirements.size;
-        alloc_info.memoryTypeIndex = findMemoryType(mem_requirements.memoryTypeBits, properties);
-        if (vkAllocateMemory(device, &alloc_info, nullptr, &buffer_memory) != VK_SUCCESS)
+        cleanupSwapChain();
+        frame_graph.cleanup();
+        vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
+        vkDestroyPipelineLayout(device, object_uniform_pipeline_layout, nullptr);
+        vkDestroyPipelineLayout(device, indirect_pipeline_layout, nullptr);
+        vkDestroyPipelineLayout(device, particle_pipeline_layout, nullptr);
+        vkDestroySampler(device, texture_sampler, nullptr);
+        vkDestroyImageView(device, texture_image_view, nullptr);
+        vkDestroyImage(device, texture_image, nullptr);
+        vkFreeMemory(device, texture_image_memory, nullptr);
+        descriptor_cache.clear();
+        descriptor_allocator.cleanup();
+        for (auto& allocator : frame_descriptors)
         {
-            throw std::runtime_error("failed to allocate buffer memory!");
+            allocator.cleanup();
         }
-        vkBindBufferMemory(device, buffer, buffer_memory, 0);
-    }
-
-    void VulkanBase::copyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size)
-    {
-        VkCommandBuffer command_buffer = beginSingleTimeCommands();
-        VkBufferCopy    copy_region {};
-        copy_region.size = size;
-        vkCmdCopyBuffer(command_buffer, src_buffer, dst_buffer, 1, &copy_region);
-        endSingleTimeCommands(command_buffer);
-    }
-
-    void VulkanBase::transitionImageLayout(VkImage image,
-                                           VkFormat /*format*/,
-                                           VkImageLayout old_layout,
-                                           VkImageLayout new_layout)
-    {
-        VkCommandBuffer      command_buffer = beginSingleTimeCommands();
-        VkImageMemoryBarrier barrier {};
-        barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.oldLayout                       = old_layout;
-        barrier.newLayout                       = new_layout;
-        barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
-        barrier.image                           = image;
-        barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseMipLevel   = 0;
-        barrier.subresourceRange.levelCount     = 1;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount     = 1;
-  
-        VkPipelineStageFlags source_stage;
-        VkPipelineStageFlags destination_stage;
-
-        if (old_layout == VK_IMAGE_LAYOUT_UNDEFINED && new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+        vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
+        vkDestroyDescriptorSetLayout(device, object_set_layout, nullptr);
+        if (gpu_culling_active)
         {
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-            source_stage      = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destination_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            gpu_culler.cleanup(device);
         }
-        else if (old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
-                 new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+        if (text_active)
         {
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-            source_stage      = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            destination_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+            text_renderer.cleanup(device);
         }
-        else
+        if (tilemap_active)
         {
-            throw std::invalid_argument("unsupported layout transition!");
+            tilemap.cleanup(device);
         }
-
-        vkCmdPipelineBarrier(command_buffer, source_stage, destination_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-        endSingleTimeCommands(command_buffer);
-    }
-
-    void VulkanBase::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
-    {
-        VkCommandBuffer command_buffer = beginSingleTimeCommands();
-
-        VkBufferImageCopy region {};
-        region.bufferOffset                    = 0;
-        region.bufferRowLength                 = 0;
-        region.bufferImageHeight               = 0;
-        region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel       = 0;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount     = 1;
-        region.imageOffset                     = {0, 0, 0};
-        region.imageExtent                     = {width, height, 1};
-
-        vkCmdCopyBufferToImage(command_buffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-        endSingleTimeCommands(command_buffer);
-    }
-    void VulkanBase::printExtensionProperties()
-    {
-        uint32_t extension_count = 0;
-        vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr);
-        std::vector<VkExtensionProperties> extensions(extension_count);
-        vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, extensions.data());
-        std::cout << "available extensions:\n";
-        for (const auto& extension : extensions)
+        if (particles_active)
         {
-            std::cout << "\t" << extension.extensionName << std::endl;
+            particles.cleanup(device);
         }
-    }
-
-    void VulkanBase::cleanup() const
-    {
-        cleanupSwapChain();
-        vkDestroySampler(device, texture_sampler, nullptr);
-        vkDestroyImageView(device, texture_image_view, nullptr);
-        vkDestroyImage(device, texture_image, nullptr);
-        vkFreeMemory(device, texture_image_memory, nullptr);
-        vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
-        vkDestroyDescriptorSetLayout(device, descriptor_set_layout, nullptr);
-        for (size_t i = 0; i < swap_chain_images.size(); i++)
+        destroyObjectUniformBuffers();
+        for (size_t i = 0; i < output.getImages().size(); i++)
         {
             vkDestroyBuffer(device, uniform_buffers[i], nullptr);
             vkFreeMemory(device, uniform_buffers_memory[i], nullptr);
@@ -614,391 +468,137 @@ namespace vulkanDetails
         vkFreeMemory(device, index_buffer_memory, nullptr);
         vkDestroyBuffer(device, vertex_buffer, nullptr);
         vkFreeMemory(device, vertex_buffer_memory, nullptr);
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-        {
-            vkDestroySemaphore(device, render_finished_semaphores[i], nullptr);
-            vkDestroySemaphore(device, image_available_semaphores[i], nullptr);
-            vkDestroyFence(device, in_flight_fences[i], nullptr);
-        }
-
+        vkDestroyQueryPool(device, timestamp_query_pool, nullptr);
         vkDestroyCommandPool(device, command_pool, nullptr);
-        if (enable_validation_layers)
-        {
-            destroyDebugUtilsMessengerExt(instance, callback, nullptr);
-        }
-
-        vkDestroyDevice(device, nullptr);
-        vkDestroySurfaceKHR(instance, surface, nullptr);
-
-        vkDestroyInstance(instance, nullptr);
-        SDL_DestroyWindow(window);
-        SDL_Quit();
+        // the device is idle by now, nothing queued has to wait any longer
+        deletion_queue.flush();
+        // the device, its pipelines and SDL belong to whoever created the GpuDevice, other outputs may still use them
+        output.cleanup(gpu->getInstance(), device);
     }
 
-    bool VulkanBase::checkValidationLayerSupport(std::vector<const char*>& validation_layers)
+    void VulkanBase::createLogicalDevice()
     {
-        uint32_t layer_count;
-        vkEnumerateInstanceLayerProperties(&layer_count, nullptr);
-        std::vector<VkLayerProperties> available_layers(layer_count);
-        vkEnumerateInstanceLayerProperties(&layer_count, available_layers.data());
-        for (const char* layer_name : validation_layers)
+        if (!gpu->deviceCreated())
         {
-            bool found_layer = false;
-            for (const auto& layer_properties : available_layers)
+            VkPhysicalDeviceFeatures supported_features;
+            vkGetPhysicalDeviceFeatures(physical_device, &supported_features);
+            VkPhysicalDeviceFeatures device_features {};
+            std::vector<const char*> extensions;
+            if (options.gpu_culling)
             {
-                if (strcmp(layer_name, layer_properties.layerName) == 0)
+                device_features.drawIndirectFirstInstance = supported_features.drawIndirectFirstInstance;
+                device_features.multiDrawIndirect         = supported_features.multiDrawIndirect;
+                if (gpu->supportsExtension(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
                 {
-                    found_layer = true;
-                    break;
+                    extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
                 }
             }
-            if (!found_layer)
-            {
-                return false;
-            }
-        }
-        return true;
-    }
-
-    VKAPI_ATTR VkBool32 VKAPI_CALL
-    VulkanBase::debugCallback([[maybe_unused]] VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-                              [[maybe_unused]] VkDebugUtilsMessageTypeFlagsEXT        messageType,
-                              const VkDebugUtilsMessengerCallbackDataEXT*             pCallbackData,
-                              [[maybe_unused]] void*                                  pUserData)
-    {
-        std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
-        return VK_FALSE;
-    }
-
-    void VulkanBase::setupDebugMessenger()
-    {
-        if (!enable_validation_layers)
-        {
-            return;
-        }
-        VkDebugUtilsMessengerCreateInfoEXT create_info {};
-        create_info.sType           = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-        create_info.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
-                                      VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
-                                      VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-        create_info.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
-                                  VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
-                                  VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-        create_info.pfnUserCallback = debugCallback;
-        create_info.pUserData       = nullptr;
-
-        if (createDebugUtilsMessengerEXT(instance, &create_info, nullptr, &callback) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to set up debug messenger!");
-        }
-    }
-
-    VkResult VulkanBase::createDebugUtilsMessengerEXT(VkInstance                                instance,
-                                                      const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo,
-                                                      const VkAllocationCallbacks*              pAllocator,
-                                                      VkDebugUtilsMessengerEXT*                 pDebugMessenger)
-    {
-        auto func = reinterpret_cast<PFN_vkCreateDebugUtilsMessengerEXT>(
-            vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT"));
-        if (func != nullptr)
-        {
-            return func(instance, pCreateInfo, pAllocator, pDebugMessenger);
-        }
-        else
-        {
-            return VK_ERROR_EXTENSION_NOT_PRESENT;
-        }
-    }
-
-    void VulkanBase::destroyDebugUtilsMessengerExt(VkInstance                   instance,
-                                                   VkDebugUtilsMessengerEXT     debugMessenger,
-                                                   const VkAllocationCallbacks* pAllocator)
-    {
-        auto func = reinterpret_cast<PFN_vkDestroyDebugUtilsMessengerEXT>(
-            vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT"));
-        if (func != nullptr)
-        {
-            func(instance, debugMessenger, pAllocator);
+            gpu->createLogicalDevice(device_features, extensions, !options.legacy_render_passes);
+            gpu->createFrameSync(MAX_FRAMES_IN_FLIGHT);
         }
-    }
-
-    bool VulkanBase::isDeviceSuitable(VkPhysicalDevice device)
-    {
-        bool swap_chain_adequate = false;
-        if (enable_validation_layers)
-        {
-            SwapChainSupportDetails swap_chain_support = querySwapChainSupport(device);
-            swap_chain_adequate = !swap_chain_support.formats.empty() && !swap_chain_support.present_modes.empty();
-        }
-        VkPhysicalDeviceProperties device_properties;
-
-        vkGetPhysicalDeviceProperties(device, &device_properties);
-        VkPhysicalDeviceFeatures device_features;
-        vkGetPhysicalDeviceFeatures(device, &device_features);
-
-        QueueFamilyIndices indices              = findQueueFamilies(device);
-        bool               extensions_supported = checkDeviceExtensionSupport(device);
-        return indices.isComplete() && extensions_supported && swap_chain_adequate;
-    }
+        device = gpu->getDevice();
 
-    QueueFamilyIndices VulkanBase::findQueueFamilies(VkPhysicalDevice device)
-    {
-        QueueFamilyIndices indices;
-        uint32_t           queue_family_count = 0;
-        VkBool32           present_support    = false;
-
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, 0, surface, &present_support);
-        vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_family_count, nullptr);
-        std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
-        vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_family_count, queue_families.data());
-        int i = 0;
-        for (const auto& queue_family : queue_families)
+        // an output joining an existing device gets by with what the first one enabled
+        const VkPhysicalDeviceFeatures& enabled_features = gpu->getEnabledFeatures();
+        if (options.gpu_culling)
         {
-            if (queue_family.queueCount > 0 && queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT)
-            {
-                indices.graphics_family = i;
-            }
-            if (queue_family.queueCount > 0 && present_support)
+            // the indirect path identifies objects through firstInstance, so it cannot run without it
+            gpu_culling_active = enabled_features.drawIndirectFirstInstance == VK_TRUE;
+            if (!gpu_culling_active)
             {
-                indices.present_family = i;
+                std::cerr << "drawIndirectFirstInstance not supported, falling back to CPU culling" << std::endl;
             }
-            if (indices.isComplete())
-            {
-                break;
-            }
-            i++;
-        }
-        return indices;
-    }
-
-    void VulkanBase::createLogicalDevice()
-    {
-        QueueFamilyIndices                   indices = findQueueFamilies(physical_device);
-        std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
-        std::set<uint32_t> unique_queue_families = {indices.graphics_family.value(), indices.present_family.value()};
-        float              queue_priority        = 1.0f;
-        for (auto queue_family : unique_queue_families)
-        {
-            VkDeviceQueueCreateInfo queue_create_info {};
-            queue_create_info.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-            queue_create_info.queueFamilyIndex = queue_family;
-            queue_create_info.queueCount       = 1;
-            queue_create_info.pQueuePriorities = &queue_priority;
-            queue_create_infos.push_back(queue_create_info);
-        }
-
-        VkPhysicalDeviceFeatures device_features {};
-        VkDeviceCreateInfo       device_create_info {};
-        
-        device_create_info.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        device_create_info.pQueueCreateInfos       = queue_create_infos.data();
-        device_create_info.queueCreateInfoCount    = static_cast<uint32_t>(queue_create_infos.size());
-        device_create_info.pEnabledFeatures        = &device_features;
-        device_create_info.enabledExtensionCount   = static_cast<uint32_t>(device_extensions.size());
-        device_create_info.ppEnabledExtensionNames = device_extensions.data();
-        // if (enable_validation_layers)
-        // {
-        //     device_create_info.enabledLayerCount   = static_cast<uint32_t>(validation_layers.size());
-        //     device_create_info.ppEnabledLayerNames = validation_layers.data();
-        // }
-        // else
-        // {
-        device_create_info.enabledLayerCount = 0;
-        //}
-
-        if (vkCreateDevice(physical_device, &device_create_info, nullptr, &device) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to create logical device!");
-        }
-
-        vkGetDeviceQueue(device, indices.graphics_family.value(), 0, &graphics_queue);
-        vkGetDeviceQueue(device, indices.present_family.value(), 0, &present_queue);
-    }
-
-    void VulkanBase::createSurface()
-    {
-
-        if (!SDL_Vulkan_CreateSurface(window, instance, &surface))
-        {
-            std::cerr << "failed to create window surface!" << std::endl;
-            throw std::runtime_error("failed to create window surface!");
         }
-    }
-
-    bool VulkanBase::checkDeviceExtensionSupport(VkPhysicalDevice device)
-    {
-        uint32_t extension_count;
-
-        vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, nullptr);
-        std::vector<VkExtensionProperties> available_extensions(extension_count);
-        vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, available_extensions.data());
-        std::set<std::string> required_extensions(device_extensions.begin(), device_extensions.end());
-        for (const auto& extension : available_extensions)
-        {
-            required_extensions.erase(extension.extensionName);
-        }
-        return required_extensions.empty();
-    }
-
-    SwapChainSupportDetails VulkanBase::querySwapChainSupport(VkPhysicalDevice device)
-    {
-        SwapChainSupportDetails details;
-        vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
-        uint32_t format_count;
-        vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &format_count, nullptr);
-        if (format_count != 0)
-        {
-            details.formats.resize(format_count);
-            vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &format_count, details.formats.data());
-        }
-
-        uint32_t present_mode_count;
-
-        vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &present_mode_count, nullptr);
-        if (present_mode_count != 0)
-        {
-            details.present_modes.resize(present_mode_count);
-            vkGetPhysicalDeviceSurfacePresentModesKHR(
-                device, surface, &present_mode_count, details.present_modes.data());
-        }
-
-        return details;
-    }
-
-    VkSurfaceFormatKHR VulkanBase::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& available_formats)
-    {
-        if (available_formats.size() == 1 && available_formats[0].format == VK_FORMAT_UNDEFINED)
+        dynamic_rendering = gpu->dynamicRenderingEnabled();
+        if (!options.legacy_render_passes && !dynamic_rendering)
         {
-            return {VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+            std::cerr << "dynamic rendering not supported, falling back to render pass objects" << std::endl;
         }
-        for (const auto& available_format : available_formats)
+        if (gpu_culling_active)
         {
-            if (available_format.format == VK_FORMAT_B8G8R8A8_UNORM &&
-                available_format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
-            {
-                return available_format;
-            }
+            multi_draw_indirect_supported = enabled_features.multiDrawIndirect == VK_TRUE;
+            draw_indirect_count_supported = gpu->extensionEnabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
         }
-        return available_formats[0];
     }
 
-    VkPresentModeKHR VulkanBase::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& available_present_modes)
+    void VulkanBase::createSwapChain()
     {
-        for (const auto& available_present_mode : available_present_modes)
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        if (options.capture.format != CaptureFormat::None)
         {
-            if (available_present_mode == VK_PRESENT_MODE_MAILBOX_KHR)
-            {
-                return available_present_mode;
-            }
+            usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
         }
-        return VK_PRESENT_MODE_FIFO_KHR;
-    }
-
-    VkExtent2D VulkanBase::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
-    {
-        if (capabilities.currentExtent.width != UINT32_MAX)
+        if (dynamic_resolution_active)
         {
-            return capabilities.currentExtent;
+            // the scaled scene is blitted in
+            usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
         }
-        else
+        if (options.headless)
         {
-            int height, width;
-            SDL_Vulkan_GetDrawableSize(window, &width, &height);
-            VkExtent2D actual_extent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
-
-            actual_extent.width  = std::max(capabilities.minImageExtent.width,
-                                           std::min(capabilities.maxImageExtent.width, actual_extent.width));
-            actual_extent.height = std::max(capabilities.minImageExtent.height,
-                                            std::min(capabilities.maxImageExtent.height, actual_extent.height));
-
-            return actual_extent;
-        }
-    }
-
-    void VulkanBase::createSwapChain()
-    {
-        SwapChainSupportDetails swap_chain_support = querySwapChainSupport(physical_device);
-        VkSurfaceFormatKHR      surface_format     = chooseSwapSurfaceFormat(swap_chain_support.formats);
-        VkPresentModeKHR        present_mode       = chooseSwapPresentMode(swap_chain_support.present_modes);
-        VkExtent2D              extent             = chooseSwapExtent(swap_chain_support.capabilities);
-        std::cout << extent.width << " " << extent.height << std::endl;
-        uint32_t image_count = swap_chain_support.capabilities.minImageCount + 1;
-        // uint32_t                image_count        = 1;
-        if (swap_chain_support.capabilities.maxImageCount > 0 &&
-            image_count > swap_chain_support.capabilities.maxImageCount)
-        {
-            image_count = swap_chain_support.capabilities.maxImageCount;
-        }
-        VkSwapchainCreateInfoKHR create_info {};
-        create_info.sType            = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-        create_info.surface          = surface;
-        create_info.minImageCount    = image_count;
-        create_info.imageColorSpace  = surface_format.colorSpace;
-        create_info.imageFormat      = surface_format.format;
-        create_info.imageExtent      = extent;
-        create_info.imageArrayLayers = 1;
-        create_info.imageUsage       = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-
-        QueueFamilyIndices indices                = findQueueFamilies(physical_device);
-        uint32_t           queue_family_indices[] = {indices.graphics_family.value(), indices.present_family.value()};
-        if (indices.graphics_family != indices.present_family)
-        {
-            create_info.imageSharingMode      = VK_SHARING_MODE_CONCURRENT;
-            create_info.queueFamilyIndexCount = 2;
-            create_info.pQueueFamilyIndices   = queue_family_indices;
+            // one image per frame in flight, a frame's slot is free once its fence was waited for
+            output.createOffscreen(*gpu, drawable_extent, usage, MAX_FRAMES_IN_FLIGHT);
+            return;
         }
-        else
+        VkImageUsageFlags supported_usage =
+            WindowSurface::querySupport(physical_device, output.getSurface()).capabilities.supportedUsageFlags;
+        if ((usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0 && (supported_usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) == 0)
         {
-            create_info.imageSharingMode      = VK_SHARING_MODE_EXCLUSIVE;
-            create_info.queueFamilyIndexCount = 0;
-            create_info.pQueueFamilyIndices   = nullptr;
+            throw std::runtime_error("swap chain images cannot be read back!");
         }
-        create_info.preTransform   = swap_chain_support.capabilities.currentTransform;
-        create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-        create_info.presentMode    = present_mode;
-        create_info.clipped        = VK_TRUE;
-        create_info.oldSwapchain   = VK_NULL_HANDLE;
-
-        if (vkCreateSwapchainKHR(device, &create_info, nullptr, &swap_chain) != VK_SUCCESS)
+        if ((usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0 && (supported_usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) == 0)
         {
-            throw std::runtime_error("failed to create swap chain!");
+            throw std::runtime_error("swap chain images cannot be blitted to!");
         }
-        vkGetSwapchainImagesKHR(device, swap_chain, &image_count, nullptr);
-        swap_chain_images.resize(image_count);
-        vkGetSwapchainImagesKHR(device, swap_chain, &image_count, swap_chain_images.data());
-        swap_chain_image_format = surface_format.format;
-        swap_chain_extent       = extent;
+        // drawable_extent is from the last frame packet, SDL may only be asked on the event thread
+        output.createSwapChain(*gpu, drawable_extent, usage);
     }
 
-    void VulkanBase::createImageViews()
+    // Frames are recorded through frame_graph, which builds its own render passes; this one only has to be
+    // compatible with them (same formats and sample counts) so the pipelines can be created up front.
+    void VulkanBase::createRenderPass()
     {
-        swap_chain_image_views.resize(swap_chain_images.size());
-        for (size_t i = 0; i < swap_chain_images.size(); i++)
+        if (dynamic_rendering)
         {
-            swap_chain_image_views[i] = createImageView(swap_chain_images[i], swap_chain_image_format);
+            // the pipelines name their attachment formats themselves, render_pass stays VK_NULL_HANDLE
+            return;
         }
-    }
+        bool multisampled = msaa_samples != VK_SAMPLE_COUNT_1_BIT;
 
-    void VulkanBase::createRenderPass()
-    {
         VkAttachmentDescription color_attachment {};
-        color_attachment.format         = swap_chain_image_format;
-        color_attachment.samples        = VK_SAMPLE_COUNT_1_BIT;
+        color_attachment.format         = output.getFormat();
+        color_attachment.samples        = msaa_samples;
         color_attachment.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        color_attachment.storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
+        // the samples only live until the resolve, so a tiler never has to write them out
+        color_attachment.storeOp        = multisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
         color_attachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         color_attachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-        color_attachment.finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        color_attachment.finalLayout =
+            multisampled ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : output.getFinalLayout();
+
+        VkAttachmentDescription resolve_attachment {};
+        resolve_attachment.format         = output.getFormat();
+        resolve_attachment.samples        = VK_SAMPLE_COUNT_1_BIT;
+        resolve_attachment.loadOp         = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        resolve_attachment.storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
+        resolve_attachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        resolve_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        resolve_attachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+        resolve_attachment.finalLayout    = output.getFinalLayout();
 
         VkAttachmentReference color_attachment_ref {};
         color_attachment_ref.attachment = 0;
         color_attachment_ref.layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+        VkAttachmentReference resolve_attachment_ref {};
+        resolve_attachment_ref.attachment = 1;
+        resolve_attachment_ref.layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
         VkSubpassDescription subpass {};
         subpass.pipelineBindPoint    = VK_PIPELINE_BIND_POINT_GRAPHICS;
         subpass.colorAttachmentCount = 1;
         subpass.pColorAttachments    = &color_attachment_ref;
+        subpass.pResolveAttachments  = multisampled ? &resolve_attachment_ref : nullptr;
 
         VkSubpassDependency dependency {};
         dependency.srcSubpass    = VK_SUBPASS_EXTERNAL;
@@ -1008,10 +608,11 @@ namespace vulkanDetails
         dependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
         dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
-        VkRenderPassCreateInfo render_pass_info {};
+        std::array<VkAttachmentDescription, 2> attachments = {color_attachment, resolve_attachment};
+        VkRenderPassCreateInfo                 render_pass_info {};
         render_pass_info.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-        render_pass_info.attachmentCount = 1;
-        render_pass_info.pAttachments    = &color_attachment;
+        render_pass_info.attachmentCount = multisampled ? 2 : 1;
+        render_pass_info.pAttachments    = attachments.data();
         render_pass_info.subpassCount    = 1;
         render_pass_info.pSubpasses      = &subpass;
         render_pass_info.dependencyCount = 1;
@@ -1023,175 +624,147 @@ namespace vulkanDetails
         }
     }
 
-    void VulkanBase::createGraphicsPipeline()
+    void VulkanBase::createPipelineLayouts()
     {
-        auto                            vertex_shader_code     = readFile("../shader/texture_vert.spv");
-        auto                            fragment_shader_code   = readFile("../shader/texture_frag.spv");
-        VkShaderModule                  vertex_shader_module   = createShaderModule(vertex_shader_code);
-        VkShaderModule                  fragment_shader_module = createShaderModule(fragment_shader_code);
-        VkPipelineShaderStageCreateInfo vertex_shader_stage_info {};
-        vertex_shader_stage_info.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        vertex_shader_stage_info.stage  = VK_SHADER_STAGE_VERTEX_BIT;
-        vertex_shader_stage_info.module = vertex_shader_module;
-        vertex_shader_stage_info.pName  = "main";
-        VkPipelineShaderStageCreateInfo fragment_shader_stage_info {};
-        fragment_shader_stage_info.sType                = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        fragment_shader_stage_info.stage                = VK_SHADER_STAGE_FRAGMENT_BIT;
-        fragment_shader_stage_info.module               = fragment_shader_module;
-        fragment_shader_stage_info.pName                = "main";
-        VkPipelineShaderStageCreateInfo shader_stages[] = {vertex_shader_stage_info, fragment_shader_stage_info};
-
-        VkPipelineVertexInputStateCreateInfo vertex_input_info {};
-        auto                                 binding_description    = Vertex::getBindingDescription();
-        auto                                 attribute_descriptions = Vertex::getAttributeDescriptions();
-        vertex_input_info.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertex_input_info.vertexBindingDescriptionCount   = 1;
-        vertex_input_info.pVertexBindingDescriptions      = &binding_description;
-        vertex_input_info.vertexAttributeDescriptionCount = static_cast<uint32_t>(attribute_descriptions.size());
-        vertex_input_info.pVertexAttributeDescriptions    = attribute_descriptions.data();
-
-        VkPipelineInputAssemblyStateCreateInfo input_assembly {};
-        input_assembly.sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        input_assembly.topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-        input_assembly.primitiveRestartEnable = VK_FALSE;
-
-        VkViewport viewport {};
-        viewport.x        = 0.0f;
-        viewport.y        = 0.0f;
-        viewport.width    = static_cast<float>(swap_chain_extent.width);
-        viewport.height   = static_cast<float>(swap_chain_extent.height);
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-        VkRect2D scissor {};
-        scissor.offset = {0, 0};
-        scissor.extent = swap_chain_extent;
-        VkPipelineViewportStateCreateInfo viewport_state {};
-        viewport_state.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        viewport_state.viewportCount = 1;
-        viewport_state.pViewports    = &viewport;
-        viewport_state.scissorCount  = 1;
-        viewport_state.pScissors     = &scissor;
-
-        VkPipelineRasterizationStateCreateInfo rasterizer {};
-        rasterizer.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        rasterizer.depthClampEnable        = VK_FALSE;
-        rasterizer.rasterizerDiscardEnable = VK_FALSE;
-        rasterizer.lineWidth               = 1.0f;
-        rasterizer.cullMode                = VK_CULL_MODE_BACK_BIT;
-        rasterizer.frontFace               = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-        rasterizer.depthBiasEnable         = VK_FALSE;
-        rasterizer.depthBiasConstantFactor = 0.0f;
-        rasterizer.depthBiasClamp          = 0.0f;
-        rasterizer.depthBiasSlopeFactor    = 0.0f;
-
-        VkPipelineMultisampleStateCreateInfo multisampling {};
-        multisampling.sType                 = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        multisampling.sampleShadingEnable   = VK_FALSE;
-        multisampling.rasterizationSamples  = VK_SAMPLE_COUNT_1_BIT;
-        multisampling.minSampleShading      = 1.0f;
-        multisampling.pSampleMask           = nullptr;
-        multisampling.alphaToCoverageEnable = VK_FALSE;
-        multisampling.alphaToOneEnable      = VK_FALSE;
-
-        VkPipelineColorBlendAttachmentState color_blend_attachment;
-        color_blend_attachment.colorWriteMask =
-            VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-        color_blend_attachment.blendEnable = VK_FALSE;
-        // color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-        // color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-        // color_blend_attachment.colorBlendOp        = VK_BLEND_OP_ADD;
-        // color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-        // color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-        // color_blend_attachment.alphaBlendOp        = VK_BLEND_OP_ADD;
-
-        VkPipelineColorBlendStateCreateInfo color_blending {};
-        color_blending.sType             = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-        color_blending.logicOpEnable     = VK_FALSE;
-        color_blending.logicOp           = VK_LOGIC_OP_COPY;
-        color_blending.attachmentCount   = 1;
-        color_blending.pAttachments      = &color_blend_attachment;
-        color_blending.blendConstants[0] = 0.0f;
-        color_blending.blendConstants[1] = 0.0f;
-        color_blending.blendConstants[2] = 0.0f;
-        color_blending.blendConstants[3] = 0.0f;
-
-        VkDynamicState dynamic_states[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_LINE_WIDTH};
-
-        VkPipelineDynamicStateCreateInfo dynamic_state {};
-        dynamic_state.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-        dynamic_state.dynamicStateCount = 2;
-        dynamic_state.pDynamicStates    = dynamic_states;
+        VkPushConstantRange push_constant_range {};
+        push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        push_constant_range.offset     = 0;
+        push_constant_range.size       = sizeof(ObjectPushConstants);
 
         VkPipelineLayoutCreateInfo pipeline_layout_info {};
         pipeline_layout_info.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipeline_layout_info.setLayoutCount         = 1;
         pipeline_layout_info.pSetLayouts            = &descriptor_set_layout;
-        pipeline_layout_info.pushConstantRangeCount = 0;
-        pipeline_layout_info.pPushConstantRanges    = nullptr;
+        pipeline_layout_info.pushConstantRangeCount = 1;
+        pipeline_layout_info.pPushConstantRanges    = &push_constant_range;
 
         if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create pipeline layout!");
         }
 
-        VkGraphicsPipelineCreateInfo pipeline_info {};
-        pipeline_info.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipeline_info.stageCount          = 2;
-        pipeline_info.pStages             = shader_stages;
-        pipeline_info.pVertexInputState   = &vertex_input_info;
-        pipeline_info.pInputAssemblyState = &input_assembly;
-        pipeline_info.pViewportState      = &viewport_state;
-        pipeline_info.pRasterizationState = &rasterizer;
-        pipeline_info.pMultisampleState   = &multisampling;
-        pipeline_info.pDepthStencilState  = nullptr;
-        pipeline_info.pColorBlendState    = &color_blending;
-        pipeline_info.pDynamicState       = nullptr;
-        pipeline_info.layout              = pipeline_layout;
-        pipeline_info.renderPass          = render_pass;
-        pipeline_info.subpass             = 0;
-        pipeline_info.basePipelineHandle  = VK_NULL_HANDLE;
-        pipeline_info.basePipelineIndex   = -1;
-
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &graphics_pipeline) !=
+        VkPipelineLayoutCreateInfo object_layout_info {};
+        object_layout_info.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        object_layout_info.setLayoutCount = 1;
+        object_layout_info.pSetLayouts    = &object_set_layout;
+        if (vkCreatePipelineLayout(device, &object_layout_info, nullptr, &object_uniform_pipeline_layout) !=
             VK_SUCCESS)
         {
-            throw std::runtime_error("failed to create graphics pipeline");
+            throw std::runtime_error("failed to create per-object pipeline layout!");
         }
 
-        vkDestroyShaderModule(device, fragment_shader_module, nullptr);
-        vkDestroyShaderModule(device, vertex_shader_module, nullptr);
-    }
-
-    void VulkanBase::createFrameBuffer()
-    {
-        swap_chain_framebuffers.resize(swap_chain_image_views.size());
-        for (size_t i = 0; i < swap_chain_image_views.size(); i++)
+        if (gpu_culling_active)
         {
-            VkImageView attachments[] = {swap_chain_image_views[i]};
-
-            VkFramebufferCreateInfo framebuffer_info {};
-            framebuffer_info.sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-            framebuffer_info.renderPass      = render_pass;
-            framebuffer_info.attachmentCount = 1;
-            framebuffer_info.pAttachments    = attachments;
-            framebuffer_info.width           = swap_chain_extent.width;
-            framebuffer_info.height          = swap_chain_extent.height;
-            framebuffer_info.layers          = 1;
+            // set 1 exposes the culler's object buffer so the vertex shader can fetch per-instance transforms
+            std::array<VkDescriptorSetLayout, 2> indirect_set_layouts = {descriptor_set_layout,
+                                                                         gpu_culler.getSetLayout()};
+            pipeline_layout_info.setLayoutCount         = static_cast<uint32_t>(indirect_set_layouts.size());
+            pipeline_layout_info.pSetLayouts            = indirect_set_layouts.data();
+            pipeline_layout_info.pushConstantRangeCount = 0;
+            pipeline_layout_info.pPushConstantRanges    = nullptr;
+            if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &indirect_pipeline_layout) !=
+                VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create indirect pipeline layout!");
+            }
+        }
 
-            if (vkCreateFramebuffer(device, &framebuffer_info, nullptr, &swap_chain_framebuffers[i]) != VK_SUCCESS)
+        if (particles_active)
+        {
+            // set 1 is the particle set, the vertex shader reads the particles straight from the step's output
+            std::array<VkDescriptorSetLayout, 2> particle_set_layouts = {descriptor_set_layout,
+                                                                         particles.getSetLayout()};
+            pipeline_layout_info.setLayoutCount         = static_cast<uint32_t>(particle_set_layouts.size());
+            pipeline_layout_info.pSetLayouts            = particle_set_layouts.data();
+            pipeline_layout_info.pushConstantRangeCount = 0;
+            pipeline_layout_info.pPushConstantRanges    = nullptr;
+            if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &particle_pipeline_layout) !=
+                VK_SUCCESS)
             {
-                throw std::runtime_error("failed to create frame buffer!");
+                throw std::runtime_error("failed to create particle pipeline layout!");
             }
         }
     }
 
-    void VulkanBase::createCommandPool()
+    GraphicsPipelineDesc VulkanBase::scenePipelineDesc(const std::string& vertex_shader_path,
+                                                       VkPipelineLayout   layout) const
     {
-        QueueFamilyIndices      queue_family_indices = findQueueFamilies(physical_device);
-        VkCommandPoolCreateInfo pool_info {};
-        pool_info.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        pool_info.queueFamilyIndex = queue_family_indices.graphics_family.value();
-        pool_info.flags            = 0;
+        auto                 attribute_descriptions = Vertex::getAttributeDescriptions();
+        GraphicsPipelineDesc desc;
+        desc.vertex_shader     = vertex_shader_path;
+        desc.fragment_shader   = "../shader/texture_frag.spv";
+        desc.layout            = layout;
+        desc.vertex_bindings   = {Vertex::getBindingDescription()};
+        desc.vertex_attributes = {attribute_descriptions.begin(), attribute_descriptions.end()};
+        desc.color_format      = output.getFormat();
+        desc.samples           = msaa_samples;
+        desc.render_pass       = render_pass;
+        return desc;
+    }
+
+    void VulkanBase::createGraphicsPipeline()
+    {
+        // per-object transforms arrive as push constants; the ubo only carries view/proj
+        GraphicsPipelineDesc push_desc = scenePipelineDesc("../shader/push_vert.spv", pipeline_layout);
+        // reads ubo.model from a dynamic offset instead, used by DrawPath::DynamicUniforms
+        GraphicsPipelineDesc object_uniform_desc =
+            scenePipelineDesc("../shader/texture_vert.spv", object_uniform_pipeline_layout);
+        GraphicsPipelineDesc indirect_desc = scenePipelineDesc("../shader/indirect_vert.spv", indirect_pipeline_layout);
+        // a quad per particle out of gl_VertexIndex and gl_InstanceIndex, no vertex input
+        GraphicsPipelineDesc particle_desc = scenePipelineDesc("../shader/particle_vert.spv", particle_pipeline_layout);
+        particle_desc.fragment_shader = "../shader/particle_frag.spv";
+        particle_desc.cull_mode       = VK_CULL_MODE_NONE;
+        particle_desc.blend           = BlendMode::Additive;
+        particle_desc.vertex_bindings.clear();
+        particle_desc.vertex_attributes.clear();
+
+        // every path can be selected at runtime, so all of them are needed before the first frame; queueing them
+        // first lets them compile side by side. after a resize these are all cache hits.
+        gpu->getPipelineRegistry().get(push_desc);
+        gpu->getPipelineRegistry().get(object_uniform_desc);
+        if (gpu_culling_active)
+        {
+            gpu->getPipelineRegistry().get(indirect_desc);
+        }
+        if (particles_active)
+        {
+            gpu->getPipelineRegistry().get(particle_desc);
+        }
+        if (tilemap_active)
+        {
+            tilemap_pipeline_desc                 = scenePipelineDesc("../shader/push_vert.spv", pipeline_layout);
+            tilemap_pipeline_desc.fragment_shader = "../shader/tilemap_frag.spv";
+            gpu->getPipelineRegistry().get(tilemap_pipeline_desc);
+        }
+        if (text_active)
+        {
+            // not waited for, text is left out of the frames drawn before it is ready
+            text_pipeline_desc = text_renderer.pipelineDesc(output.getFormat(), msaa_samples, render_pass);
+            gpu->getPipelineRegistry().get(text_pipeline_desc);
+        }
+        graphics_pipeline       = gpu->getPipelineRegistry().getBlocking(push_desc);
+        object_uniform_pipeline = gpu->getPipelineRegistry().getBlocking(object_uniform_desc);
+        if (gpu_culling_active)
+        {
+            indirect_pipeline = gpu->getPipelineRegistry().getBlocking(indirect_desc);
+        }
+        if (tilemap_active)
+        {
+            tilemap_pipeline = gpu->getPipelineRegistry().getBlocking(tilemap_pipeline_desc);
+        }
+        if (particles_active)
+        {
+            particle_pipeline = gpu->getPipelineRegistry().getBlocking(particle_desc);
+        }
+    }
+
+    void VulkanBase::createCommandPool()
+    {
+        // per output, so outputs never share a pool that would have to be locked while recording
+        VkCommandPoolCreateInfo pool_info {};
+        pool_info.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.queueFamilyIndex = gpu->getQueueFamilies().graphics_family.value();
+        pool_info.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
         if (vkCreateCommandPool(device, &pool_info, nullptr, &command_pool) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create command pool!");
@@ -1200,7 +773,8 @@ namespace vulkanDetails
 
     void VulkanBase::createCommandBuffers()
     {
-        command_buffers.resize(swap_chain_framebuffers.size());
+        // recorded every frame in recordCommandBuffer, so one per frame in flight is enough
+        command_buffers.resize(MAX_FRAMES_IN_FLIGHT);
         VkCommandBufferAllocateInfo alloc_info {};
         alloc_info.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         alloc_info.commandPool        = command_pool;
@@ -1210,101 +784,445 @@ namespace vulkanDetails
         {
             throw std::runtime_error("failed to allocate command buffers");
         }
+    }
+
+    void VulkanBase::recordCommandBuffer(VkCommandBuffer command_buffer, uint32_t image_index)
+    {
+        VkCommandBufferBeginInfo begin_info {};
+        begin_info.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        begin_info.pInheritanceInfo = nullptr;
+
+        if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to begin recording command buffer!");
+        }
+        if (timestamp_query_pool != VK_NULL_HANDLE)
+        {
+            vkCmdResetQueryPool(command_buffer, timestamp_query_pool, current_frame * 2, 2);
+            vkCmdWriteTimestamp(
+                command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestamp_query_pool, current_frame * 2);
+        }
+        buildFrameGraph(image_index);
+        frame_graph.execute(command_buffer);
+        if (timestamp_query_pool != VK_NULL_HANDLE)
+        {
+            vkCmdWriteTimestamp(
+                command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamp_query_pool, current_frame * 2 + 1);
+        }
 
-        for (size_t i = 0; i < command_buffers.size(); i++)
+        if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
         {
-            VkCommandBufferBeginInfo begin_info {};
-            begin_info.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-            begin_info.flags            = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-            begin_info.pInheritanceInfo = nullptr;
+            throw std::runtime_error("failed to record command buffer!");
+        }
+    }
 
-            if (vkBeginCommandBuffer(command_buffers[i], &begin_info) != VK_SUCCESS)
+    void VulkanBase::buildFrameGraph(uint32_t image_index)
+    {
+        VkExtent2D swap_chain_extent       = output.getExtent();
+        VkFormat   swap_chain_image_format = output.getFormat();
+        frame_graph.reset();
+        auto backbuffer = frame_graph.importImage("backbuffer",
+                                                  output.getImages()[image_index],
+                                                  output.getImageViews()[image_index],
+                                                  swap_chain_image_format,
+                                                  swap_chain_extent,
+                                                  VK_SAMPLE_COUNT_1_BIT,
+                                                  VK_IMAGE_LAYOUT_UNDEFINED,
+                                                  VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, // acquire semaphore
+                                                  output.getFinalLayout());
+        // the image the scene ends up in, before it is upscaled
+        auto scene_color = backbuffer;
+        if (dynamic_resolution_active)
+        {
+            // swapchain sized, the scene only covers render_extent of it; the shape of the frame never changes with
+            // the scale, so the graph keeps the same memory instead of reallocating
+            scene_color = frame_graph.createImage(
+                "scaled color", {swap_chain_extent.width, swap_chain_extent.height, swap_chain_image_format});
+        }
+        auto target = scene_color;
+        if (msaa_samples != VK_SAMPLE_COUNT_1_BIT)
+        {
+            // resolved within the scene pass, so the graph never stores it and can use lazily allocated memory
+            target = frame_graph.createImage("msaa color",
+                                             {swap_chain_extent.width,
+                                              swap_chain_extent.height,
+                                              swap_chain_image_format,
+                                              VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+                                              msaa_samples});
+        }
+
+        std::optional<RenderGraph::ResourceId> glyph_atlas;
+        if (text_active && text_renderer.uploadPending())
+        {
+            // only part of the frame while new glyphs are copied in, it stays shader readable otherwise
+            glyph_atlas = frame_graph.importImage("glyph atlas",
+                                                  text_renderer.getAtlasImage(),
+                                                  text_renderer.getAtlasView(),
+                                                  VK_FORMAT_R8_UNORM,
+                                                  {GlyphAtlas::SIZE, GlyphAtlas::SIZE},
+                                                  VK_SAMPLE_COUNT_1_BIT,
+                                                  text_renderer.atlasInitialized()
+                                                      ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                                                      : VK_IMAGE_LAYOUT_UNDEFINED,
+                                                  VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, // earlier frames' draws
+                                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            frame_graph.addPass(
+                "glyph upload",
+                PassType::Transfer,
+                [&](RenderGraph::PassBuilder& builder) { builder.write(*glyph_atlas, ImageAccess::TransferDst); },
+                [this](VkCommandBuffer command_buffer) { text_renderer.recordUpload(command_buffer); });
+        }
+        std::optional<RenderGraph::ResourceId> streamed;
+        if (stream_source && streaming_texture.uploadPending())
+        {
+            // the copies are recorded with the frame; between frames everything stays shader readable
+            bool                                 yuv = streaming_texture.getFormat() == StreamingFormat::Yuv420;
+            std::vector<RenderGraph::ResourceId> planes;
+            for (uint32_t i = 0; i < streaming_texture.planeCount(); i++)
             {
-                throw std::runtime_error("failed to begin recording command buffer!");
+                planes.push_back(frame_graph.importImage("stream plane " + std::to_string(i),
+                                                         streaming_texture.getPlaneImage(i),
+                                                         streaming_texture.getPlaneView(i),
+                                                         streaming_texture.getPlaneFormat(),
+                                                         streaming_texture.getPlaneExtent(i),
+                                                         VK_SAMPLE_COUNT_1_BIT,
+                                                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                         yuv ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                                                             : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
             }
-            VkRenderPassBeginInfo render_pass_info {};
-            render_pass_info.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            render_pass_info.renderPass        = render_pass;
-            render_pass_info.framebuffer       = swap_chain_framebuffers[i];
-            render_pass_info.renderArea.offset = {0, 0};
-            render_pass_info.renderArea.extent = swap_chain_extent;
-
-            VkClearValue clear_color         = {0.0f, 0.0f, 0.0f, 1.0f};
-            render_pass_info.clearValueCount = 1;
-            render_pass_info.pClearValues    = &clear_color;
-
-            vkCmdBeginRenderPass(command_buffers[i], &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
-
-            VkBuffer     vertex_buffers[] = {vertex_buffer};
-            VkDeviceSize offsets          = {0};
-            vkCmdBindVertexBuffers(command_buffers[i], 0, 1, vertex_buffers, &offsets);
-            vkCmdBindIndexBuffer(command_buffers[i], index_buffer, 0, VK_INDEX_TYPE_UINT16);
-            // vkCmdDraw(command_buffers[i], 3, 1, 0, 0);
-            vkCmdBindDescriptorSets(command_buffers[i],
+            frame_graph.addPass(
+                "stream upload",
+                PassType::Transfer,
+                [&](RenderGraph::PassBuilder& builder) {
+                    for (auto plane : planes)
+                    {
+                        builder.write(plane, ImageAccess::TransferDst);
+                    }
+                },
+                [this](VkCommandBuffer command_buffer) { streaming_texture.recordUpload(command_buffer); });
+            streamed = planes.front();
+            if (yuv)
+            {
+                streamed = frame_graph.importImage("streamed",
+                                                   streaming_texture.getImage(),
+                                                   streaming_texture.getImageView(),
+                                                   streaming_texture.getImageFormat(),
+                                                   streaming_texture.getExtent(),
+                                                   VK_SAMPLE_COUNT_1_BIT,
+                                                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+                frame_graph.addPass(
+                    "yuv convert",
+                    PassType::Compute,
+                    [&](RenderGraph::PassBuilder& builder) {
+                        for (auto plane : planes)
+                        {
+                            builder.read(plane, ImageAccess::Sampled);
+                        }
+                        builder.write(*streamed, ImageAccess::StorageWrite);
+                    },
+                    [this](VkCommandBuffer command_buffer) { streaming_texture.recordConvert(command_buffer); });
+            }
+        }
+        if (tilemap_active && tilemap.uploadPending())
+        {
+            // rebuilt chunks; the tilemap synchronizes its own buffers like the culler
+            frame_graph.addPass(
+                "tilemap upload",
+                PassType::Transfer,
+                [](RenderGraph::PassBuilder& builder) { builder.sideEffect(); },
+                [this](VkCommandBuffer command_buffer) { tilemap.recordUpload(command_buffer); });
+        }
+        if (gpu_culling_active)
+        {
+            // the culler synchronizes its own buffers, the graph only has to keep the pass in order
+            frame_graph.addPass(
+                "gpu culling",
+                PassType::Compute,
+                [](RenderGraph::PassBuilder& builder) { builder.sideEffect(); },
+                [this](VkCommandBuffer command_buffer) {
+                    gpu_culler.recordCull(
+                        command_buffer, current_frame, view_frustum, static_cast<uint32_t>(indices.size()));
+                });
+        }
+        if (particles_active)
+        {
+            // the particle buffers are outside the graph, the system orders its steps and draws itself
+            frame_graph.addPass(
+                "particles",
+                PassType::Compute,
+                [](RenderGraph::PassBuilder& builder) { builder.sideEffect(); },
+                [this](VkCommandBuffer command_buffer) { particles.recordStep(command_buffer); });
+        }
+        frame_graph.addPass(
+            "scene",
+            PassType::Graphics,
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.colorAttachment(target, VK_ATTACHMENT_LOAD_OP_CLEAR, {{0.0f, 0.0f, 0.0f, 1.0f}});
+                if (target != scene_color)
+                {
+                    builder.resolveAttachment(scene_color);
+                }
+                if (glyph_atlas)
+                {
+                    builder.read(*glyph_atlas, ImageAccess::Sampled);
+                }
+                if (streamed)
+                {
+                    builder.read(*streamed, ImageAccess::Sampled);
+                }
+            },
+            [this, image_index](VkCommandBuffer command_buffer) { recordSceneDraws(command_buffer, image_index); });
+        if (scene_color != backbuffer)
+        {
+            frame_graph.addPass(
+                "upscale",
+                PassType::Transfer,
+                [&](RenderGraph::PassBuilder& builder) {
+                    builder.read(scene_color, ImageAccess::TransferSrc);
+                    builder.write(backbuffer, ImageAccess::TransferDst);
+                },
+                [this, scene_color, image_index](VkCommandBuffer command_buffer) {
+                    VkImageBlit blit {};
+                    blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+                    blit.srcOffsets[1]  = {static_cast<int32_t>(render_extent.width),
+                                          static_cast<int32_t>(render_extent.height),
+                                          1};
+                    blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+                    blit.dstOffsets[1]  = {static_cast<int32_t>(output.getExtent().width),
+                                          static_cast<int32_t>(output.getExtent().height),
+                                          1};
+                    vkCmdBlitImage(command_buffer,
+                                   frame_graph.getImage(scene_color),
+                                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                   output.getImages()[image_index],
+                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   1,
+                                   &blit,
+                                   upscale_filter);
+                });
+        }
+        if (frame_readback.active())
+        {
+            frame_graph.addPass(
+                "readback",
+                PassType::Transfer,
+                [&](RenderGraph::PassBuilder& builder) {
+                    builder.read(backbuffer, ImageAccess::TransferSrc);
+                    // the ring buffers are outside the graph
+                    builder.sideEffect();
+                },
+                [this, image_index](VkCommandBuffer command_buffer) {
+                    frame_readback.recordCopy(command_buffer, output.getImages()[image_index], frame_counter);
+                });
+        }
+        frame_graph.compile();
+    }
+
+    void VulkanBase::recordSceneDraws(VkCommandBuffer command_buffer, uint32_t image_index)
+    {
+        VkViewport viewport {};
+        viewport.x        = 0.0f;
+        viewport.y        = 0.0f;
+        viewport.width    = static_cast<float>(render_extent.width);
+        viewport.height   = static_cast<float>(render_extent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        VkRect2D scissor {};
+        scissor.offset = {0, 0};
+        scissor.extent = render_extent;
+        vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+        vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+        if (tilemap_active && tilemap_visible)
+        {
+            // the background, everything else is drawn over it
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, tilemap_pipeline);
+            vkCmdBindDescriptorSets(command_buffer,
                                     VK_PIPELINE_BIND_POINT_GRAPHICS,
                                     pipeline_layout,
                                     0,
                                     1,
-                                    &descriptor_sets[i],
+                                    &descriptor_sets[image_index],
                                     0,
                                     nullptr);
-            vkCmdDrawIndexed(command_buffers[i], static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
-            vkCmdEndRenderPass(command_buffers[i]);
+            tilemap.recordDraw(command_buffer, pipeline_layout);
+        }
 
-            if (vkEndCommandBuffer(command_buffers[i]) != VK_SUCCESS)
+        VkBuffer     vertex_buffers[] = {vertex_buffer};
+        VkDeviceSize offsets          = {0};
+        vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, &offsets);
+        vkCmdBindIndexBuffer(command_buffer, index_buffer, 0, VK_INDEX_TYPE_UINT16);
+        if (gpu_culling_active)
+        {
+            std::array<VkDescriptorSet, 2> sets = {descriptor_sets[image_index],
+                                                   gpu_culler.getDescriptorSet(current_frame)};
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, indirect_pipeline);
+            vkCmdBindDescriptorSets(command_buffer,
+                                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                    indirect_pipeline_layout,
+                                    0,
+                                    static_cast<uint32_t>(sets.size()),
+                                    sets.data(),
+                                    0,
+                                    nullptr);
+            gpu_culler.recordDraws(command_buffer, current_frame);
+        }
+        else if (draw_path == DrawPath::PushConstants)
+        {
+            VkDescriptorSet scene_set = descriptor_sets[image_index];
+            if (stream_source)
+            {
+                // the objects show the streamed texture, so its uploads are sampled like a video frame would be
+                DescriptorBinding ubo_binding {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER};
+                ubo_binding.buffer = {uniform_buffers[image_index], 0, sizeof(UniformBufferObject)};
+                DescriptorBinding texture_binding {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
+                texture_binding.image = {texture_sampler, sceneTextureView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+                scene_set             = frame_descriptors[current_frame].allocate(descriptor_set_layout);
+                writeDescriptorSet(device, scene_set, {ubo_binding, texture_binding});
+            }
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
+            vkCmdBindDescriptorSets(
+                command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1, &scene_set, 0, nullptr);
+            // only objects that survived cullObjects are submitted
+            const auto&         transforms = frame_packet->world_transforms;
+            ObjectPushConstants push {glm::mat4(1.0f), glm::vec4(1.0f)};
+            for (uint32_t slot : visible_objects)
             {
-                throw std::runtime_error("failed to record command buffer!");
+                push.model = transforms[slot];
+                vkCmdPushConstants(
+                    command_buffer, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push), &push);
+                vkCmdDrawIndexed(command_buffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
             }
         }
-    }
-
-    VkShaderModule VulkanBase::createShaderModule(const std::vector<char>& code)
-    {
-        VkShaderModuleCreateInfo create_info {};
-        create_info.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        create_info.codeSize = code.size();
-        create_info.pCode    = reinterpret_cast<const uint32_t*>(code.data());
-        VkShaderModule shader_module;
-
-        if (vkCreateShaderModule(device, &create_info, nullptr, &shader_module) != VK_SUCCESS)
+        else
         {
-            throw std::runtime_error("failed to create shader module!");
+            if (visible_objects.size() > object_uniform_capacity)
+            {
+                // grown by doubling; the old buffers are retired with this frame's tag, so slots still in flight
+                // keep reading theirs until their fence is waited on
+                uint32_t capacity =
+                    std::max(object_uniform_capacity * 2, static_cast<uint32_t>(visible_objects.size()));
+                destroyObjectUniformBuffers();
+                createObjectUniformBuffers(capacity);
+            }
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, object_uniform_pipeline);
+            // range covers a single object; the dynamic offset picks which one
+            DescriptorBinding ubo_binding {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC};
+            ubo_binding.buffer = {object_uniform_buffers[current_frame], 0, sizeof(UniformBufferObject)};
+            DescriptorBinding texture_binding {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
+            texture_binding.image = {texture_sampler, sceneTextureView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+            // lives until this slot's fence is waited on again, see drawFrame
+            VkDescriptorSet object_set = frame_descriptors[current_frame].allocate(object_set_layout);
+            writeDescriptorSet(device, object_set, {ubo_binding, texture_binding});
+            const auto&         transforms = frame_packet->world_transforms;
+            auto*               mapped     = static_cast<char*>(object_uniform_buffers_mapped[current_frame]);
+            UniformBufferObject object_ubo = frame_ubo;
+            for (uint32_t i = 0; i < visible_objects.size(); i++)
+            {
+                // one descriptor set for every object, only the offset into the packed buffer changes
+                auto dynamic_offset = static_cast<uint32_t>(i * object_uniform_stride);
+                object_ubo.model    = transforms[visible_objects[i]];
+                memcpy(mapped + dynamic_offset, &object_ubo, sizeof(object_ubo));
+                vkCmdBindDescriptorSets(command_buffer,
+                                        VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                        object_uniform_pipeline_layout,
+                                        0,
+                                        1,
+                                        &object_set,
+                                        1,
+                                        &dynamic_offset);
+                vkCmdDrawIndexed(command_buffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+            }
         }
-        return shader_module;
-    }
-
-    void VulkanBase::createSyncObject()
-    {
-        image_available_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        render_finished_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        in_flight_fences.resize(MAX_FRAMES_IN_FLIGHT);
-
-        VkSemaphoreCreateInfo semaphore_info {};
-        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-        VkFenceCreateInfo fence_info {};
-        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        if (particles_active)
         {
-            if (vkCreateSemaphore(device, &semaphore_info, nullptr, &image_available_semaphores[i]) != VK_SUCCESS ||
-                vkCreateSemaphore(device, &semaphore_info, nullptr, &render_finished_semaphores[i]) != VK_SUCCESS ||
-                vkCreateFence(device, &fence_info, nullptr, &in_flight_fences[i]) != VK_SUCCESS)
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, particle_pipeline);
+            vkCmdBindDescriptorSets(command_buffer,
+                                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                    particle_pipeline_layout,
+                                    0,
+                                    1,
+                                    &descriptor_sets[image_index],
+                                    0,
+                                    nullptr);
+            particles.recordDraw(command_buffer, particle_pipeline_layout);
+        }
+        if (text_active)
+        {
+            // on top of the scene, skipped while the pipeline is still compiling
+            VkPipeline text_pipeline = gpu->getPipelineRegistry().get(text_pipeline_desc);
+            if (text_pipeline != VK_NULL_HANDLE)
             {
-                throw std::runtime_error("failed to create semaphores!");
+                text_renderer.recordDraw(command_buffer, text_pipeline, output.getExtent());
             }
         }
     }
 
+    void VulkanBase::createSyncObject()
+    {
+        // the frame fences are the device's, shared by every output
+        output.createSyncObjects(device, MAX_FRAMES_IN_FLIGHT);
+        submitted_frames.assign(MAX_FRAMES_IN_FLIGHT, 0);
+    }
+
     void VulkanBase::mainLoop()
     {
+        // SDL wants its events handled on the thread that created the window, so this thread keeps input and the
+        // scene while everything that may block on the GPU or the compositor moves to the render thread
+        std::atomic<bool>  running         = true;
+        std::exception_ptr render_error;
+        uint64_t           sequence        = 0;
+        uint64_t           resize_sequence = 0;
+        bool               minimized       = false;
+        bool               dirty           = true;
+        packet_consumed_event              = SDL_RegisterEvents(1);
+        frame_limiter.setTargetFps(options.max_fps);
+        std::thread render_thread([this, &running, &render_error] {
+            try
+            {
+                renderLoop(running);
+            }
+            catch (...)
+            {
+                render_error = std::current_exception();
+                running.store(false, std::memory_order_release);
+                notifyPacketConsumed(); // the event thread may be asleep in SDL_WaitEvent
+            }
+        });
+
         SDL_Event e;
         bool      quit = false;
-        while (!quit)
-        {
-            while (SDL_PollEvent(&e))
+        while (!quit && running.load(std::memory_order_acquire))
+        {
+            // one packet ahead of the renderer: the next frame is simulated while the current one is drawn
+            bool renderer_waiting = consumed_sequence.load(std::memory_order_acquire) >= sequence;
+            // with on-demand redraw an unchanged scene is not drawn again, only the next simulation step changes it
+            bool idle = renderer_waiting && options.on_demand_redraw && !dirty;
+            bool has_event;
+            if (minimized || (idle && simulation_paused))
+            {
+                // nothing will change until the user does something
+                has_event = SDL_WaitEvent(&e) != 0;
+            }
+            else if (idle)
+            {
+                auto timeout = static_cast<int>(std::ceil(simulation_clock.untilNextStep() * 1000.0));
+                has_event    = SDL_WaitEventTimeout(&e, std::max(timeout, 1)) != 0;
+            }
+            else if (renderer_waiting)
+            {
+                has_event = SDL_PollEvent(&e) != 0;
+            }
+            else
+            {
+                // woken by input or by the renderer picking up the packet
+                has_event = SDL_WaitEvent(&e) != 0;
+            }
+            for (; has_event; has_event = SDL_PollEvent(&e) != 0)
             {
                 switch (e.type)
                 {
@@ -1312,48 +1230,979 @@ namespace vulkanDetails
                         quit = true;
                         break;
                     case SDL_WINDOWEVENT:
-                        if (e.window.event == SDL_WINDOWEVENT_RESIZED)
+                        switch (e.window.event)
+                        {
+                            case SDL_WINDOWEVENT_RESIZED:
+                            case SDL_WINDOWEVENT_SIZE_CHANGED:
+                                resize_sequence = sequence + 1;
+                                dirty           = true;
+                                break;
+                            case SDL_WINDOWEVENT_MINIMIZED:
+                            case SDL_WINDOWEVENT_HIDDEN:
+                                minimized = true;
+                                break;
+                            case SDL_WINDOWEVENT_RESTORED:
+                            case SDL_WINDOWEVENT_SHOWN:
+                            case SDL_WINDOWEVENT_EXPOSED:
+                                minimized = false;
+                                dirty     = true;
+                                break;
+                            default:
+                                break;
+                        }
+                        break;
+                    case SDL_KEYDOWN:
+                        if (e.key.keysym.sym == SDLK_SPACE)
                         {
-                            framebufferResizeCallback();
+                            simulation_paused = !simulation_paused;
+                            dirty             = true;
                         }
                         break;
                     default:
                         break;
                 }
             }
-            drawFrame();
+            if (minimized || consumed_sequence.load(std::memory_order_acquire) < sequence)
+            {
+                continue;
+            }
+            if (advanceSimulation() > 0 || !options.on_demand_redraw)
+            {
+                dirty = true;
+            }
+            if (!dirty)
+            {
+                continue;
+            }
+            FramePacket& packet = frame_packets.writeBuffer();
+            simulate(packet);
+            packet.sequence        = ++sequence;
+            packet.resize_sequence = resize_sequence;
+            frame_packets.publish();
+            published_sequence.store(sequence, std::memory_order_release);
+            published_sequence.notify_one();
+            dirty = false;
+        }
+        running.store(false, std::memory_order_release);
+        published_sequence.fetch_add(1, std::memory_order_release);
+        published_sequence.notify_one();
+        render_thread.join();
+        if (render_error)
+        {
+            std::rethrow_exception(render_error);
+        }
+    }
+
+    void VulkanBase::renderLoop(const std::atomic<bool>& running)
+    {
+        uint64_t handled_resize = 0;
+        uint64_t seen           = 0;
+        while (true)
+        {
+            // sleeps until the event thread publishes, so an idle or minimized window costs nothing here
+            published_sequence.wait(seen, std::memory_order_acquire);
+            seen = published_sequence.load(std::memory_order_acquire);
+            if (!running.load(std::memory_order_acquire))
+            {
+                break;
+            }
+            frame_packets.acquire();
+            const FramePacket& packet = frame_packets.readBuffer();
+            consumed_sequence.store(packet.sequence, std::memory_order_release);
+            notifyPacketConsumed();
+            if (packet.resize_sequence > handled_resize)
+            {
+                handled_resize = packet.resize_sequence;
+                framebufferResizeCallback();
+            }
+            if (packet.drawable_extent.width == 0 || packet.drawable_extent.height == 0)
+            {
+                continue;
+            }
+            renderFrame(packet);
+            frame_limiter.wait();
+        }
+        vkDeviceWaitIdle(device);
+    }
+
+    void VulkanBase::notifyPacketConsumed() const
+    {
+        // SDL_PushEvent is safe from any thread and wakes SDL_WaitEvent on the event thread
+        SDL_Event event {};
+        event.type = packet_consumed_event;
+        SDL_PushEvent(&event);
+    }
+
+    SimulationState SimulationState::interpolate(const SimulationState& from, const SimulationState& to, float alpha)
+    {
+        return {from.quad_angle + (to.quad_angle - from.quad_angle) * alpha};
+    }
+
+    void VulkanBase::stepSimulation(SimulationState& state, float step_seconds)
+    {
+        state.quad_angle += step_seconds * glm::radians(90.0f);
+    }
+
+    uint32_t VulkanBase::advanceSimulation()
+    {
+        auto now = std::chrono::high_resolution_clock::now();
+        if (!simulation_started)
+        {
+            simulation_started = true;
+            last_advance       = now;
+        }
+        double elapsed = std::chrono::duration<double>(now - last_advance).count();
+        last_advance   = now;
+        if (simulation_paused)
+        {
+            // time spent paused is dropped, the scene resumes where it stopped
+            return 0;
+        }
+        uint32_t steps = simulation_clock.advance(elapsed);
+        for (uint32_t i = 0; i < steps; i++)
+        {
+            previous_state = current_state;
+            stepSimulation(current_state, static_cast<float>(simulation_clock.step()));
+        }
+        // keeps the angle small enough for float precision, both states move so interpolation is unaffected
+        const float two_pi = glm::radians(360.0f);
+        if (previous_state.quad_angle >= two_pi)
+        {
+            previous_state.quad_angle -= two_pi;
+            current_state.quad_angle -= two_pi;
+        }
+        return steps;
+    }
+
+    void VulkanBase::simulate(FramePacket& packet)
+    {
+        // what is shown lies between the last two steps; fixed_time pins it for reproducible frames
+        SimulationState shown = SimulationState::interpolate(previous_state, current_state, simulation_clock.alpha());
+        float           time  = static_cast<float>(simulation_clock.time());
+        if (fixed_time)
+        {
+            time  = *fixed_time;
+            shown = {time * glm::radians(90.0f)};
+        }
+        scene.setLocalTransform(quad_node, glm::rotate(glm::mat4(1.0f), shown.quad_angle, glm::vec3(0.0f, 0.0f, 1.0f)));
+        scene.update(&gpu->getWorkerPool());
+
+        packet.time = time;
+        if (output.getWindow() != nullptr)
+        {
+            int width, height;
+            SDL_Vulkan_GetDrawableSize(output.getWindow(), &width, &height);
+            packet.drawable_extent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+        }
+        else
+        {
+            // headless, the offscreen images never change size
+            packet.drawable_extent = drawable_extent;
         }
+        packet.quad_slot       = scene.slotOf(quad_node);
+        // copy assignment keeps the capacity of the buffer's previous contents, so this does not allocate
+        packet.world_transforms = scene.worldTransforms();
+        packet.local_bounds     = scene.localBounds();
+        packet.world_bounds     = scene.worldBounds();
     }
+
     void VulkanBase::updateUniformBuffer(uint32_t current_image)
     {
-        static auto start_time   = std::chrono::high_resolution_clock::now();
-        auto        current_time = std::chrono::high_resolution_clock::now();
-        float time = std::chrono::duration<float, std::chrono::seconds::period>(current_time - start_time).count();
         UniformBufferObject ubo {};
-        ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        ubo.model = frame_packet->world_transforms[frame_packet->quad_slot];
         ubo.view  = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.proj =
-            glm::perspective(glm::radians(45.0f),
-                             static_cast<float>(swap_chain_extent.width) / static_cast<float>(swap_chain_extent.height),
-                             0.1f,
-                             10.0f);
+        VkExtent2D extent = output.getExtent();
+        ubo.proj          = glm::perspective(
+            glm::radians(45.0f), static_cast<float>(extent.width) / static_cast<float>(extent.height), 0.1f, 10.0f);
         ubo.proj[1][1] *= -1;
+
+        if (gpu_culling_active)
+        {
+            uploadSceneObjects();
+        }
+        cullObjects(ubo.proj * ubo.view);
+        frame_ubo = ubo;
+
         void* data;
         vkMapMemory(device, uniform_buffers_memory[current_image], 0, sizeof(ubo), 0, &data);
         memcpy(data, &ubo, sizeof(ubo));
         vkUnmapMemory(device, uniform_buffers_memory[current_image]);
     }
 
+    void VulkanBase::cullObjects(const glm::mat4& view_proj)
+    {
+        view_frustum = Frustum::fromMatrix(view_proj);
+        if (!gpu_culling_active)
+        {
+            frustum_culler.cull(view_frustum, frame_packet->world_bounds, visible_objects, &gpu->getWorkerPool());
+        }
+    }
+
+    void VulkanBase::initScene()
+    {
+        // the quad spans [-0.5, 0.5]^2 in model space, so its bounding sphere is centered at the origin
+        quad_node = scene.addNode(
+            SceneGraph::NO_PARENT, glm::mat4(1.0f), glm::vec4(0.0f, 0.0f, 0.0f, glm::length(glm::vec2(0.5f))));
+        scene.update(&gpu->getWorkerPool());
+
+        draw_path = options.draw_path;
+        if (draw_path == DrawPath::DynamicUniforms)
+        {
+            createObjectUniformBuffers(MAX_UNIFORM_OBJECTS);
+        }
+    }
+
+    void VulkanBase::buildGridScene(uint32_t object_count)
+    {
+        // a square grid of small quads covering the [-1, 1]^2 area the camera looks at
+        auto  side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(object_count))));
+        float cell = 2.0f / static_cast<float>(side);
+        scene.clear();
+        scene.reserve(object_count);
+        for (uint32_t i = 0; i < object_count; i++)
+        {
+            glm::vec3 position {-1.0f + (static_cast<float>(i % side) + 0.5f) * cell,
+                                -1.0f + (static_cast<float>(i / side) + 0.5f) * cell,
+                                0.0f};
+            glm::mat4 local = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(cell * 0.8f));
+            scene.addNode(SceneGraph::NO_PARENT, local, glm::vec4(0.0f, 0.0f, 0.0f, glm::length(glm::vec2(0.5f))));
+        }
+        quad_node = 0;
+        scene.update(&gpu->getWorkerPool());
+    }
+
+    void VulkanBase::buildStackedScene(uint32_t layer_count)
+    {
+        // quads large enough to cover the whole view, drawn on top of each other: every pixel is shaded layer_count
+        // times
+        scene.clear();
+        scene.reserve(layer_count);
+        for (uint32_t i = 0; i < layer_count; i++)
+        {
+            glm::mat4 local = glm::scale(glm::mat4(1.0f), glm::vec3(8.0f));
+            scene.addNode(SceneGraph::NO_PARENT, local, glm::vec4(0.0f, 0.0f, 0.0f, glm::length(glm::vec2(4.0f))));
+        }
+        quad_node = 0;
+        scene.update(&gpu->getWorkerPool());
+    }
+
+    void VulkanBase::createObjectUniformBuffers(uint32_t object_count)
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physical_device, &properties);
+        VkDeviceSize alignment  = properties.limits.minUniformBufferOffsetAlignment;
+        object_uniform_stride   = (sizeof(UniformBufferObject) + alignment - 1) & ~(alignment - 1);
+        object_uniform_capacity = object_count;
+
+        object_uniform_buffers.resize(MAX_FRAMES_IN_FLIGHT);
+        object_uniform_buffers_memory.resize(MAX_FRAMES_IN_FLIGHT);
+        object_uniform_buffers_mapped.resize(MAX_FRAMES_IN_FLIGHT);
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        {
+            gpu->createBuffer(object_uniform_stride * object_count,
+                         VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         object_uniform_buffers[i],
+                         object_uniform_buffers_memory[i]);
+            vkMapMemory(
+                device, object_uniform_buffers_memory[i], 0, VK_WHOLE_SIZE, 0, &object_uniform_buffers_mapped[i]);
+        }
+    }
+
+    void VulkanBase::destroyObjectUniformBuffers()
+    {
+        // frames in flight may still read them, so they are only released once those have finished
+        for (size_t i = 0; i < object_uniform_buffers.size(); i++)
+        {
+            deletion_queue.destroyBuffer(object_uniform_buffers[i]);
+            deletion_queue.freeMemory(object_uniform_buffers_memory[i]);
+        }
+        object_uniform_buffers.clear();
+        object_uniform_buffers_memory.clear();
+        object_uniform_buffers_mapped.clear();
+    }
+
+    FrameTiming VulkanBase::measureFrames(uint32_t warmup_frames, uint32_t measured_frames)
+    {
+        for (uint32_t frame = 0; frame < warmup_frames; frame++)
+        {
+            SDL_PumpEvents();
+            drawFrame();
+        }
+        FrameTiming timing {};
+        auto        start = std::chrono::high_resolution_clock::now();
+        for (uint32_t frame = 0; frame < measured_frames; frame++)
+        {
+            SDL_PumpEvents();
+            drawFrame();
+            timing.record_ms += last_record_ms;
+            timing.gpu_ms += last_gpu_ms;
+        }
+        vkDeviceWaitIdle(device);
+        timing.frame_ms =
+            std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        timing.record_ms /= measured_frames;
+        timing.gpu_ms /= measured_frames;
+        timing.frame_ms /= measured_frames;
+        return timing;
+    }
+
+    void VulkanBase::runDrawBenchmark()
+    {
+        constexpr uint32_t      WARMUP_FRAMES   = 16;
+        constexpr uint32_t      MEASURED_FRAMES = 128;
+        std::array<uint32_t, 2> draw_counts     = {10000, 100000};
+
+        // the comparison is about per-draw data on the CPU-recorded path, so the compute culler stays out of it
+        gpu_culling_active = false;
+        if (object_uniform_capacity < draw_counts.back())
+        {
+            destroyObjectUniformBuffers();
+            createObjectUniformBuffers(draw_counts.back());
+        }
+        printf("%-8s %-16s %9s %9s %10s\n", "draws", "path", "record ms", "gpu ms", "frame ms");
+        for (uint32_t draw_count : draw_counts)
+        {
+            buildGridScene(draw_count);
+            for (DrawPath path : {DrawPath::PushConstants, DrawPath::DynamicUniforms})
+            {
+                draw_path          = path;
+                FrameTiming timing = measureFrames(WARMUP_FRAMES, MEASURED_FRAMES);
+                printf("%-8u %-16s %9.3f %9.3f %10.3f\n",
+                       draw_count,
+                       path == DrawPath::PushConstants ? "push constants" : "dynamic uniforms",
+                       timing.record_ms,
+                       timing.gpu_ms,
+                       timing.frame_ms);
+            }
+        }
+        draw_path = options.draw_path;
+    }
+
+    void VulkanBase::runMsaaBenchmark()
+    {
+        constexpr uint32_t WARMUP_FRAMES   = 16;
+        constexpr uint32_t MEASURED_FRAMES = 128;
+        constexpr uint32_t OBJECT_COUNT    = 1000;
+
+        gpu_culling_active = false;
+        buildGridScene(OBJECT_COUNT);
+        printf("%-8s %9s %9s %10s\n", "samples", "record ms", "gpu ms", "frame ms");
+        for (uint32_t samples : {1u, 2u, 4u, 8u})
+        {
+            if (chooseMsaaSamples(samples) != static_cast<VkSampleCountFlagBits>(samples))
+            {
+                printf("%-8u unsupported\n", samples);
+                continue;
+            }
+            setMsaaSamples(samples);
+            FrameTiming timing = measureFrames(WARMUP_FRAMES, MEASURED_FRAMES);
+            printf("%-8u %9.3f %9.3f %10.3f\n", samples, timing.record_ms, timing.gpu_ms, timing.frame_ms);
+        }
+        setMsaaSamples(options.msaa_samples);
+
+        PipelineRegistryStats pipeline_stats = gpu->getPipelineRegistry().getStats();
+        printf("pipelines: %llu hits, %llu misses, %u compiled in %.3f ms (max %.3f ms)\n",
+               static_cast<unsigned long long>(pipeline_stats.hits),
+               static_cast<unsigned long long>(pipeline_stats.misses),
+               pipeline_stats.compiled,
+               pipeline_stats.compile_ms,
+               pipeline_stats.max_compile_ms);
+    }
+
+    bool VulkanBase::runRegressionSuite()
+    {
+        constexpr uint32_t WARMUP_FRAMES         = 16;
+        constexpr uint32_t MEASURED_FRAMES       = 64;
+        constexpr uint32_t PIXEL_TOLERANCE       = 2; // per channel, absorbs rounding differences between drivers
+        constexpr double   MAX_DIFFERING_RATIO   = 0.001;
+        constexpr double   MAX_TIME_REGRESSION   = 1.25; // measured / baseline
+        constexpr double   MAX_MEMORY_REGRESSION = 1.25;
+
+        struct RegressionScene
+        {
+            const char* name;
+            uint32_t    object_count;
+            bool        stacked;
+            bool        tilemap; // the textured tile map under the objects, when options.tilemap brought it up
+        };
+        std::array<RegressionScene, 4> scenes = {{
+            {"quad", 1, false, false},
+            {"sprites", 10000, false, false},
+            {"overdraw", 64, true, false},
+            {"textured", 10000, false, true},
+        }};
+
+        // the compute culler and the wall clock would make every run render something slightly different
+        gpu_culling_active = false;
+        fixed_time         = 0.0f;
+        if (draw_path == DrawPath::DynamicUniforms && object_uniform_capacity < 10000)
+        {
+            destroyObjectUniformBuffers();
+            createObjectUniformBuffers(10000);
+        }
+
+        RgbaImage captured;
+        frame_readback.setSink([&captured](uint64_t, const uint8_t* pixels, VkExtent2D extent) {
+            captured.width  = extent.width;
+            captured.height = extent.height;
+            captured.pixels.assign(pixels, pixels + static_cast<size_t>(extent.width) * extent.height * 4);
+        });
+        frame_readback.setPaused(true);
+
+        std::filesystem::path         directory(options.regression_dir);
+        std::map<std::string, double> baseline = loadBaseline((directory / "baseline.txt").string());
+        std::map<std::string, double> measured;
+        bool                          passed   = true;
+        auto check_metric = [&](const std::string& metric, double value, double max_ratio) {
+            measured[metric] = value;
+            auto found       = baseline.find(metric);
+            if (options.regression_update)
+            {
+                printf("%-24s %10.3f\n", metric.c_str(), value);
+                return;
+            }
+            if (found == baseline.end() || found->second <= 0.0)
+            {
+                // a metric that is not in the baseline is never checked, so that is a failure of its own
+                printf("%-24s %10.3f no baseline, run with --regress-update\n", metric.c_str(), value);
+                passed = false;
+                return;
+            }
+            bool ok = value <= found->second * max_ratio;
+            printf("%-24s %10.3f baseline %10.3f %s\n", metric.c_str(), value, found->second, ok ? "ok" : "REGRESSED");
+            passed = passed && ok;
+        };
+        check_metric("startup_ms", startup_ms, MAX_TIME_REGRESSION);
+
+        if (options.regression_update)
+        {
+            std::filesystem::create_directories(directory);
+        }
+        for (const auto& regression_scene : scenes)
+        {
+            std::string name = regression_scene.name;
+            tilemap_visible  = regression_scene.tilemap;
+            if (regression_scene.stacked)
+            {
+                buildStackedScene(regression_scene.object_count);
+            }
+            else
+            {
+                buildGridScene(regression_scene.object_count);
+            }
+            FrameTiming timing = measureFrames(WARMUP_FRAMES, MEASURED_FRAMES);
+
+            // one more frame with the copy, drawn until an acquire actually succeeds
+            frame_readback.setPaused(false);
+            uint64_t captured_before = frame_readback.getStats().captured;
+            while (frame_readback.getStats().captured == captured_before)
+            {
+                SDL_PumpEvents();
+                drawFrame();
+            }
+            frame_readback.setPaused(true);
+            vkDeviceWaitIdle(device);
+            frame_readback.collect(frame_counter);
+            frame_readback.waitIdle();
+
+            std::string reference_path = (directory / (name + ".png")).string();
+            RgbaImage   reference;
+            if (options.regression_update)
+            {
+                savePng(reference_path, captured);
+                printf("%-24s reference written\n", name.c_str());
+            }
+            else if (!loadPng(reference_path, reference))
+            {
+                printf("%-24s missing %s\n", name.c_str(), reference_path.c_str());
+                passed = false;
+            }
+            else
+            {
+                ImageComparison comparison = compareImages(captured, reference, PIXEL_TOLERANCE);
+                bool            ok = comparison.same_size && comparison.differing_ratio <= MAX_DIFFERING_RATIO;
+                printf("%-24s %10llu pixels differ, max %u %s\n",
+                       name.c_str(),
+                       static_cast<unsigned long long>(comparison.differing_pixels),
+                       comparison.max_difference,
+                       ok ? "ok" : "MISMATCH");
+                if (!ok)
+                {
+                    // next to the reference, for a side-by-side look
+                    savePng((directory / (name + ".actual.png")).string(), captured);
+                }
+                passed = passed && ok;
+            }
+            check_metric(name + ".frame_ms", timing.frame_ms, MAX_TIME_REGRESSION);
+        }
+        check_metric("peak_memory_mb", peakResidentMegabytes(), MAX_MEMORY_REGRESSION);
+
+        if (options.regression_update)
+        {
+            saveBaseline((directory / "baseline.txt").string(), measured);
+        }
+        fixed_time.reset();
+        draw_path       = options.draw_path;
+        tilemap_visible = true;
+        printf("regression suite %s\n", passed ? "passed" : "FAILED");
+        return passed;
+    }
+
+    void VulkanBase::runStreamingBenchmark()
+    {
+        constexpr uint32_t   WARMUP_FRAMES   = 16;
+        constexpr uint32_t   MEASURED_FRAMES = 128;
+        constexpr VkExtent2D VIDEO_EXTENT    = {3840, 2160};
+        constexpr uint32_t   RECT_SIZE       = 256;
+
+        struct StreamingCase
+        {
+            const char*     name;
+            StreamingFormat format;
+            uint32_t        rect_count; // 0 updates the whole texture
+            bool            locked;     // written in place through lock() instead of update()
+        };
+        std::array<StreamingCase, 4> cases = {{
+            {"rgba update", StreamingFormat::Rgba8, 0, false},
+            {"rgba lock", StreamingFormat::Rgba8, 0, true},
+            {"yuv420 update", StreamingFormat::Yuv420, 0, false},
+            {"rgba 32 rects", StreamingFormat::Rgba8, 32, false},
+        }};
+
+        gpu_culling_active = false;
+        buildGridScene(1);
+        // stands in for a decoder's output, the same frame every time: what the copies cost does not depend on it
+        size_t               pitch = static_cast<size_t>(VIDEO_EXTENT.width) * 4;
+        std::vector<uint8_t> source(pitch * VIDEO_EXTENT.height);
+        for (size_t i = 0; i < source.size(); i++)
+        {
+            source[i] = static_cast<uint8_t>(i * 7 + i / pitch);
+        }
+
+        printf("%-16s %9s %9s %9s %10s %9s %9s\n",
+               "case",
+               "MB/frame",
+               "record ms",
+               "gpu ms",
+               "frame ms",
+               "MB/s",
+               "overflows");
+        for (const auto& streaming_case : cases)
+        {
+            streaming_texture.init(
+                *gpu, device, VIDEO_EXTENT, streaming_case.format, texture_sampler, MAX_FRAMES_IN_FLIGHT);
+            stream_source = [&](StreamingTexture& texture) {
+                uint32_t width  = VIDEO_EXTENT.width;
+                uint32_t height = VIDEO_EXTENT.height;
+                if (streaming_case.format == StreamingFormat::Yuv420)
+                {
+                    // I420 planes carved out of the source frame
+                    const uint8_t* y_plane = source.data();
+                    const uint8_t* u_plane = y_plane + static_cast<size_t>(width) * height;
+                    const uint8_t* v_plane = u_plane + static_cast<size_t>(width / 2) * (height / 2);
+                    texture.updateYuv(y_plane, width, u_plane, width / 2, v_plane, width / 2);
+                }
+                else if (streaming_case.locked)
+                {
+                    StreamingLock locked = texture.lock();
+                    memcpy(locked.pixels, source.data(), source.size());
+                }
+                else if (streaming_case.rect_count == 0)
+                {
+                    texture.update(source.data(), static_cast<uint32_t>(pitch));
+                }
+                else
+                {
+                    // scattered over the texture and moving every frame, like dirty regions of a UI surface
+                    uint32_t columns = width / RECT_SIZE;
+                    uint32_t rows    = height / RECT_SIZE;
+                    for (uint32_t i = 0; i < streaming_case.rect_count; i++)
+                    {
+                        uint32_t cell = static_cast<uint32_t>((frame_counter + i * 7) % (columns * rows));
+                        VkRect2D rect = {{static_cast<int32_t>(cell % columns * RECT_SIZE),
+                                          static_cast<int32_t>(cell / columns * RECT_SIZE)},
+                                         {RECT_SIZE, RECT_SIZE}};
+                        texture.update(source.data() + rect.offset.y * pitch + rect.offset.x * 4,
+                                       static_cast<uint32_t>(pitch),
+                                       rect);
+                    }
+                }
+            };
+            FrameTiming    timing = measureFrames(WARMUP_FRAMES, MEASURED_FRAMES);
+            StreamingStats stats  = streaming_texture.getStats();
+            double         frame_mb =
+                static_cast<double>(stats.bytes) / (WARMUP_FRAMES + MEASURED_FRAMES) / (1024.0 * 1024.0);
+            printf("%-16s %9.2f %9.3f %9.3f %10.3f %9.0f %9llu\n",
+                   streaming_case.name,
+                   frame_mb,
+                   timing.record_ms,
+                   timing.gpu_ms,
+                   timing.frame_ms,
+                   frame_mb * 1000.0 / timing.frame_ms,
+                   static_cast<unsigned long long>(stats.overflows));
+            stream_source = nullptr;
+            vkDeviceWaitIdle(device);
+            streaming_texture.cleanup(device);
+        }
+        StagingStats staging_stats = gpu->getStagingRing().getStats();
+        printf("staging ring: %llu allocations, %llu stalls\n",
+               static_cast<unsigned long long>(staging_stats.allocations),
+               static_cast<unsigned long long>(staging_stats.stalls));
+    }
+
+    void VulkanBase::runTilemapBenchmark()
+    {
+        constexpr uint32_t WARMUP_FRAMES   = 16;
+        constexpr uint32_t MEASURED_FRAMES = 128;
+
+        gpu_culling_active = false;
+        buildGridScene(1);
+        printf("%-16s %9s %9s %10s %8s %8s %9s %9s\n",
+               "case",
+               "record ms",
+               "gpu ms",
+               "frame ms",
+               "visible",
+               "rebuilt",
+               "quads",
+               "animated");
+        for (uint32_t edits : {0u, 16u, 256u})
+        {
+            // scattered over the whole map, so most edits land in chunks that are not visible
+            uint32_t seed  = 1;
+            tilemap_editor = [&seed, edits](Tilemap& map) {
+                for (uint32_t i = 0; i < edits; i++)
+                {
+                    seed = seed * 1664525u + 1013904223u;
+                    map.setTile(seed % 1024, (seed >> 10) % 1024, static_cast<TileId>(1 + (seed >> 20) % 12));
+                }
+            };
+            // settles the rebuilds of the previous case first
+            measureFrames(WARMUP_FRAMES, 0);
+            uint64_t    rebuilds_before = tilemap.getStats().total_rebuilds;
+            FrameTiming timing          = measureFrames(0, MEASURED_FRAMES);
+            const auto& stats           = tilemap.getStats();
+            char        name[32];
+            snprintf(name, sizeof(name), "%u edits/frame", edits);
+            printf("%-16s %9.3f %9.3f %10.3f %8u %8.2f %9u %9u\n",
+                   name,
+                   timing.record_ms,
+                   timing.gpu_ms,
+                   timing.frame_ms,
+                   stats.visible_chunks,
+                   static_cast<double>(stats.total_rebuilds - rebuilds_before) / MEASURED_FRAMES,
+                   stats.static_quads,
+                   stats.animated_quads);
+        }
+        tilemap_editor = nullptr;
+    }
+
+    void VulkanBase::runParticleBenchmark()
+    {
+        constexpr uint32_t WARMUP_STEPS   = 120;
+        constexpr uint32_t MEASURED_STEPS = 256;
+        constexpr float    STEP_SECONDS   = 1.0f / 60.0f;
+
+        // steps are submitted on their own and waited for, without a swapchain image; the output is headless, so
+        // this runs the same on a device that cannot present (lavapipe) and without a display
+        printf("%-10s %10s %10s %12s\n", "capacity", "alive", "step ms", "Mparticles/s");
+        for (uint32_t capacity : {65536u, 262144u, 1048576u})
+        {
+            ParticleSystem  system;
+            ParticleEmitter emitter;
+            emitter.rate = static_cast<float>(capacity) / (0.75f * emitter.lifetime);
+            system.init(*gpu, device, capacity);
+            system.setEmitter(emitter);
+            system.burst(capacity);
+
+            auto run_steps = [&](uint32_t step_count) {
+                VkCommandBuffer command_buffer = gpu->beginSingleTimeCommands();
+                for (uint32_t step = 0; step < step_count; step++)
+                {
+                    system.advance(STEP_SECONDS);
+                    system.recordStep(command_buffer);
+                }
+                gpu->endSingleTimeCommands(command_buffer);
+            };
+            // long enough for the first burst to die out and the rate to take over
+            run_steps(WARMUP_STEPS);
+            auto start = std::chrono::high_resolution_clock::now();
+            run_steps(MEASURED_STEPS);
+            double step_ms =
+                std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() /
+                MEASURED_STEPS;
+            uint32_t alive = system.readAliveCount();
+            printf("%-10u %10u %10.3f %12.1f\n", capacity, alive, step_ms, alive / step_ms / 1000.0);
+            system.cleanup(device);
+        }
+    }
+
+    void VulkanBase::runCullingBenchmark()
+    {
+        constexpr uint32_t OBJECT_COUNT    = 1000000;
+        constexpr uint32_t WARMUP_RUNS     = 8;
+        constexpr uint32_t MEASURED_RUNS   = 64;
+        constexpr double   TARGET_MS       = 1.0;
+        constexpr float    FIELD_HALF_SIZE = 20.0f;
+
+        // spheres scattered around the scene camera's view, so a realistic fraction of them survives
+        BoundingSpheres bounds;
+        bounds.resize(OBJECT_COUNT);
+        uint32_t seed   = 1;
+        auto     random = [&seed] {
+            seed = seed * 1664525u + 1013904223u;
+            return static_cast<float>(seed >> 8) / static_cast<float>(1u << 24);
+        };
+        for (uint32_t i = 0; i < OBJECT_COUNT; i++)
+        {
+            bounds.center_x[i] = (random() * 2.0f - 1.0f) * FIELD_HALF_SIZE;
+            bounds.center_y[i] = (random() * 2.0f - 1.0f) * FIELD_HALF_SIZE;
+            bounds.center_z[i] = (random() * 2.0f - 1.0f) * FIELD_HALF_SIZE;
+            bounds.radius[i]   = 0.05f + random() * 0.5f;
+        }
+        glm::mat4 view =
+            glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        glm::mat4 proj = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 50.0f);
+        proj[1][1] *= -1;
+        Frustum frustum = Frustum::fromMatrix(proj * view);
+
+        const char* kernel_name = "scalar";
+        switch (FrustumCuller::activeKernel())
+        {
+            case FrustumCuller::Kernel::SSE:
+                kernel_name = "sse";
+                break;
+            case FrustumCuller::Kernel::AVX2:
+                kernel_name = "avx2";
+                break;
+            default:
+                break;
+        }
+
+        ThreadPool            pool;
+        FrustumCuller         culler;
+        std::vector<uint32_t> visible;
+        auto                  measure = [&](const std::function<void()>& cull) {
+            for (uint32_t run = 0; run < WARMUP_RUNS; run++)
+            {
+                cull();
+            }
+            auto start = std::chrono::high_resolution_clock::now();
+            for (uint32_t run = 0; run < MEASURED_RUNS; run++)
+            {
+                cull();
+            }
+            return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start)
+                       .count() /
+                   MEASURED_RUNS;
+        };
+        auto report = [&](const char* kernel, uint32_t threads, double cull_ms) {
+            printf("%-8s %8u %9u %9.3f %12.1f %8s\n",
+                   kernel,
+                   threads,
+                   static_cast<uint32_t>(visible.size()),
+                   cull_ms,
+                   OBJECT_COUNT / cull_ms / 1000.0,
+                   cull_ms < TARGET_MS ? "yes" : "no");
+        };
+
+        printf("%u objects, target %.3f ms\n", OBJECT_COUNT, TARGET_MS);
+        printf("%-8s %8s %9s %9s %12s %8s\n", "kernel", "threads", "visible", "cull ms", "Mobjects/s", "in time");
+        // Frustum::intersectsSphere one object at a time, what the kernels are measured against
+        double scalar_ms = measure([&] {
+            visible.clear();
+            for (uint32_t i = 0; i < OBJECT_COUNT; i++)
+            {
+                glm::vec3 center {bounds.center_x[i], bounds.center_y[i], bounds.center_z[i]};
+                if (frustum.intersectsSphere(center, bounds.radius[i]))
+                {
+                    visible.push_back(i);
+                }
+            }
+        });
+        report("scalar", 1, scalar_ms);
+        report(kernel_name, 1, measure([&] { culler.cull(frustum, bounds, visible, nullptr); }));
+        report(kernel_name, pool.workerCount() + 1, measure([&] { culler.cull(frustum, bounds, visible, &pool); }));
+    }
+
+    void VulkanBase::uploadSceneObjects()
+    {
+        // written straight into the mapped object buffer, slot order matches the scene arrays
+        auto        object_count = static_cast<uint32_t>(frame_packet->world_transforms.size());
+        GpuObject*  objects      = gpu_culler.mapObjects(current_frame, object_count);
+        const auto& transforms   = frame_packet->world_transforms;
+        const auto& bounds       = frame_packet->local_bounds;
+        uint32_t    chunk_count  = (object_count + SceneGraph::CHUNK_SIZE - 1) / SceneGraph::CHUNK_SIZE;
+        gpu->getWorkerPool().parallelFor(chunk_count, [&](uint32_t chunk) {
+            uint32_t begin = chunk * SceneGraph::CHUNK_SIZE;
+            uint32_t end   = std::min(begin + SceneGraph::CHUNK_SIZE, object_count);
+            for (uint32_t slot = begin; slot < end; slot++)
+            {
+                objects[slot] = {transforms[slot], bounds[slot]};
+            }
+        });
+    }
+
+    void VulkanBase::initGpuCulling()
+    {
+        if (!gpu_culling_active)
+        {
+            return;
+        }
+        gpu_culler.init(*gpu,
+                        device,
+                        MAX_GPU_OBJECTS,
+                        MAX_FRAMES_IN_FLIGHT,
+                        draw_indirect_count_supported,
+                        multi_draw_indirect_supported);
+    }
+
+    void VulkanBase::initText()
+    {
+        text_active = !options.font_path.empty();
+        if (!text_active)
+        {
+            return;
+        }
+        text_renderer.init(
+            *gpu, device, options.font_path, descriptor_allocator, texture_sampler, MAX_FRAMES_IN_FLIGHT);
+    }
+
+    void VulkanBase::initTilemap()
+    {
+        constexpr uint32_t MAP_SIZE  = 1024;
+        constexpr float    TILE_SIZE = 1.0f / 32.0f;
+
+        tilemap_active = options.tilemap;
+        if (!tilemap_active)
+        {
+            return;
+        }
+        // texture.jpg as a 4x4 tileset; the last row is water, animated through its four cells
+        tilemap.init(*gpu,
+                     MAP_SIZE,
+                     MAP_SIZE,
+                     {4, 4},
+                     glm::vec2(-0.5f * MAP_SIZE * TILE_SIZE),
+                     TILE_SIZE,
+                     MAX_FRAMES_IN_FLIGHT);
+        tilemap.setAnimation(13, {13, 4, 0.25f});
+        for (uint32_t y = 0; y < MAP_SIZE; y++)
+        {
+            for (uint32_t x = 0; x < MAP_SIZE; x++)
+            {
+                // patches of ground with rivers running diagonally through them
+                bool   water = (x + y) % 96 < 6;
+                TileId ground = static_cast<TileId>(1 + (x / 8 * 7 + y / 8 * 13) % 12);
+                tilemap.setTile(x, y, water ? 13 : ground);
+            }
+        }
+    }
+
+    void VulkanBase::initParticles()
+    {
+        particles_active = options.particles > 0;
+        if (!particles_active)
+        {
+            return;
+        }
+        particles.init(*gpu, device, options.particles);
+        // a fountain over the scene; particles live 0.75 lifetimes on average, so this rate keeps it about full
+        ParticleEmitter emitter;
+        emitter.rate = static_cast<float>(options.particles) / (0.75f * emitter.lifetime);
+        particles.setEmitter(emitter);
+    }
+
+    void VulkanBase::buildTextOverlay()
+    {
+        char stats[128];
+        snprintf(stats,
+                 sizeof(stats),
+                 "frame %llu\nvisible %zu\ncpu %.2f ms  gpu %.2f ms\nrender %ux%u",
+                 static_cast<unsigned long long>(frame_counter),
+                 visible_objects.size(),
+                 last_record_ms,
+                 last_gpu_ms,
+                 render_extent.width,
+                 render_extent.height);
+        text_renderer.begin(current_frame);
+        text_renderer.addText(stats, {8.0f, 8.0f}, OVERLAY_TEXT_SIZE, {1.0f, 1.0f, 1.0f, 1.0f});
+        text_renderer.flush(*gpu, device);
+    }
+
     void VulkanBase::framebufferResizeCallback() { framebuffer_resized = true; }
 
     void VulkanBase::drawFrame()
     {
-        vkWaitForFences(device, 1, &in_flight_fences[current_frame], VK_TRUE, UINT64_MAX);
+        advanceSimulation();
+        simulate(inline_packet);
+        if (inline_packet.drawable_extent.width != 0 && inline_packet.drawable_extent.height != 0)
+        {
+            renderFrame(inline_packet);
+        }
+    }
 
-        uint32_t image_index;
-        VkResult result = vkAcquireNextImageKHR(
-            device, swap_chain, UINT64_MAX, image_available_semaphores[current_frame], VK_NULL_HANDLE, &image_index);
+    void VulkanBase::renderFrame(const FramePacket& packet)
+    {
+        frame_packet    = &packet;
+        drawable_extent = packet.drawable_extent;
+        VulkanBase* self = this;
+        renderOutputs({&self, 1});
+    }
+
+    void VulkanBase::renderOutputs(std::span<VulkanBase* const> outputs)
+    {
+        GpuDevice& gpu = *outputs.front()->gpu;
+        gpu.waitForFrame();
+        for (VulkanBase* output : outputs)
+        {
+            output->recordFrame();
+        }
+        gpu.submitFrame();
+        for (VulkanBase* output : outputs)
+        {
+            output->finishFrame();
+        }
+    }
+
+    void VulkanBase::recordFrame()
+    {
+        submission.reset();
+        // every output follows the device's frame slot, whose fence renderOutputs waited for
+        current_frame = gpu->currentFrame();
+        // everything up to the frame last submitted in this slot is done on the GPU
+        deletion_queue.collect(submitted_frames[current_frame]);
+        frame_readback.collect(submitted_frames[current_frame]);
+        frame_descriptors[current_frame].reset();
+        if (timestamp_query_pool != VK_NULL_HANDLE)
+        {
+            // the fence guarantees this slot's previous submission has finished, so its timestamps are final
+            uint64_t timestamps[2];
+            if (vkGetQueryPoolResults(device,
+                                      timestamp_query_pool,
+                                      current_frame * 2,
+                                      2,
+                                      sizeof(timestamps),
+                                      timestamps,
+                                      sizeof(uint64_t),
+                                      VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+            {
+                uint64_t ticks = ((timestamps[1] & timestamp_mask) - (timestamps[0] & timestamp_mask)) & timestamp_mask;
+                last_gpu_ms    = static_cast<double>(ticks) * timestamp_period / 1e6;
+                if (dynamic_resolution_active)
+                {
+                    resolution_controller.update(last_gpu_ms);
+                }
+            }
+        }
+        if (drawable_extent.width == 0 || drawable_extent.height == 0)
+        {
+            // minimized, the other outputs go ahead without this one
+            return;
+        }
 
+        VkResult result = output.acquire(device, current_frame, image_index);
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebuffer_resized)
         {
             framebuffer_resized = false;
@@ -1365,35 +2214,58 @@ namespace vulkanDetails
             throw std::runtime_error("failed to acquire swap chain image!");
         }
 
-        vkResetFences(device, 1, &in_flight_fences[current_frame]);
+        submitted_frames[current_frame] = ++frame_counter;
+        deletion_queue.setCurrentFrame(frame_counter);
+        render_extent = dynamic_resolution_active
+                            ? ResolutionController::scaledExtent(output.getExtent(), resolution_controller.scale())
+                            : output.getExtent();
         updateUniformBuffer(image_index);
-        VkSubmitInfo submit_info {};
-        submit_info.sType                      = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        VkSemaphore          wait_semaphores[] = {image_available_semaphores[current_frame]};
-        VkPipelineStageFlags wait_stages[]     = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submit_info.waitSemaphoreCount         = 1;
-        submit_info.pWaitSemaphores            = wait_semaphores;
-        submit_info.pWaitDstStageMask          = wait_stages;
-        submit_info.commandBufferCount         = 1;
-        submit_info.pCommandBuffers            = &command_buffers[image_index];
-        VkSemaphore signal_semaphores[]        = {render_finished_semaphores[current_frame]};
-        submit_info.signalSemaphoreCount       = 1;
-        submit_info.pSignalSemaphores          = signal_semaphores;
-        if (vkQueueSubmit(graphics_queue, 1, &submit_info, in_flight_fences[current_frame]) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to submit draw command buffer!");
-        }
-
-        VkPresentInfoKHR present_info {};
-        present_info.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-        present_info.waitSemaphoreCount = 1;
-        present_info.pWaitSemaphores    = signal_semaphores;
-        VkSwapchainKHR swap_chains[]    = {swap_chain};
-        present_info.swapchainCount     = 1;
-        present_info.pSwapchains        = swap_chains;
-        present_info.pImageIndices      = &image_index;
-        present_info.pResults           = nullptr;
-        result                          = vkQueuePresentKHR(present_queue, &present_info);
+        if (stream_source)
+        {
+            streaming_texture.begin(current_frame);
+            stream_source(streaming_texture);
+        }
+        if (tilemap_active && tilemap_visible)
+        {
+            if (tilemap_editor)
+            {
+                tilemap_editor(tilemap);
+            }
+            tilemap.update(view_frustum, current_frame, frame_packet->time);
+        }
+        if (particles_active)
+        {
+            // clamped so a stall or a jump in time does not launch every particle at once
+            particles.advance(std::clamp(frame_packet->time - particle_time, 0.0f, 0.1f));
+            particle_time = frame_packet->time;
+        }
+        if (text_active)
+        {
+            buildTextOverlay();
+        }
+        vkResetCommandBuffer(command_buffers[current_frame], 0);
+        auto record_start = std::chrono::high_resolution_clock::now();
+        recordCommandBuffer(command_buffers[current_frame], image_index);
+        last_record_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() -
+                                                                   record_start)
+                             .count();
+
+        FrameSubmission frame_submission;
+        frame_submission.command_buffer  = command_buffers[current_frame];
+        frame_submission.image_available = output.getImageAvailable(current_frame);
+        frame_submission.render_finished = output.getRenderFinished(current_frame);
+        frame_submission.swap_chain      = output.getSwapChain();
+        frame_submission.image_index     = image_index;
+        submission                       = gpu->queueSubmission(frame_submission);
+    }
+
+    void VulkanBase::finishFrame()
+    {
+        if (!submission)
+        {
+            return;
+        }
+        VkResult result = gpu->presentResult(*submission);
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebuffer_resized)
         {
             framebuffer_resized = false;
@@ -1403,91 +2275,111 @@ namespace vulkanDetails
         {
             throw std::runtime_error("failed to present swap chain image!");
         }
-        current_frame = (current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
     }
 
-    void VulkanBase::pickPhysicalDevice()
+    void VulkanBase::runOutputs(std::span<VulkanBase* const> outputs)
     {
-        uint32_t device_count = 0;
-
-        vkEnumeratePhysicalDevices(instance, &device_count, nullptr);
-        if (device_count == 0)
-        {
-            throw std::runtime_error("failed to find GPUs with Vulkan support!");
-        }
-        std::vector<VkPhysicalDevice> devices(device_count);
-        vkEnumeratePhysicalDevices(instance, &device_count, devices.data());
-        for (const auto& device : devices)
+        // a render thread per output would mean a submit per output, so everything stays on this thread
+        VulkanBase* primary = outputs.front();
+        primary->frame_limiter.setTargetFps(primary->options.max_fps);
+        SDL_Event e;
+        bool      quit = false;
+        while (!quit)
         {
-            if (isDeviceSuitable(device))
+            while (SDL_PollEvent(&e) != 0)
             {
-                physical_device = device;
-                VkPhysicalDeviceProperties physical_device_properties;
-                vkGetPhysicalDeviceProperties(device, &physical_device_properties);
-                std::cout << "GPU: " << physical_device_properties.deviceName << std::endl;
-                break;
+                if (e.type == SDL_QUIT)
+                {
+                    quit = true;
+                }
+                else if (e.type == SDL_WINDOWEVENT)
+                {
+                    for (VulkanBase* output : outputs)
+                    {
+                        if (SDL_GetWindowID(output->getWindow()) != e.window.windowID)
+                        {
+                            continue;
+                        }
+                        if (e.window.event == SDL_WINDOWEVENT_CLOSE)
+                        {
+                            quit = true;
+                        }
+                        else if (e.window.event == SDL_WINDOWEVENT_RESIZED ||
+                                 e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                        {
+                            output->framebufferResizeCallback();
+                        }
+                    }
+                }
             }
+            bool visible = false;
+            for (VulkanBase* output : outputs)
+            {
+                output->advanceSimulation();
+                output->simulate(output->inline_packet);
+                output->frame_packet    = &output->inline_packet;
+                output->drawable_extent = output->inline_packet.drawable_extent;
+                visible = visible || (output->drawable_extent.width != 0 && output->drawable_extent.height != 0);
+            }
+            if (!visible)
+            {
+                // every window is minimized, nothing to draw until one comes back
+                SDL_WaitEvent(nullptr);
+                continue;
+            }
+            renderOutputs(outputs);
+            primary->frame_limiter.wait();
         }
-        if (physical_device == VK_NULL_HANDLE)
-        {
-            throw std::runtime_error("failed to fina a suitable GPU!");
-        }
+        vkDeviceWaitIdle(primary->device);
     }
 
     std::vector<const char*> VulkanBase::getRequiredExtensions()
     {
+        if (output.getWindow() == nullptr)
+        {
+            // headless, no surface to create
+            return {};
+        }
         uint32_t extension_count = 0;
-        if (!SDL_Vulkan_GetInstanceExtensions(window, &extension_count, nullptr))
+        if (!SDL_Vulkan_GetInstanceExtensions(output.getWindow(), &extension_count, nullptr))
         {
             throw std::runtime_error("Failed to get SDL Vulkan extensions count!");
         }
         std::vector<const char*> extensions(extension_count);
-        if (!SDL_Vulkan_GetInstanceExtensions(window, &extension_count, extensions.data()))
+        if (!SDL_Vulkan_GetInstanceExtensions(output.getWindow(), &extension_count, extensions.data()))
         {
             throw std::runtime_error("Failed to get SDL Vulkan extensions!");
         }
-        if (enable_validation_layers)
-        {
-            extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
-        }
         return extensions;
     }
 
     void VulkanBase::recreateSwapChain()
     {
-        int height, width = 0;
-        while (width == 0 || height == 0)
-        {
-            SDL_Vulkan_GetDrawableSize(window, &width, &height);
-            SDL_PollEvent(nullptr);
-        }
+        // never called while minimized, recordFrame is skipped for empty drawable extents
         vkDeviceWaitIdle(device);
+        // every recorded copy is complete, hand them over before the ring is rebuilt for the new size
+        frame_readback.collect(frame_counter);
         cleanupSwapChain();
 
         createSwapChain();
-        createImageViews();
+        frame_readback.resize(*gpu, device, output.getExtent(), output.getFormat());
         createRenderPass();
         createGraphicsPipeline();
-        createFrameBuffer();
         createCommandBuffers();
     }
-    void VulkanBase::cleanupSwapChain() const
+    void VulkanBase::cleanupSwapChain()
     {
-        vkDestroyBuffer(device, vertex_buffer, nullptr);
-        vkFreeMemory(device, vertex_buffer_memory, nullptr);
-        for (const auto& framebuffer : swap_chain_framebuffers)
-        {
-            vkDestroyFramebuffer(device, framebuffer, nullptr);
-        }
+        // cached framebuffers reference the swapchain views
+        frame_graph.releaseFramebuffers();
         vkFreeCommandBuffers(
             device, command_pool, static_cast<uint32_t>(command_buffers.size()), command_buffers.data());
-        vkDestroyPipeline(device, graphics_pipeline, nullptr);
-        vkDestroyPipelineLayout(device, pipeline_layout, nullptr);
-        vkDestroyRenderPass(device, render_pass, nullptr);
-        for (const auto& image_view : swap_chain_image_views)
+        if (render_pass != VK_NULL_HANDLE)
         {
-            vkDestroyImageView(device, image_view, nullptr);
+            // pipelines outlive the render pass they were compiled against, but running compiles still use it
+            gpu->getPipelineRegistry().waitIdle();
+            vkDestroyRenderPass(device, render_pass, nullptr);
+            render_pass = VK_NULL_HANDLE;
         }
-        vkDestroySwapchainKHR(device, swap_chain, nullptr);
+        output.destroySwapChain(device);
     }
 } // namespace vulkanDetails
\ No newline at end of file
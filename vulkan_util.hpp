@@ -1,15 +1,42 @@
 #pragma once
+#include "barrier_batch.hpp"
+#include "deletion_queue.hpp"
+#include "descriptor_allocator.hpp"
+#include "dynamic_resolution.hpp"
+#include "fixed_timestep.hpp"
+#include "frame_limiter.hpp"
+#include "frame_packet.hpp"
+#include "frame_readback.hpp"
+#include "frustum_culling.hpp"
+#include "gpu_culling.hpp"
+#include "gpu_device.hpp"
+#include "particle_system.hpp"
+#include "pipeline_registry.hpp"
+#include "regression.hpp"
+#include "render_graph.hpp"
+#include "scene_graph.hpp"
+#include "streaming_texture.hpp"
+#include "text_renderer.hpp"
+#include "thread_pool.hpp"
+#include "tilemap.hpp"
 #include "vulkan/vulkan.h"
+#include "window_surface.hpp"
 #include <SDL2/SDL_vulkan.h>
 #include <SDL_video.h>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <fstream>
+#include <functional>
 #include <glm/ext/vector_float2.hpp>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <set>
+#include <span>
 #include <stdexcept>
+#include <string>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 #include <glm/glm.hpp>
@@ -24,6 +51,15 @@ namespace vulkanDetails
         glm::mat4 proj;
     };
 
+    // Per-draw data pushed with vkCmdPushConstants; 80 bytes, inside the 128 byte minimum every device guarantees.
+    // There is no texture index: every scene draw samples the one texture bound at binding 1 of the scene's
+    // descriptor set, so there is nothing to index into yet.
+    struct ObjectPushConstants
+    {
+        glm::mat4 model;
+        glm::vec4 tint;
+    };
+
     struct Vertex{
         glm::vec2 pos;
         glm::vec3 color;
@@ -56,117 +92,196 @@ namespace vulkanDetails
         }
     };
 
-    struct SwapChainSupportDetails
+    // How per-object data reaches the vertex shader on the CPU-culled path.
+    enum class DrawPath
     {
-        VkSurfaceCapabilitiesKHR        capabilities;
-        std::vector<VkSurfaceFormatKHR> formats;
-        std::vector<VkPresentModeKHR>   present_modes;
+        PushConstants,
+        DynamicUniforms, // one packed uniform buffer and descriptor set, a dynamic offset per draw
     };
-    struct QueueFamilyIndices
+
+    enum class BenchmarkMode
     {
-        std::optional<uint32_t> graphics_family;
-        std::optional<uint32_t> present_family;
+        None,
+        Draws,     // runDrawBenchmark
+        Msaa,      // runMsaaBenchmark
+        Regress,   // runRegressionSuite
+        Streaming, // runStreamingBenchmark
+        Tilemap,   // runTilemapBenchmark
+        Particles, // runParticleBenchmark
+        Culling,   // runCullingBenchmark
+    };
 
-        [[nodiscard]] bool isComplete() const { return graphics_family.has_value() && present_family.has_value(); }
+    // Startup switches, applied with VulkanBase::setOptions before initVulkan.
+    struct RendererOptions
+    {
+        // cull and emit draws from a compute pass instead of cullObjects/vkCmdDrawIndexed
+        bool           gpu_culling  = false;
+        DrawPath       draw_path    = DrawPath::PushConstants;
+        // 1, 2, 4 or 8; rounded down to what framebufferColorSampleCounts allows
+        uint32_t       msaa_samples = 1;
+        // run a benchmark instead of mainLoop
+        BenchmarkMode  benchmark    = BenchmarkMode::None;
+        // read rendered frames back to files or a stream
+        CaptureOptions capture;
+        // fixed simulation steps per second, independent of the frame rate
+        double         simulation_rate  = 60.0;
+        // only render when the scene changed or the window needs repainting, instead of continuously
+        bool           on_demand_redraw = false;
+        // frame rate cap of mainLoop, 0 for none
+        double         max_fps          = 0.0;
+        // reference images and baseline.txt of BenchmarkMode::Regress
+        std::string    regression_dir;
+        // rewrite the references and the baseline instead of checking against them
+        bool           regression_update = false;
+        // TTF font of the stats overlay; no text is drawn without one
+        std::string    font_path;
+        // GPU time per frame the scene resolution is scaled to fit, 0 to always render at the swapchain size
+        double         gpu_budget_ms = 0.0;
+        // keep VkRenderPass/vkCmdPipelineBarrier on devices that could use dynamic rendering and synchronization2
+        bool           legacy_render_passes = false;
+        // device index or part of its name; empty picks by score, see GpuDevice::pickPhysicalDevice
+        std::string    gpu;
+        // draw a generated tile map under the scene
+        bool           tilemap = false;
+        // capacity of the compute particle system, 0 for none
+        uint32_t       particles = 0;
+        // no window, surface or swapchain: frames go into offscreen images of WIDTH x HEIGHT and are never
+        // presented, for the regression suite and benchmarks on machines without a display
+        bool           headless = false;
     };
 
+    // What the fixed-timestep simulation advances; frames show an interpolation of the last two states.
+    struct SimulationState
+    {
+        float quad_angle = 0.0f; // radians around z
+
+        static SimulationState interpolate(const SimulationState& from, const SimulationState& to, float alpha);
+    };
+
+    // Per-frame averages reported by the benchmark modes.
+    struct FrameTiming
+    {
+        double record_ms = 0.0; // command buffer recording on the CPU
+        double gpu_ms    = 0.0; // between the first and last timestamp of the command buffer
+        double frame_ms  = 0.0; // wall clock, including acquire and present
+    };
+
+    // One output: a window with its swapchain, frame resources and scene. Any number of them can share one
+    // GpuDevice and have their frames submitted together, see renderOutputs.
     class VulkanBase
     {
     public:
-        void    initWindow();
-        static VulkanBase* getInstance();
-        void               createInstance();
-
-        void                                  initVulkan();
-        static void                           printExtensionProperties();
-        void                                  cleanup() const;
-        static bool                           checkValidationLayerSupport(std::vector<const char*>& validation_layers);
-        std::vector<const char*>       getRequiredExtensions();
-        static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT      messageSeverity,
-                                                            VkDebugUtilsMessageTypeFlagsEXT             messageType,
-                                                            const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
-                                                            void*                                       pUserData);
-        void                                  setupDebugMessenger();
-        static VkResult                       createDebugUtilsMessengerEXT(VkInstance                                instance,
-                                                                           const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo,
-                                                                           const VkAllocationCallbacks*              pAllocator,
-                                                                           VkDebugUtilsMessengerEXT*                 pDebugMessenger);
-
-        static void destroyDebugUtilsMessengerExt(VkInstance                   instance,
-                                                  VkDebugUtilsMessengerEXT     debugMessenger,
-                                                  const VkAllocationCallbacks* pAllocator);
-
-        void                      pickPhysicalDevice();
-        bool                      isDeviceSuitable(VkPhysicalDevice device);
-        QueueFamilyIndices        findQueueFamilies(VkPhysicalDevice device);
+        // The device is brought up by the first output's initVulkan, later ones join it.
+        explicit VulkanBase(std::shared_ptr<GpuDevice> gpu_device);
+
+        void                      setOptions(const RendererOptions& renderer_options);
+        void                      initWindow();
+        void                      initVulkan();
+        void                      cleanup();
+        std::vector<const char*>  getRequiredExtensions();
         void                      createLogicalDevice();
-        void                      createSurface();
-        static bool               checkDeviceExtensionSupport(VkPhysicalDevice device);
-        SwapChainSupportDetails   querySwapChainSupport(VkPhysicalDevice device);
-        static VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& available_formats);
-        static VkPresentModeKHR   chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& available_present_modes);
-        VkExtent2D                chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
         void                      createSwapChain();
-        void                      createImageViews();
+        void                      createPipelineLayouts();
         void                      createGraphicsPipeline();
-        VkShaderModule            createShaderModule(const std::vector<char>& code);
+        GraphicsPipelineDesc      scenePipelineDesc(const std::string& vertex_shader_path,
+                                                    VkPipelineLayout   layout) const;
         void                      createRenderPass();
-        void                      createFrameBuffer();
         void                      createCommandPool();
         void                      createCommandBuffers();
+        void                      recordCommandBuffer(VkCommandBuffer command_buffer, uint32_t image_index);
+        void                      buildFrameGraph(uint32_t image_index);
+        void                      recordSceneDraws(VkCommandBuffer command_buffer, uint32_t image_index);
+        // Simulates and renders one frame on the calling thread, for the benchmarks.
         void                      drawFrame();
+        void                      renderFrame(const FramePacket& packet);
+        // Waits for the shared frame slot, records each output's last packet and submits and presents all of them
+        // with one vkQueueSubmit and one vkQueuePresentKHR.
+        static void               renderOutputs(std::span<VulkanBase* const> outputs);
+        // Acquires and records this output's part of the frame; skipped while it has nothing to show.
+        void                      recordFrame();
+        // Handles this output's present result once the frame went out.
+        void                      finishFrame();
+        // mainLoop for several outputs at once, all on this thread so there is a single frame to submit.
+        static void               runOutputs(std::span<VulkanBase* const> outputs);
+        // Handles events and simulates on this thread while a render thread draws the published frame packets.
         void                      mainLoop();
+        void                      renderLoop(const std::atomic<bool>& running);
+        void                      notifyPacketConsumed() const;
+        // Runs as many fixed simulation steps as real time has accumulated; returns how many that were.
+        uint32_t                  advanceSimulation();
+        static void               stepSimulation(SimulationState& state, float step_seconds);
+        // Fills packet with the scene at the interpolated simulation state.
+        void                      simulate(FramePacket& packet);
+        void                      runDrawBenchmark();
+        void                      runMsaaBenchmark();
+        bool                      runRegressionSuite();
+        // Streams 4K frames into a StreamingTexture every frame, whole and in partial rects, RGBA and YUV.
+        void                      runStreamingBenchmark();
+        // Draws a 1024x1024 tile map, static and with tiles changing every frame.
+        void                      runTilemapBenchmark();
+        // Steps 64K to 1M particles in compute-only submissions; nothing is drawn or presented.
+        void                      runParticleBenchmark();
+        // Culls 1M spheres on the CPU with each kernel, single-threaded and on the pool, against a 1 ms budget.
+        // Needs no device or window.
+        static void               runCullingBenchmark();
+        FrameTiming               measureFrames(uint32_t warmup_frames, uint32_t measured_frames);
         void                      createSyncObject();
         void                      recreateSwapChain();
-        void                      cleanupSwapChain() const;
+        void                      cleanupSwapChain();
         void framebufferResizeCallback();
         void createVertexBuffer();
-        uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
-        void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer,
-                          VkDeviceMemory& buffer_memory);
-        void copyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size);
         void createIndexBuffer();
         void createDescriptorSetLayout();      
         void createUniformBuffer();
         void updateUniformBuffer(uint32_t current_image);
-        void createDescriptorPool();
+        void cullObjects(const glm::mat4& view_proj);
+        void initGpuCulling();
+        void initText();
+        void initTilemap();
+        void initParticles();
+        // Lays out this frame's overlay text; the atlas upload and draw are recorded with the frame.
+        void buildTextOverlay();
+        void initScene();
+        void buildGridScene(uint32_t object_count);
+        void buildStackedScene(uint32_t layer_count);
+        void uploadSceneObjects();
+        void createObjectUniformBuffers(uint32_t object_count);
+        void destroyObjectUniformBuffers();
+        void createDescriptorAllocators();
         void createDescriptorSets();
         void createTextureImage();
-        void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
-                         VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& image_memory);
-        VkCommandBuffer beginSingleTimeCommands();
-        void endSingleTimeCommands(VkCommandBuffer command_buffer);
+        VkSampleCountFlagBits chooseMsaaSamples(uint32_t requested_samples);
+        void                  initDynamicResolution();
+        // Once the swapchain format is known: turns dynamic resolution off if the upscale cannot be blitted.
+        void                  checkUpscaleSupport();
+        void                  setMsaaSamples(uint32_t requested_samples);
+        // timestampValidBits of the graphics queue family, 0 when it cannot write timestamps
+        uint32_t              graphicsTimestampBits() const;
+        void                  createTimestampQueries();
         void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout);
-        void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
         void createTextureImageView();
-        VkImageView createImageView(VkImage image, VkFormat format);
+        // texture.jpg, or the streaming texture while stream_source fills it
+        [[nodiscard]] VkImageView sceneTextureView() const;
         void createTextureSampler();
+
+        [[nodiscard]] SDL_Window* getWindow() const { return output.getWindow(); }
+
     private:
-        SDL_Window* window{};
-        VulkanBase() = default;
-        static VulkanBase*           m_singleton;
-        VkInstance                   instance {};
-        VkDebugUtilsMessengerEXT     callback {};
+        RendererOptions              options;
+        std::shared_ptr<GpuDevice>   gpu;
+        WindowSurface                output;
+        // gpu's handles, cached since nearly everything needs them
         VkPhysicalDevice             physical_device = VK_NULL_HANDLE;
         VkDevice                     device {};
-        VkQueue                      graphics_queue {};
-        VkQueue                      present_queue {};
-        VkSurfaceKHR                 surface {};
-        VkSwapchainKHR               swap_chain {};
-        std::vector<VkImage>         swap_chain_images;
-        VkFormat                     swap_chain_image_format {};
-        VkExtent2D                   swap_chain_extent {};
-        std::vector<VkImageView>     swap_chain_image_views;
-        VkRenderPass                 render_pass {};
+        VkRenderPass                 render_pass {}; // pipeline compatibility only, see createRenderPass
+        bool                         dynamic_rendering = false; // no render pass objects, sync2 barriers
         VkPipelineLayout             pipeline_layout {};
         VkPipeline                   graphics_pipeline {};
-        std::vector<VkFramebuffer>   swap_chain_framebuffers;
         VkCommandPool                command_pool {};
         std::vector<VkCommandBuffer> command_buffers;
-        std::vector<VkSemaphore>     image_available_semaphores;
-        std::vector<VkSemaphore>     render_finished_semaphores;
-        std::vector<VkFence>         in_flight_fences;
-        uint32_t                     current_frame = 0;
+        uint32_t                     current_frame = 0; // gpu's frame slot, taken over in recordFrame
+        uint32_t                     image_index   = 0;
+        std::optional<uint32_t>      submission; // this output's entry in the frame gpu is about to submit
         bool                         framebuffer_resized = false;
         VkBuffer    vertex_buffer{};
         VkDeviceMemory vertex_buffer_memory{};
@@ -175,12 +290,85 @@ namespace vulkanDetails
         std::vector<VkBuffer> uniform_buffers;
         std::vector<VkDeviceMemory> uniform_buffers_memory;
         VkDescriptorSetLayout descriptor_set_layout{};
-        VkDescriptorPool descriptor_pool{};
+        DescriptorAllocator descriptor_allocator; // sets that live as long as the swapchain or longer
+        DescriptorSetCache descriptor_cache;
+        std::vector<DescriptorAllocator> frame_descriptors; // one per frame in flight, reset after its fence
         std::vector<VkDescriptorSet> descriptor_sets;
         VkImage texture_image{};
         VkDeviceMemory texture_image_memory{};
         VkImageView texture_image_view{};
         VkSampler texture_sampler{};
+        SceneGraph                   scene;
+        SceneGraph::NodeId           quad_node                     = 0;
+        FrustumCuller                frustum_culler;
+        std::vector<uint32_t>        visible_objects;
+        Frustum                      view_frustum {};
+        GpuCuller                    gpu_culler;
+        bool                         gpu_culling_active            = false;
+        bool                         draw_indirect_count_supported = false;
+        bool                         multi_draw_indirect_supported = false;
+        TextRenderer                 text_renderer;
+        bool                         text_active                   = false;
+        GraphicsPipelineDesc         text_pipeline_desc;
+        StreamingTexture             streaming_texture;
+        // fills streaming_texture once per frame while set; its copies go into the frame's graph
+        std::function<void(StreamingTexture&)> stream_source;
+        Tilemap                      tilemap;
+        bool                         tilemap_active                = false;
+        bool                         tilemap_visible               = true; // updated and drawn, while active
+        GraphicsPipelineDesc         tilemap_pipeline_desc;
+        VkPipeline                   tilemap_pipeline {};
+        // changes tiles once per frame while set, before the tilemap is updated
+        std::function<void(Tilemap&)> tilemap_editor;
+        ParticleSystem               particles;
+        bool                         particles_active              = false;
+        float                        particle_time                 = 0.0f; // animation time of the last step
+        VkPipelineLayout             particle_pipeline_layout {};
+        VkPipeline                   particle_pipeline {};
+        VkPipelineLayout             indirect_pipeline_layout {};
+        VkPipeline                   indirect_pipeline {};
+        UniformBufferObject          frame_ubo {};
+        DrawPath                     draw_path                     = DrawPath::PushConstants;
+        double                       last_record_ms                = 0.0;
+        VkDescriptorSetLayout        object_set_layout {};
+        VkPipelineLayout             object_uniform_pipeline_layout {};
+        VkPipeline                   object_uniform_pipeline {};
+        std::vector<VkBuffer>        object_uniform_buffers;
+        std::vector<VkDeviceMemory>  object_uniform_buffers_memory;
+        std::vector<void*>           object_uniform_buffers_mapped;
+        VkDeviceSize                 object_uniform_stride         = 0;
+        uint32_t                     object_uniform_capacity       = 0;
+        VkSampleCountFlagBits        msaa_samples                  = VK_SAMPLE_COUNT_1_BIT;
+        ResolutionController         resolution_controller;
+        bool                         dynamic_resolution_active     = false;
+        VkFilter                     upscale_filter                = VK_FILTER_LINEAR;
+        VkExtent2D                   render_extent {}; // what the scene is drawn at, swap_chain_extent or less
+        RenderGraph                  frame_graph;
+        DeletionQueue                deletion_queue;
+        FrameReadback                frame_readback;
+        uint64_t                     frame_counter                 = 0; // frames submitted so far
+        std::vector<uint64_t>        submitted_frames; // frame_counter of each in-flight slot's last submission
+        VkQueryPool                  timestamp_query_pool {};
+        float                        timestamp_period              = 0.0f;
+        uint64_t                     timestamp_mask                = 0; // timestampValidBits of the graphics queue
+        double                       last_gpu_ms                   = 0.0;
+        std::optional<float>         fixed_time; // animation time in seconds, replaces the clock when set
+        FixedTimestep                simulation_clock;
+        SimulationState              previous_state;
+        SimulationState              current_state;
+        bool                         simulation_started            = false;
+        bool                         simulation_paused             = false; // toggled with space
+        std::chrono::high_resolution_clock::time_point last_advance;
+        TripleBuffer<FramePacket>    frame_packets;
+        std::atomic<uint64_t>        consumed_sequence             = 0; // last packet the render thread picked up
+        std::atomic<uint64_t>        published_sequence            = 0; // last packet the event thread published
+        uint32_t                     packet_consumed_event         = 0; // SDL user event the render thread pushes
+        FrameLimiter                 frame_limiter;
+        FramePacket                  inline_packet; // drawFrame's, outside of mainLoop
+        const FramePacket*           frame_packet                  = nullptr; // the one being rendered
+        VkExtent2D                   drawable_extent {}; // from the last packet, SDL is only asked on the event thread
+        std::chrono::high_resolution_clock::time_point startup_begin;
+        double                                         startup_ms = 0.0; // initWindow through initVulkan
     };
     static std::vector<char> readFile(const std::string& filename)
     {
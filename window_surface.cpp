@@ -0,0 +1,247 @@
+#include "window_surface.hpp"
+#include "gpu_device.hpp"
+#include <SDL_vulkan.h>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace vulkanDetails
+{
+    void WindowSurface::createSurface(VkInstance instance)
+    {
+        if (!SDL_Vulkan_CreateSurface(window, instance, &surface))
+        {
+            std::cerr << "failed to create window surface!" << std::endl;
+            throw std::runtime_error("failed to create window surface!");
+        }
+    }
+
+    void WindowSurface::createSyncObjects(VkDevice device, uint32_t frame_count)
+    {
+        image_available_semaphores.resize(frame_count);
+        render_finished_semaphores.resize(frame_count);
+
+        VkSemaphoreCreateInfo semaphore_info {};
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        for (uint32_t i = 0; i < frame_count; i++)
+        {
+            if (vkCreateSemaphore(device, &semaphore_info, nullptr, &image_available_semaphores[i]) != VK_SUCCESS ||
+                vkCreateSemaphore(device, &semaphore_info, nullptr, &render_finished_semaphores[i]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create semaphores!");
+            }
+        }
+    }
+
+    SwapChainSupportDetails WindowSurface::querySupport(VkPhysicalDevice physical_device, VkSurfaceKHR surface)
+    {
+        SwapChainSupportDetails details;
+        vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physical_device, surface, &details.capabilities);
+        uint32_t format_count;
+        vkGetPhysicalDeviceSurfaceFormatsKHR(physical_device, surface, &format_count, nullptr);
+        if (format_count != 0)
+        {
+            details.formats.resize(format_count);
+            vkGetPhysicalDeviceSurfaceFormatsKHR(physical_device, surface, &format_count, details.formats.data());
+        }
+
+        uint32_t present_mode_count;
+
+        vkGetPhysicalDeviceSurfacePresentModesKHR(physical_device, surface, &present_mode_count, nullptr);
+        if (present_mode_count != 0)
+        {
+            details.present_modes.resize(present_mode_count);
+            vkGetPhysicalDeviceSurfacePresentModesKHR(
+                physical_device, surface, &present_mode_count, details.present_modes.data());
+        }
+
+        return details;
+    }
+
+    VkSurfaceFormatKHR WindowSurface::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& available_formats)
+    {
+        if (available_formats.size() == 1 && available_formats[0].format == VK_FORMAT_UNDEFINED)
+        {
+            return {VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+        }
+        for (const auto& available_format : available_formats)
+        {
+            if (available_format.format == VK_FORMAT_B8G8R8A8_UNORM &&
+                available_format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
+            {
+                return available_format;
+            }
+        }
+        return available_formats[0];
+    }
+
+    VkPresentModeKHR WindowSurface::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& available_present_modes)
+    {
+        for (const auto& available_present_mode : available_present_modes)
+        {
+            if (available_present_mode == VK_PRESENT_MODE_MAILBOX_KHR)
+            {
+                return available_present_mode;
+            }
+        }
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    VkExtent2D WindowSurface::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, VkExtent2D drawable_extent)
+    {
+        if (capabilities.currentExtent.width != UINT32_MAX)
+        {
+            return capabilities.currentExtent;
+        }
+        VkExtent2D actual_extent = drawable_extent;
+
+        actual_extent.width  = std::max(capabilities.minImageExtent.width,
+                                       std::min(capabilities.maxImageExtent.width, actual_extent.width));
+        actual_extent.height = std::max(capabilities.minImageExtent.height,
+                                        std::min(capabilities.maxImageExtent.height, actual_extent.height));
+        return actual_extent;
+    }
+
+    void WindowSurface::createSwapChain(const GpuDevice& gpu, VkExtent2D drawable_extent, VkImageUsageFlags usage)
+    {
+        SwapChainSupportDetails swap_chain_support = querySupport(gpu.getPhysicalDevice(), surface);
+        VkSurfaceFormatKHR      surface_format     = chooseSwapSurfaceFormat(swap_chain_support.formats);
+        VkPresentModeKHR        present_mode       = chooseSwapPresentMode(swap_chain_support.present_modes);
+        VkExtent2D              swap_extent = chooseSwapExtent(swap_chain_support.capabilities, drawable_extent);
+        uint32_t image_count = swap_chain_support.capabilities.minImageCount + 1;
+        if (swap_chain_support.capabilities.maxImageCount > 0 &&
+            image_count > swap_chain_support.capabilities.maxImageCount)
+        {
+            image_count = swap_chain_support.capabilities.maxImageCount;
+        }
+        VkSwapchainCreateInfoKHR create_info {};
+        create_info.sType            = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+        create_info.surface          = surface;
+        create_info.minImageCount    = image_count;
+        create_info.imageColorSpace  = surface_format.colorSpace;
+        create_info.imageFormat      = surface_format.format;
+        create_info.imageExtent      = swap_extent;
+        create_info.imageArrayLayers = 1;
+        create_info.imageUsage       = usage;
+
+        const QueueFamilyIndices& indices                = gpu.getQueueFamilies();
+        uint32_t                  queue_family_indices[] = {indices.graphics_family.value(),
+                                                            indices.present_family.value()};
+        if (indices.graphics_family != indices.present_family)
+        {
+            create_info.imageSharingMode      = VK_SHARING_MODE_CONCURRENT;
+            create_info.queueFamilyIndexCount = 2;
+            create_info.pQueueFamilyIndices   = queue_family_indices;
+        }
+        else
+        {
+            create_info.imageSharingMode      = VK_SHARING_MODE_EXCLUSIVE;
+            create_info.queueFamilyIndexCount = 0;
+            create_info.pQueueFamilyIndices   = nullptr;
+        }
+        create_info.preTransform   = swap_chain_support.capabilities.currentTransform;
+        create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+        create_info.presentMode    = present_mode;
+        create_info.clipped        = VK_TRUE;
+        create_info.oldSwapchain   = VK_NULL_HANDLE;
+
+        VkDevice device = gpu.getDevice();
+        if (vkCreateSwapchainKHR(device, &create_info, nullptr, &swap_chain) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create swap chain!");
+        }
+        vkGetSwapchainImagesKHR(device, swap_chain, &image_count, nullptr);
+        images.resize(image_count);
+        vkGetSwapchainImagesKHR(device, swap_chain, &image_count, images.data());
+        format = surface_format.format;
+        extent = swap_extent;
+
+        image_views.resize(images.size());
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            image_views[i] = gpu.createImageView(images[i], format);
+        }
+    }
+
+    void WindowSurface::createOffscreen(const GpuDevice&  gpu,
+                                        VkExtent2D        image_extent,
+                                        VkImageUsageFlags usage,
+                                        uint32_t          frame_count)
+    {
+        // the format chooseSwapSurfaceFormat prefers, so offscreen frames match what a window shows
+        offscreen = true;
+        format    = VK_FORMAT_B8G8R8A8_UNORM;
+        extent    = image_extent;
+        images.resize(frame_count);
+        image_memory.resize(frame_count);
+        image_views.resize(frame_count);
+        for (uint32_t i = 0; i < frame_count; i++)
+        {
+            gpu.createImage(extent.width,
+                            extent.height,
+                            format,
+                            VK_IMAGE_TILING_OPTIMAL,
+                            usage,
+                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                            images[i],
+                            image_memory[i]);
+            image_views[i] = gpu.createImageView(images[i], format);
+        }
+    }
+
+    void WindowSurface::destroySwapChain(VkDevice device)
+    {
+        for (const auto& image_view : image_views)
+        {
+            vkDestroyImageView(device, image_view, nullptr);
+        }
+        image_views.clear();
+        if (offscreen)
+        {
+            for (size_t i = 0; i < image_memory.size(); i++)
+            {
+                vkDestroyImage(device, images[i], nullptr);
+                vkFreeMemory(device, image_memory[i], nullptr);
+            }
+            image_memory.clear();
+            return;
+        }
+        vkDestroySwapchainKHR(device, swap_chain, nullptr);
+        swap_chain = VK_NULL_HANDLE;
+    }
+
+    VkResult WindowSurface::acquire(VkDevice device, uint32_t frame, uint32_t& image_index) const
+    {
+        if (offscreen)
+        {
+            image_index = frame;
+            return VK_SUCCESS;
+        }
+        return vkAcquireNextImageKHR(
+            device, swap_chain, UINT64_MAX, image_available_semaphores[frame], VK_NULL_HANDLE, &image_index);
+    }
+
+    VkImageLayout WindowSurface::getFinalLayout() const
+    {
+        // PRESENT_SRC_KHR needs the swapchain extension, which a device without presentation does not enable
+        return offscreen ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    }
+
+    void WindowSurface::cleanup(VkInstance instance, VkDevice device)
+    {
+        for (size_t i = 0; i < image_available_semaphores.size(); i++)
+        {
+            vkDestroySemaphore(device, render_finished_semaphores[i], nullptr);
+            vkDestroySemaphore(device, image_available_semaphores[i], nullptr);
+        }
+        if (surface != VK_NULL_HANDLE)
+        {
+            vkDestroySurfaceKHR(instance, surface, nullptr);
+        }
+        if (window != nullptr)
+        {
+            SDL_DestroyWindow(window);
+            window = nullptr;
+        }
+    }
+} // namespace vulkanDetails
@@ -0,0 +1,77 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <SDL_video.h>
+#include <cstdint>
+#include <vector>
+
+namespace vulkanDetails
+{
+    class GpuDevice;
+
+    struct SwapChainSupportDetails
+    {
+        VkSurfaceCapabilitiesKHR        capabilities;
+        std::vector<VkSurfaceFormatKHR> formats;
+        std::vector<VkPresentModeKHR>   present_modes;
+    };
+
+    // What one output presents to: its window, the surface and swapchain on it, and the semaphores that order each
+    // frame in flight's acquire, rendering and present. Everything device-wide lives in GpuDevice.
+    //
+    // Without a window it renders offscreen instead: createOffscreen makes plain images that stand in for the
+    // swapchain's, and nothing is presented.
+    class WindowSurface
+    {
+    public:
+        // Takes ownership of window, it is destroyed by cleanup().
+        void setWindow(SDL_Window* sdl_window) { window = sdl_window; }
+        void createSurface(VkInstance instance);
+        void createSyncObjects(VkDevice device, uint32_t frame_count);
+        // The extent is only used where the surface leaves it to the application.
+        void createSwapChain(const GpuDevice& gpu, VkExtent2D drawable_extent, VkImageUsageFlags usage);
+        // One image per frame in flight, so a frame slot's fence also orders the reuse of its image.
+        void createOffscreen(const GpuDevice&  gpu,
+                             VkExtent2D        image_extent,
+                             VkImageUsageFlags usage,
+                             uint32_t          frame_count);
+        // Destroys the swapchain or the offscreen images.
+        void destroySwapChain(VkDevice device);
+        void cleanup(VkInstance instance, VkDevice device);
+
+        // Signals the frame's image available semaphore once image_index may be rendered to. Offscreen, the image is
+        // the frame slot's own and nothing is signaled.
+        VkResult acquire(VkDevice device, uint32_t frame, uint32_t& image_index) const;
+
+        static SwapChainSupportDetails querySupport(VkPhysicalDevice physical_device, VkSurfaceKHR surface);
+        static VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& available_formats);
+        static VkPresentModeKHR   chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& available_present_modes);
+        static VkExtent2D         chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities,
+                                                   VkExtent2D                      drawable_extent);
+
+        [[nodiscard]] bool                            isOffscreen() const { return offscreen; }
+        // What a frame leaves its image in: PRESENT_SRC_KHR for the swapchain, offscreen images stay attachments.
+        [[nodiscard]] VkImageLayout                   getFinalLayout() const;
+        [[nodiscard]] SDL_Window*                     getWindow() const { return window; }
+        [[nodiscard]] VkSurfaceKHR                    getSurface() const { return surface; }
+        [[nodiscard]] VkSwapchainKHR                  getSwapChain() const { return swap_chain; }
+        [[nodiscard]] const std::vector<VkImage>&     getImages() const { return images; }
+        [[nodiscard]] const std::vector<VkImageView>& getImageViews() const { return image_views; }
+        [[nodiscard]] VkFormat                        getFormat() const { return format; }
+        [[nodiscard]] VkExtent2D                      getExtent() const { return extent; }
+        [[nodiscard]] VkSemaphore getImageAvailable(uint32_t frame) const { return image_available_semaphores[frame]; }
+        [[nodiscard]] VkSemaphore getRenderFinished(uint32_t frame) const { return render_finished_semaphores[frame]; }
+
+    private:
+        SDL_Window*                 window = nullptr;
+        VkSurfaceKHR                surface {};
+        VkSwapchainKHR              swap_chain {};
+        std::vector<VkImage>        images;
+        std::vector<VkImageView>    image_views;
+        std::vector<VkDeviceMemory> image_memory; // offscreen images only, the swapchain owns its own
+        bool                        offscreen = false;
+        VkFormat                    format {};
+        VkExtent2D                  extent {};
+        std::vector<VkSemaphore>    image_available_semaphores;
+        std::vector<VkSemaphore>    render_finished_semaphores;
+    };
+} // namespace vulkanDetails